@@ -10,6 +10,7 @@
 #include <lexer/lexem.h>
 #include <generic/list.h>
 #include <lexer/lexer.h>
+#include <lexer/reorder.h>
 
 
 
@@ -23,21 +24,93 @@ void delete_lexem_wrapper(void *ptr) {
     lexem_delete(ptr);
 }
 
+// differential check: both runs must give exactly the same lexems
+static int same_lexems(list_t l1, list_t l2, char *what) {
+    for ( ; !list_is_empty(l1) && !list_is_empty(l2); l1 = list_next(l1), l2 = list_next(l2)) {
+        if (!lexem_is_egal(list_first(l1), list_first(l2))) {
+            lexem_t lex = list_first(l1);
+            fprintf(stderr, "%s differ at %d:%d\n", what, lexem_line(lex), lexem_column(lex));
+            return 0;
+        }
+    }
+    return list_is_empty(l1) && list_is_empty(l2);
+}
+
 int main(int argc, char *argv[]) {
+    // options first
+    int argi = 1;
+    char *reorder_file = NULL;
+    int check_scanners = 0;
+    int options = 0;
+    while (argi < argc && 0 == strncmp(argv[argi], "--", 2)) {
+        if (0 == strcmp(argv[argi], "--profile")) {
+            lex_profile_enable();
+        } else if (0 == strcmp(argv[argi], "--skip-trivia")) {
+            options |= LEX_SKIP_TRIVIA;
+        } else if (0 == strcmp(argv[argi], "--no-scanners")) {
+            options |= LEX_NO_SCANNERS;
+        } else if (0 == strcmp(argv[argi], "--check-scanners")) {
+            check_scanners = 1;
+        } else if (0 == strcmp(argv[argi], "--reorder") && argi + 1 < argc) {
+            // the reordering needs the hit counts of this run
+            lex_profile_enable();
+            reorder_file = argv[++argi];
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[argi]);
+            exit(EXIT_FAILURE);
+        }
+        argi++;
+    }
+
     // arguments verif (2 files)
-    if (argc != 3) {
-        fprintf(stderr, "Usage:\n\t%s <lex_definitions_file> <source_file>\n", argv[0]);
+    if (argc - argi != 2) {
+        fprintf(stderr, "Usage:\n\t%s [--profile] [--skip-trivia] [--no-scanners] [--check-scanners] [--reorder <out_lex_file>] <lex_definitions_file> <source_file>\n", argv[0]);
         exit(EXIT_FAILURE);
     }
 
     // lesgooo
-    list_t lexems = lex(argv[1], argv[2]);
+    list_t lexems = lex_with(argv[argi], argv[argi + 1], options);
 
     if (lexems == NULL) {
        
         return EXIT_FAILURE;
     }
 
+    // write the reordered rules, then check they give the same lexems
+    if (reorder_file) {
+        if (0 != lex_rules_reorder(argv[argi], reorder_file)) {
+            list_delete(lexems, lexem_delete);
+            return EXIT_FAILURE;
+        }
+
+        list_t check = lex_with(reorder_file, argv[argi + 1], options);
+        int same = check && same_lexems(lexems, check, "Reordered rules");
+        list_delete(check, lexem_delete);
+
+        if (!same) {
+            fprintf(stderr, "Error: %s does not give the same lexems\n", reorder_file);
+            list_delete(lexems, lexem_delete);
+            return EXIT_FAILURE;
+        }
+        fprintf(stderr, "Reordered rules written to %s (%zu lexems checked)\n",
+                reorder_file, list_length(lexems));
+    }
+
+    // the native scanners against the regexp rules they stand for
+    if (check_scanners) {
+        list_t check = lex_with(argv[argi], argv[argi + 1], options ^ LEX_NO_SCANNERS);
+        int same = check && same_lexems(lexems, check, "Native scanners and regexps");
+        list_delete(check, lexem_delete);
+
+        if (!same) {
+            fprintf(stderr, "Error: native scanners do not give the same lexems as the regexps\n");
+            list_delete(lexems, lexem_delete);
+            return EXIT_FAILURE;
+        }
+        fprintf(stderr, "Native scanners checked against the regexps (%zu lexems)\n",
+                list_length(lexems));
+    }
+
     // SHOW TIME
     // we go through the list to show each lexem
     if (list_is_empty(lexems)) {
@@ -5,35 +5,88 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <generic/list.h>
+#include <generic/arena.h>
+#include <generic/intern.h>
 #include <lexer/lexem.h>
 #include <lexer/lexer.h>
+#include <lexer/tokpipe.h>
 #include <parser/parser.h>
 #include <parser/pyobj.h>
 
+pyobj_t parse_tokens(tokbuf_t tokens);
+pyobj_t parse_pipe(tokpipe_t pipe);
+
+// everything made for the source file goes away with its arena
+// (or object by object with --no-arena), then the strings interned for it
+static void unit_release(arena_t unit, pyobj_t code, tokbuf_t tokens, tokpipe_t pipe) {
+    if (unit) {
+        arena_set_current(NULL);
+        arena_delete(unit);
+    } else {
+        pyobj_delete(code);
+    }
+    tokbuf_delete(tokens);
+    tokpipe_delete(pipe);
+    intern_release();
+}
 
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
+    // options first
+    int argi = 1;
+    int lex_options = 0;
+    int use_arena = 1;
+    int pipelined = 0;
+    while (argi < argc && 0 == strncmp(argv[argi], "--", 2)) {
+        if (0 == strcmp(argv[argi], "--skip-trivia")) {
+            lex_options |= LEX_SKIP_TRIVIA;
+        } else if (0 == strcmp(argv[argi], "--no-arena")) {
+            use_arena = 0;
+        } else if (0 == strcmp(argv[argi], "--pipeline")) {
+            pipelined = 1;
+        } else {
+            printf("Option inconnue : %s\n", argv[argi]);
+            exit(EXIT_FAILURE);
+        }
+        argi++;
+    }
+
+    if (argc - argi != 2) {
         printf("Arguments insuffisants ! \n");
         exit(EXIT_FAILURE);
     }
-    char *LEX = argv[1];
-    char *source_file = argv[2];
+    char *LEX = argv[argi];
+    char *source_file = argv[argi + 1];
 
-    list_t lexems = lex(LEX, source_file);
+    arena_t unit = NULL;
+    if (use_arena) {
+        unit = arena_new(0);
+        arena_set_current(unit);
+    }
+
+    // with --pipeline the lexer runs on its own thread (see tokpipe.h)
+    tokbuf_t tokens = NULL;
+    tokpipe_t pipe = pipelined ? tokpipe_open(LEX, source_file, lex_options) : NULL;
+    pyobj_t code = NULL;
+
+    if (pipe) {
+        code = parse_pipe(pipe);
+    } else {
+        tokens = lex_tokens(LEX, source_file, lex_options);
+    }
 
-    if (NULL == lexems) {
+    if ((pipe && tokpipe_finish(pipe) < 0) || (!pipe && (NULL == tokens || 0 == tokbuf_count(tokens)))) {
         // The lexer already prints the lexical error
+        unit_release(unit, code, tokens, pipe);
         return EXIT_FAILURE;
     }
 
-    // Keep a copy of the list head so we can free nodes later. 
-    list_t lexems_head = lexems;
-    pyobj_t code = parse_pys(&lexems);
+    if (!pipe) code = parse_tokens(tokens);
     if (NULL == code) {
         // The parser already prints the parse error
-        list_delete(lexems_head, lexem_delete);
+        unit_release(unit, NULL, tokens, pipe);
         return EXIT_FAILURE;
     }
 
@@ -41,8 +94,7 @@ int main(int argc, char *argv[]) {
     printf("\n");
 
     // Free memory
-    pyobj_delete(code);
     printf("parsing reussi \n");
-    list_delete(lexems_head, lexem_delete);
+    unit_release(unit, code, tokens, pipe);
     return EXIT_SUCCESS;
 }
\ No newline at end of file
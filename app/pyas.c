@@ -10,46 +10,105 @@
 
 #include <lexer/lexem.h>
 #include <lexer/lexer.h>
+#include <lexer/tokpipe.h>
 #include <parser/parser.h>
+#include <parser/constpool.h>
+#include <parser/conststream.h>
 #include <parser/pyobj.h>
 #include <generic/list.h>
+#include <generic/arena.h>
+#include <generic/intern.h>
 
 
 int pyasm(pyobj_t code); 
 int pyobj_write(FILE *fp, pyobj_t obj);
+pyobj_t parse_tokens(tokbuf_t tokens);
+pyobj_t parse_pipe(tokpipe_t pipe);
 
 // Magic Number for Python 2.7 : 03 F3 0D 0A
 
 #define PY27_MAGIC_NUMBER 0x0A0DF303 
 
+// everything made for the source file goes away with its arena
+// (or object by object with --no-arena), then the strings interned for it
+static void unit_release(arena_t unit, pyobj_t code, tokbuf_t tokens, tokpipe_t pipe) {
+    if (unit) {
+        arena_set_current(NULL);
+        arena_delete(unit);
+    } else {
+        pyobj_delete(code);
+    }
+    tokbuf_delete(tokens);
+    tokpipe_delete(pipe);
+    intern_release();
+}
+
 int main(int argc, char *argv[]) {
+    // options first
+    int argi = 1;
+    int lex_options = 0;
+    int use_arena = 1;
+    int pipelined = 0;
+    while (argi < argc && 0 == strncmp(argv[argi], "--", 2)) {
+        if (0 == strcmp(argv[argi], "--profile")) {
+            lex_profile_enable();
+        } else if (0 == strcmp(argv[argi], "--skip-trivia")) {
+            lex_options |= LEX_SKIP_TRIVIA;
+        } else if (0 == strcmp(argv[argi], "--no-arena")) {
+            use_arena = 0;
+        } else if (0 == strcmp(argv[argi], "--pipeline")) {
+            pipelined = 1;
+        } else if (0 == strcmp(argv[argi], "--merge-constants")) {
+            constpool_enable(CONSTPOOL_CONSTS | CONSTPOOL_NAMES);
+        } else if (0 == strcmp(argv[argi], "--stream-consts")) {
+            conststream_enable(1);
+        } else {
+            fprintf(stderr, "Option inconnue : %s\n", argv[argi]);
+            return EXIT_FAILURE;
+        }
+        argi++;
+    }
+
     //(prog + source + output + lex)
-    if (argc != 4) {
+    if (argc - argi != 3) {
         printf("Arguments insuffisants !\n");
         return EXIT_FAILURE;
     }
 
-    char *source_filename = argv[2];
-    char *output_filename = argv[3];
-    char *lex_rules_filename = argv[1]; 
+    char *source_filename = argv[argi + 1];
+    char *output_filename = argv[argi + 2];
+    char *lex_rules_filename = argv[argi]; 
 
-//analyse lexicale
-    
-    list_t lexems = lex(lex_rules_filename,source_filename);
+    arena_t unit = NULL;
+    if (use_arena) {
+        unit = arena_new(0);
+        arena_set_current(unit);
+    }
+
+//analyse lexicale + synthaxique
+    // with --pipeline the lexer runs on its own thread (see tokpipe.h)
+    tokbuf_t tokens = NULL;
+    tokpipe_t pipe = pipelined ? tokpipe_open(lex_rules_filename, source_filename, lex_options) : NULL;
+    pyobj_t code_obj = NULL;
+
+    if (pipe) {
+        code_obj = parse_pipe(pipe);
+    } else {
+        tokens = lex_tokens(lex_rules_filename, source_filename, lex_options);
+    }
 
-    if (list_is_empty(lexems)) {
+    if ((pipe && tokpipe_finish(pipe) < 0) || (!pipe && (NULL == tokens || 0 == tokbuf_count(tokens)))) {
+        unit_release(unit, code_obj, tokens, pipe);
         fprintf(stderr, "Erreur Lexer \n");
         return EXIT_FAILURE;
     }
 
-//analyse synthaxique 
     //parser
-    list_t lexems_cursor = lexems; 
-    pyobj_t code_obj = parse_pys(&lexems_cursor);
+    if (!pipe) code_obj = parse_tokens(tokens);
 
     if (!code_obj) {
         fprintf(stderr, "Erreur de syntaxe (Parser failed).\n");
-        list_delete(lexems, lexem_delete);
+        unit_release(unit, NULL, tokens, pipe);
         return EXIT_FAILURE;
     }
 
@@ -58,8 +117,7 @@ int main(int argc, char *argv[]) {
    
     if (pyasm(code_obj) < 0) {
         fprintf(stderr, "Erreur lors de l'assemblage.\n");
-        pyobj_delete(code_obj);
-        list_delete(lexems, lexem_delete);
+        unit_release(unit, code_obj, tokens, pipe);
         return EXIT_FAILURE;
     }
 
@@ -68,8 +126,7 @@ int main(int argc, char *argv[]) {
     FILE *dest_fp = fopen(output_filename, "wb");
     if (!dest_fp) {
         perror("Erreur ouverture destination");
-        pyobj_delete(code_obj);
-        list_delete(lexems, lexem_delete);
+        unit_release(unit, code_obj, tokens, pipe);
         return EXIT_FAILURE;
     }
 
@@ -87,8 +144,7 @@ int main(int argc, char *argv[]) {
     if (pyobj_write(dest_fp, code_obj) < 0) {
         fprintf(stderr, "Erreur lors de l'écriture du .pyc\n");
         fclose(dest_fp);
-        pyobj_delete(code_obj);
-        list_delete(lexems, lexem_delete);
+        unit_release(unit, code_obj, tokens, pipe);
         return EXIT_FAILURE;
     }
 
@@ -96,8 +152,7 @@ int main(int argc, char *argv[]) {
 
     
     fclose(dest_fp);
-    pyobj_delete(code_obj);
-    list_delete(lexems, lexem_delete);
+    unit_release(unit, code_obj, tokens, pipe);
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+/**
+ * @file consts.c
+ * @author Abdellah
+ * @brief Benchmark of float constants.
+ *
+ * A million floats, written with 17 significant digits (the most a
+ * double needs) and a few with more digits, halfway between two doubles
+ * but for the last one (they go to strtod()): decoded by
+ * numlit_float() and by strtod(), then parsed in the .consts of a
+ * source, as a list of objects and streamed.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <lexer/lexer.h>
+#include <lexer/numlit.h>
+#include <lexer/tokbuf.h>
+#include <parser/pyobj.h>
+#include <parser/conststream.h>
+
+pyobj_t parse_tokens( tokbuf_t tokens );
+
+#define RULES   "include/lexer/regexp_file.lex"
+#define FLOATS  1000000
+#define ROUNDS  3
+#define LITERAL 48
+
+static double now( void ) {
+  struct timespec t;
+
+  clock_gettime( CLOCK_MONOTONIC, &t );
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+static double sink;
+
+/* the best of ROUNDS runs, in ns per float */
+static void best( double *t, double start ) {
+  double ns = 1e9 * ( now() - start ) / FLOATS;
+
+  if ( ns < *t ) *t = ns;
+}
+
+/* xorshift64 */
+static uint64_t next_random( uint64_t *seed ) {
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 7;
+  *seed ^= *seed << 17;
+  return *seed;
+}
+
+/* every 64th one has 2^53 + 1 and more digits: halfway between two
+   doubles, but for its last digit */
+static void literals( char ( *text )[ LITERAL ] ) {
+  uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  size_t   i;
+
+  for ( i = 0 ; i < FLOATS ; i++ ) {
+    uint64_t r        = next_random( &seed );
+    double   mantissa = 1 + (double)( r >> 11 ) / ( (uint64_t)1 << 53 );
+    int      exponent = (int)( r % 6 );
+
+    /* the lexer reads no exponent: 1 to 6 digits before the point */
+    if ( 63 == i % 64 ) snprintf( text[ i ], LITERAL, "9007199254740993.%019d", 1 + (int)( r % 9 ) );
+    else                snprintf( text[ i ], LITERAL, "%.*f", 16 - exponent, mantissa * pow( 10, exponent ) );
+  }
+}
+
+static char *source_file( char ( *text )[ LITERAL ] ) {
+  static char name[] = "/tmp/bench-consts-XXXXXX";
+  int         fd     = mkstemp( name );
+  FILE       *fp     = fd < 0 ? NULL : fdopen( fd, "w" );
+  size_t      i;
+
+  if ( !fp ) return NULL;
+
+  fprintf( fp, ".set version_pyvm 62211\n.set flags 0x00000040\n.set filename \"consts.py\"\n" );
+  fprintf( fp, ".set name \"<module>\"\n.set stack_size 1\n.set arg_count 0\n\n.consts\n" );
+  for ( i = 0 ; i < FLOATS ; i++ ) fprintf( fp, "  %s\n", text[ i ] );
+  fprintf( fp, "\n.text\n.line 1\n  LOAD_CONST 0\n  RETURN_VALUE\n" );
+  fclose( fp );
+
+  return name;
+}
+
+static void decode( char ( *text )[ LITERAL ], double *numlit, double *libc, int *differ ) {
+  double start = now();
+  double value;
+  size_t i;
+
+  for ( i = 0 ; i < FLOATS ; i++ ) {
+    if ( 0 == numlit_float( text[ i ], strlen( text[ i ] ), &value ) ) sink += value;
+  }
+  best( numlit, start );
+
+  start = now();
+  for ( i = 0 ; i < FLOATS ; i++ ) sink += strtod( text[ i ], NULL );
+  best( libc, start );
+
+  *differ = 0;
+  for ( i = 0 ; i < FLOATS ; i++ ) {
+    numlit_float( text[ i ], strlen( text[ i ] ), &value );
+    *differ += value != strtod( text[ i ], NULL );
+  }
+}
+
+/* lexed once, then parsed */
+static void parse( tokbuf_t tokens, int streamed, double *t ) {
+  double  start;
+  pyobj_t code;
+
+  conststream_enable( streamed );
+  start = now();
+  code  = parse_tokens( tokens );
+  best( t, start );
+  conststream_enable( 0 );
+
+  if ( !code ) {
+    fprintf( stderr, "The source is not parsed\n" );
+    exit( EXIT_FAILURE );
+  }
+  pyobj_delete( code );
+}
+
+int main( void ) {
+  char    ( *text )[ LITERAL ] = malloc( FLOATS * sizeof( *text ) );
+  double  numlit = 1e18, libc = 1e18, listed = 1e18, streamed = 1e18;
+  char     *file;
+  tokbuf_t  tokens;
+  int       round, differ = 0;
+
+  if ( !text ) exit( EXIT_FAILURE );
+  literals( text );
+
+  file = source_file( text );
+  if ( !file ) exit( EXIT_FAILURE );
+  tokens = lex_tokens( RULES, file, LEX_SKIP_TRIVIA );
+  unlink( file );
+  if ( !tokens ) exit( EXIT_FAILURE );
+
+  for ( round = 0 ; round < ROUNDS ; round++ ) {
+    decode( text, &numlit, &libc, &differ );
+    parse( tokens, 0, &listed );
+    parse( tokens, 1, &streamed );
+  }
+
+  printf( "%d floats, best of %d runs, ns per float\n\n", FLOATS, ROUNDS );
+  printf( "numlit_float()         %10.2f\n", numlit );
+  printf( "strtod()               %10.2f\n", libc );
+  printf( "  (%d values differ)\n", differ );
+  printf( ".consts, objects       %10.2f\n", listed );
+  printf( ".consts, streamed      %10.2f\n", streamed );
+
+  tokbuf_delete( tokens );
+  free( text );
+
+  exit( sink != 0 ? EXIT_SUCCESS : EXIT_FAILURE );
+}
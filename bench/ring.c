@@ -0,0 +1,228 @@
+/**
+ * @file ring.c
+ * @author Abdellah
+ * @brief Benchmark of ring buffers and concurrent queues.
+ *
+ * Throughput (objects per second from producers to consumers, one at a
+ * time or by batches) and latency (round trip of one object between two
+ * threads), for rings and for concurrent queues.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <generic/ring.h>
+#include <generic/mpmc.h>
+
+#define OBJECTS    4000000
+#define ROUNDTRIPS 200000
+#define BATCH      32
+
+static double now( void ) {
+  struct timespec t;
+
+  clock_gettime( CLOCK_MONOTONIC, &t );
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+/* Rings: one producer, one consumer */
+struct spsc {
+  ring_t r;
+  size_t batch;
+};
+
+static void *ring_producer( void *arg ) {
+  struct spsc *s = arg;
+  void        *batch[ BATCH ];
+  size_t       i = 0, j;
+
+  for ( j = 0 ; j < BATCH ; j++ ) batch[ j ] = (void*)(uintptr_t)( j + 1 );
+
+  while ( i < OBJECTS ) {
+    j = 1 == s->batch ? (size_t)ring_push( s->r, batch[ 0 ] ) : ring_push_batch( s->r, batch, s->batch );
+    if ( !j ) sched_yield();
+    i += j;
+  }
+  ring_close( s->r );
+
+  return NULL;
+}
+
+static void *ring_consumer( void *arg ) {
+  struct spsc *s = arg;
+  void        *batch[ BATCH ];
+
+  for ( ;; ) {
+    int    closed = ring_closed( s->r );
+    size_t n      = 1 == s->batch ? (size_t)ring_pop( s->r, batch ) : ring_pop_batch( s->r, batch, s->batch );
+
+    if ( n ) continue;
+    if ( closed ) break;
+    sched_yield();
+  }
+
+  return NULL;
+}
+
+static double ring_throughput( size_t batch ) {
+  struct spsc s = { ring_new( 1024 ), batch };
+  pthread_t   producer, consumer;
+  double      start = now();
+
+  pthread_create( &consumer, NULL, ring_consumer, &s );
+  pthread_create( &producer, NULL, ring_producer, &s );
+  pthread_join( producer, NULL );
+  pthread_join( consumer, NULL );
+  start = now() - start;
+  ring_delete( s.r, NULL );
+
+  return OBJECTS / start;
+}
+
+/* Concurrent queues: n producers, n consumers */
+struct mpmc_run {
+  mpmc_t q;
+  size_t batch;
+  size_t objects;   /* per producer */
+};
+
+static void *mpmc_producer( void *arg ) {
+  struct mpmc_run *run = arg;
+  void            *batch[ BATCH ];
+  size_t           i = 0, j;
+
+  for ( j = 0 ; j < BATCH ; j++ ) batch[ j ] = (void*)(uintptr_t)( j + 1 );
+
+  while ( i < run->objects ) {
+    j = 1 == run->batch ? (size_t)mpmc_push( run->q, batch[ 0 ] ) : mpmc_push_batch( run->q, batch, run->batch );
+    if ( !j ) sched_yield();
+    i += j;
+  }
+
+  return NULL;
+}
+
+static void *mpmc_consumer( void *arg ) {
+  struct mpmc_run *run = arg;
+  void            *batch[ BATCH ];
+
+  for ( ;; ) {
+    int    closed = mpmc_closed( run->q );
+    size_t n      = 1 == run->batch ? (size_t)mpmc_pop( run->q, batch ) : mpmc_pop_batch( run->q, batch, run->batch );
+
+    if ( n ) continue;
+    if ( closed ) break;
+    sched_yield();
+  }
+
+  return NULL;
+}
+
+static double mpmc_throughput( int threads, size_t batch ) {
+  struct mpmc_run run = { mpmc_new( 1024 ), batch, OBJECTS / threads };
+  pthread_t      *t   = malloc( 2 * threads * sizeof( *t ) );
+  double          start = now();
+  int             i;
+
+  for ( i = 0 ; i < threads ; i++ ) pthread_create( &t[ threads + i ], NULL, mpmc_consumer, &run );
+  for ( i = 0 ; i < threads ; i++ ) pthread_create( &t[ i ], NULL, mpmc_producer, &run );
+  for ( i = 0 ; i < threads ; i++ ) pthread_join( t[ i ], NULL );
+  mpmc_close( run.q );
+  for ( i = 0 ; i < threads ; i++ ) pthread_join( t[ threads + i ], NULL );
+  start = now() - start;
+
+  mpmc_delete( run.q, NULL );
+  free( t );
+
+  return run.objects * threads / start;
+}
+
+/* Latency: an object goes to the other thread and comes back */
+struct pingpong {
+  ring_t to, back;
+  mpmc_t qto, qback;
+};
+
+static void *ring_echo( void *arg ) {
+  struct pingpong *p = arg;
+  void            *o;
+  long             i;
+
+  for ( i = 0 ; i < ROUNDTRIPS ; i++ ) {
+    while ( !ring_pop( p->to, &o ) ) sched_yield();
+    while ( !ring_push( p->back, o ) ) sched_yield();
+  }
+
+  return NULL;
+}
+
+static void *mpmc_echo( void *arg ) {
+  struct pingpong *p = arg;
+  void            *o;
+  long             i;
+
+  for ( i = 0 ; i < ROUNDTRIPS ; i++ ) {
+    while ( !mpmc_pop( p->qto, &o ) ) sched_yield();
+    while ( !mpmc_push( p->qback, o ) ) sched_yield();
+  }
+
+  return NULL;
+}
+
+/* ns per round trip */
+static double latency( int rings ) {
+  struct pingpong p = { ring_new( 2 ), ring_new( 2 ), mpmc_new( 2 ), mpmc_new( 2 ) };
+  pthread_t       echo;
+  void           *o = &p;
+  double          start;
+  long            i;
+
+  pthread_create( &echo, NULL, rings ? ring_echo : mpmc_echo, &p );
+  start = now();
+  for ( i = 0 ; i < ROUNDTRIPS ; i++ ) {
+    if ( rings ) {
+      while ( !ring_push( p.to, o ) ) sched_yield();
+      while ( !ring_pop( p.back, &o ) ) sched_yield();
+    }
+    else {
+      while ( !mpmc_push( p.qto, o ) ) sched_yield();
+      while ( !mpmc_pop( p.qback, &o ) ) sched_yield();
+    }
+  }
+  start = now() - start;
+  pthread_join( echo, NULL );
+
+  ring_delete( p.to, NULL );
+  ring_delete( p.back, NULL );
+  mpmc_delete( p.qto, NULL );
+  mpmc_delete( p.qback, NULL );
+
+  return 1e9 * start / ROUNDTRIPS;
+}
+
+int main( void ) {
+  long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+  int  threads;
+
+  if ( cpus < 1 ) cpus = 1;
+
+  printf( "%ld online CPUs, %d objects\n\n", cpus, OBJECTS );
+
+  printf( "throughput (Mobjects/s)       single   batch of %d\n", BATCH );
+  printf( "ring, 1 -> 1                 %7.2f   %7.2f\n", 1e-6 * ring_throughput( 1 ), 1e-6 * ring_throughput( BATCH ) );
+  for ( threads = 1 ; threads <= cpus ; threads *= 2 ) {
+    printf( "mpmc, %2d -> %-2d               %7.2f   %7.2f\n", threads, threads,
+            1e-6 * mpmc_throughput( threads, 1 ), 1e-6 * mpmc_throughput( threads, BATCH ) );
+  }
+
+  printf( "\nlatency (ns per round trip)\n" );
+  printf( "ring                         %7.1f\n", latency( 1 ) );
+  printf( "mpmc                         %7.1f\n", latency( 0 ) );
+
+  exit( EXIT_SUCCESS );
+}
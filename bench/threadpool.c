@@ -0,0 +1,82 @@
+/**
+ * @file threadpool.c
+ * @author Abdellah
+ * @brief Benchmark of thread pools.
+ *
+ * Fine-grained tasks (the cost of a task) and coarse-grained ones (the
+ * speedup over a serial loop), for 1, 2, 4... workers up to the CPUs.
+ */
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <generic/threadpool.h>
+
+static double now( void ) {
+  struct timespec t;
+
+  clock_gettime( CLOCK_MONOTONIC, &t );
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+static atomic_long sink;
+
+static int tiny_task( void *arg ) {
+  atomic_fetch_add_explicit( &sink, (long)(intptr_t)arg, memory_order_relaxed );
+  return 0;
+}
+
+/* about a millisecond of arithmetic */
+static int coarse_task( void *arg ) {
+  uint64_t h = (uint64_t)(intptr_t)arg;
+  long     i;
+
+  for ( i = 0 ; i < 400000 ; i++ ) h = h * 6364136223846793005ULL + 1442695040888963407ULL;
+  atomic_fetch_add_explicit( &sink, (long)( h & 1 ), memory_order_relaxed );
+  return 0;
+}
+
+static double run( threadpool_t pool, action_t task, long count ) {
+  taskgroup_t group = taskgroup_new( pool );
+  double      start = now();
+  long        i;
+
+  for ( i = 0 ; i < count ; i++ ) taskgroup_spawn( group, task, (void*)(intptr_t)i );
+  taskgroup_wait( group );
+  start = now() - start;
+  taskgroup_delete( group );
+
+  return start;
+}
+
+int main( void ) {
+  long   cpus = sysconf( _SC_NPROCESSORS_ONLN );
+  long   fine = 1000000, coarse = 256, i;
+  double serial;
+  int    workers;
+
+  if ( cpus < 1 ) cpus = 1;
+
+  serial = now();
+  for ( i = 0 ; i < coarse ; i++ ) coarse_task( (void*)(intptr_t)i );
+  serial = now() - serial;
+
+  printf( "%ld online CPUs\n\n", cpus );
+  printf( "workers   fine: ns/task   coarse: s   speedup\n" );
+
+  for ( workers = 1 ; workers <= 2 * cpus ; workers *= 2 ) {
+    threadpool_t pool = threadpool_new( workers, 0 );
+    double       f    = run( pool, tiny_task, fine );
+    double       c    = run( pool, coarse_task, coarse );
+
+    printf( "%7d   %14.1f   %9.3f   %7.2f\n", workers, 1e9 * f / fine, c, serial / c );
+    threadpool_delete( pool );
+  }
+  printf( "\nserial coarse loop: %.3f s\n", serial );
+
+  exit( EXIT_SUCCESS );
+}
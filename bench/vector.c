@@ -0,0 +1,106 @@
+/**
+ * @file vector.c
+ * @author Abdellah
+ * @brief Benchmark of vectors against lists.
+ *
+ * Building a sequence in order, walking it, reading it by index and
+ * taking its length, with a vector_t and with a list_t.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <generic/list.h>
+#include <generic/vector.h>
+
+#define OBJECTS 1000000
+#define READS   10000   /* by index: O(n) each on a list */
+#define ROUNDS  5
+
+static double now( void ) {
+  struct timespec t;
+
+  clock_gettime( CLOCK_MONOTONIC, &t );
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+static uintptr_t sink;
+
+/* the best of ROUNDS runs of each operation, in ns per object */
+struct times {
+  double build, walk, index, length;
+};
+
+static void best( double *t, double start, size_t count ) {
+  double ns = 1e9 * ( now() - start ) / count;
+
+  if ( ns < *t ) *t = ns;
+}
+
+static void vector_run( struct times *t ) {
+  double   start = now();
+  vector_t v     = vector_new();
+  size_t   i;
+
+  for ( i = 0 ; i < OBJECTS ; i++ ) vector_append( v, (void*)( i + 1 ) );
+  best( &t->build, start, OBJECTS );
+
+  start = now();
+  for ( i = 0 ; i < vector_length( v ) ; i++ ) sink += (uintptr_t)vector_data( v )[ i ];
+  best( &t->walk, start, OBJECTS );
+
+  start = now();
+  for ( i = 0 ; i < READS ; i++ ) sink += (uintptr_t)vector_get_at( v, ( i * 7919 ) % OBJECTS );
+  best( &t->index, start, READS );
+
+  start = now();
+  for ( i = 0 ; i < READS ; i++ ) sink += vector_length( v );
+  best( &t->length, start, READS );
+
+  vector_delete( v, NULL );
+}
+
+static void list_run( struct times *t ) {
+  double start = now();
+  list_t l     = list_new(), k;
+  size_t i;
+
+  /* in order the list way: adding first from the end (list_add_last() is O(n)) */
+  for ( i = OBJECTS ; i > 0 ; i-- ) l = list_add_first( (void*)i, l );
+  best( &t->build, start, OBJECTS );
+
+  start = now();
+  for ( k = l ; !list_is_empty( k ) ; k = list_next( k ) ) sink += (uintptr_t)list_first( k );
+  best( &t->walk, start, OBJECTS );
+
+  start = now();
+  for ( i = 0 ; i < READS / 100 ; i++ ) sink += (uintptr_t)list_get_at( l, ( i * 7919 ) % OBJECTS );
+  best( &t->index, start, READS / 100 );
+
+  start = now();
+  for ( i = 0 ; i < READS / 100 ; i++ ) sink += list_length( l );
+  best( &t->length, start, READS / 100 );
+
+  list_delete( l, NULL );
+}
+
+int main( void ) {
+  struct times v = { 1e18, 1e18, 1e18, 1e18 }, l = v;
+  int          round;
+
+  for ( round = 0 ; round < ROUNDS ; round++ ) {
+    vector_run( &v );
+    list_run( &l );
+  }
+
+  printf( "%d objects, best of %d runs, ns per object or call\n\n", OBJECTS, ROUNDS );
+  printf( "                    vector_t        list_t\n" );
+  printf( "build in order  %12.2f  %12.2f\n", v.build, l.build );
+  printf( "walk            %12.2f  %12.2f\n", v.walk, l.walk );
+  printf( "read at index   %12.2f  %12.0f\n", v.index, l.index );
+  printf( "length          %12.2f  %12.0f\n", v.length, l.length );
+
+  exit( sink ? EXIT_SUCCESS : EXIT_FAILURE );
+}
@@ -0,0 +1,90 @@
+/**
+ * @file arena.h
+ * @author Abdellah
+ * @brief Arenas.
+ *
+ * Bump allocation with checkpoints and whole-arena reset.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h> /* size_t */
+
+  /*
+    An arena hands out memory from big chunks by just moving a pointer.
+    Objects are never freed one by one: the whole arena is reset (or
+    deleted) at once, or rewound to a checkpoint taken earlier, which
+    releases everything allocated since.
+   */
+  typedef struct arena_t *arena_t;
+
+#include <generic/callbacks.h>
+
+  typedef struct {
+    void   *chunk;
+    size_t  used;
+  } arena_mark_t;
+
+  /* chunk_size (0: the default, 64 KiB) is rounded up to a multiple of
+     64 KiB */
+  arena_t      arena_new( size_t chunk_size );
+  void         arena_delete( arena_t a );
+
+  void        *arena_alloc( arena_t a, size_t size );   /* 16-byte aligned */
+  void        *arena_calloc( arena_t a, size_t count, size_t size );
+  char        *arena_strdup( arena_t a, const char *s );
+
+  arena_mark_t arena_mark( arena_t a );
+  void         arena_rewind( arena_t a, arena_mark_t mark );
+  void         arena_reset( arena_t a );
+
+  /* cleanup( arg ) is called when the arena is next reset or deleted,
+     before its memory goes (the last one added first), for what lives
+     outside the arena but belongs to objects inside it. Rewinding does
+     not call it. */
+  void         arena_on_reset( arena_t a, action_t cleanup, void *arg );
+
+  /* 1 if `p` points into memory handed out by the arena */
+  int          arena_owns( arena_t a, const void *p );
+
+  /* number of allocations and bytes handed out since the last reset */
+  size_t       arena_allocations( arena_t a );
+  size_t       arena_bytes( arena_t a );
+
+  /*
+    Memory of the compilation unit being processed.
+
+    The lists, lexems and python objects built for one source file go
+    through unit_malloc()/unit_free(). By default these are malloc() and
+    free(). Once an arena is made current, they allocate from it: the
+    whole unit is released at once by resetting or deleting the arena,
+    after making it not current again.
+
+    unit_free() tells memory of an arena by its address (whatever the
+    arena current, on any thread) and leaves it to its arena; memory
+    from malloc() is freed.
+
+    Memory from unit_malloc() must not be handed to free() (or
+    realloc()), nor used after its arena is reset.
+
+    The current arena is per thread: a thread working for the unit
+    (e.g. the lexer of a pipeline, see tokpipe.h) starts without one.
+   */
+  arena_t      arena_current( void );
+  arena_t      arena_set_current( arena_t a ); /* returns the previous one */
+
+  void        *unit_malloc( size_t size );
+  void        *unit_calloc( size_t count, size_t size );
+  char        *unit_strdup( const char *s );
+  void         unit_free( void *ptr );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file chain.h
+ * @author Abdellah
+ * @brief Lists with a header.
+ *
+ * Lists that know their last link and their length.
+ */
+
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h> /* size_t */
+
+  /*
+    A `list_t` is just its first link: appending to it or asking its
+    length walks the whole list, so building a list of n objects with
+    list_add_last() is O(n^2).
+
+    A chain is a list plus a header holding its last link and its
+    length: adding at both ends, the length and the last object are all
+    O(1). The links are those of list.h, so the objects of a chain can
+    be walked as a list (chain_list()), and a finished chain is turned
+    into a plain list in O(1) (chain_to_list()).
+   */
+  typedef struct chain_t *chain_t;
+
+#include <generic/list.h>
+
+  chain_t chain_new( void );
+  int     chain_is_empty( chain_t c );
+  size_t  chain_length( chain_t c );
+  void*   chain_first( chain_t c );
+  void*   chain_last( chain_t c );
+  void    chain_add_first( chain_t c, void *object );
+  void    chain_add_last( chain_t c, void *object );
+
+  /* moves the link following `before` in its list to the end of the
+     chain, without copying: `before` is then followed by the next one */
+  void    chain_move_next( chain_t c, list_t before );
+
+  /* the links of the chain, still owned by it */
+  list_t  chain_list( chain_t c );
+
+  /* chain of the links of l (found in O(n) once), l must not be used
+     anymore */
+  chain_t chain_from_list( list_t l );
+
+  /* the links of the chain as a list, the header is deleted */
+  list_t  chain_to_list( chain_t c );
+
+  void    chain_delete( chain_t c, action_t delete_ );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
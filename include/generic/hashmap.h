@@ -0,0 +1,67 @@
+/**
+ * @file hashmap.h
+ * @author Abdellah
+ * @brief Hash maps.
+ *
+ * Hash maps from strings or integers to generic pointers.
+ */
+
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+  /*
+    Open addressing with linear probing: the entries are stored in one
+    array (a power of two long, at most 3/4 full) and a key is looked
+    for from its hash slot onwards, so a lookup usually reads a single
+    cache line. Each entry keeps the full hash of its key, so strings
+    are only compared when the hashes are equal.
+
+    A map has either string keys (hashmap_new(), the keys are copied)
+    or integer keys (hashmap_new_int()). Values are generic pointers,
+    deleted through an `action_t` callback like in list.h.
+   */
+  typedef struct hashmap_t *hashmap_t;
+
+#include <generic/callbacks.h>
+
+  hashmap_t hashmap_new( void );
+  hashmap_t hashmap_new_int( void );
+  void      hashmap_delete( hashmap_t m, action_t delete_ );
+
+  size_t    hashmap_length( hashmap_t m );
+
+  /* room for `count` keys without growing */
+  void      hashmap_reserve( hashmap_t m, size_t count );
+
+  /*
+    String keys, `length` bytes long (they need not be '\0'-terminated).
+    put returns 1 if the key is new, 0 if its value was replaced.
+    find returns 1 and sets *value (if not NULL) when the key is there.
+  */
+  int       hashmap_put( hashmap_t m, const char *key, size_t length, void *value );
+  int       hashmap_find( hashmap_t m, const char *key, size_t length, void **value );
+  int       hashmap_remove( hashmap_t m, const char *key, size_t length, action_t delete_ );
+
+  /* '\0'-terminated string keys: value or NULL */
+  void*     hashmap_get( hashmap_t m, const char *key );
+
+  /* Integer keys: */
+  int       hashmap_put_int( hashmap_t m, uint64_t key, void *value );
+  int       hashmap_find_int( hashmap_t m, uint64_t key, void **value );
+  int       hashmap_remove_int( hashmap_t m, uint64_t key, action_t delete_ );
+
+  /* callback on each value, in no particular order */
+  int       hashmap_foreach( hashmap_t m, action_t action );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
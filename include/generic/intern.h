@@ -0,0 +1,66 @@
+/**
+ * @file intern.h
+ * @author Abdellah
+ * @brief String interning.
+ *
+ * One canonical copy of each string.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h> /* size_t */
+
+  /*
+    Interning a string returns its canonical copy: the same pointer for
+    equal strings, so that two interned strings are equal if and only if
+    their pointers are. Each canonical string also has an ID, numbered
+    from 0 in order of first interning.
+
+    Canonical strings are '\0'-terminated (they may hold '\0' bytes
+    too, their length is kept), read-only, and live until
+    intern_release(): they must never be freed, nor given to
+    unit_free(). The table is shared by all threads, but only strings
+    never interned before take its lock: each thread finds the strings
+    it interned lately in a cache of its own, and the string of an ID
+    or intern_owns() are read without locking.
+
+    Lexem types and values, type names of token buffers and the strings
+    of python objects (names, constants) are interned.
+   */
+  const char *intern( const char *s );
+  const char *intern_n( const char *s, size_t length );
+
+  /* ID of a string, interned if needed */
+  int         intern_id( const char *s, size_t length );
+
+  /* canonical string of an ID */
+  const char *intern_string( int id );
+
+  /* ID and length of a canonical string, in O(1) */
+  int         intern_id_of( const char *canonical );
+  size_t      intern_length_of( const char *canonical );
+
+  /* 1 if `s` points to a canonical string, in O(1): the strings are
+     in aligned chunks, the chunk of `s` is looked up in a table */
+  int         intern_owns( const char *s );
+
+  /* number of canonical strings and bytes they use */
+  size_t      intern_count( void );
+  size_t      intern_bytes( void );
+
+  /* free the table, the next string interned starts a new one: no
+     canonical string (nor ID) may be used anymore, by any thread. Done
+     at exit, and by the applications when the unit of a source file is
+     released. */
+  void        intern_release( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * @file linkpool.h
+ * @author Abdellah
+ * @brief Pool of list links.
+ *
+ * Allocation of the links of lists and queues.
+ */
+
+#ifndef LINKPOOL_H
+#define LINKPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /*
+    Links (`struct link_t`, two pointers) are the most allocated objects
+    of the project. Instead of one malloc() each, they are cut from
+    blocks of LINKPOOL_BLOCK links, and freed links are kept in a free
+    list to be handed out again. Both are per thread, so no locking is
+    needed: a link freed by another thread goes back to the pool it
+    comes from through a lock-free stack. The pool of a thread that ends
+    is taken over by the next one, its blocks are only freed at exit:
+    lists made by a thread stay valid after it.
+
+    The free list holds whole chains: a NULL-terminated chain of links
+    (a list) is given back in runs of links of the same pool, with a
+    table lookup only where the block changes. A chain may mix links of
+    several pools and of arenas.
+
+    When an arena is current (see arena.h), links come from it instead.
+    Freeing a link tells where it comes from by its address, not by the
+    arena current then: a link of an arena goes with it, like any memory
+    of the unit.
+
+    Only used by `src/list.c`, `src/queue.c` and `src/chain.c`: list.h
+    is unchanged.
+   */
+#define LINKPOOL_BLOCK 4096
+
+  void *link_alloc( void );
+  void  link_free( void *link );
+  void  link_free_chain( void *first );
+
+  /* free the blocks of all the pools: no link may be in use anymore,
+     by any thread. Done at exit. */
+  void  link_pool_release( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
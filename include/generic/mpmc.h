@@ -0,0 +1,58 @@
+/**
+ * @file mpmc.h
+ * @author Abdellah
+ * @brief Concurrent queues.
+ *
+ * Bounded lock-free queue between any number of threads.
+ */
+
+#ifndef MPMC_H
+#define MPMC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h> /* size_t */
+
+  /*
+    A bounded FIFO of generic pointers that any number of threads may
+    push to and pop from at the same time (MPMC). Like a ring (see
+    ring.h), it never locks nor blocks: operations on a full or empty
+    queue fail.
+
+    Each slot carries a sequence number telling whether it is ready to
+    be written or read for the current lap, so that a thread claims a
+    slot with a single compare-and-swap on the shared index, then fills
+    or empties it without any other synchronisation. The two shared
+    indices are on separate cache lines.
+
+    Batches are pushed and popped one object after the other: they
+    save calls, not atomic operations. Closing works like for rings.
+   */
+  typedef struct mpmc_t *mpmc_t;
+
+#include <generic/callbacks.h>
+
+  /* room for at least `capacity` objects (rounded up to a power of two) */
+  mpmc_t mpmc_new( size_t capacity );
+  void   mpmc_delete( mpmc_t q, action_t delete_ ); /* on objects still in */
+
+  size_t mpmc_capacity( mpmc_t q );
+
+  /* 1 if pushed, 0 if the queue is full */
+  int    mpmc_push( mpmc_t q, void *object );
+  size_t mpmc_push_batch( mpmc_t q, void **objects, size_t count );
+
+  /* 1 if *object was popped, 0 if the queue is empty */
+  int    mpmc_pop( mpmc_t q, void **object );
+  size_t mpmc_pop_batch( mpmc_t q, void **objects, size_t count );
+
+  void   mpmc_close( mpmc_t q );
+  int    mpmc_closed( mpmc_t q );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+/**
+ * @file ring.h
+ * @author Abdellah
+ * @brief Ring buffers.
+ *
+ * Bounded lock-free queue between two threads.
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h> /* size_t */
+
+  /*
+    A ring is a bounded FIFO of generic pointers between exactly one
+    producer thread and one consumer thread (SPSC). It never locks nor
+    blocks: pushing to a full ring or popping from an empty one just
+    fails, and the caller decides whether to spin, yield or do
+    something else.
+
+    The producer only writes the tail index and the consumer only
+    writes the head index, each on its own cache line, and each side
+    keeps a cached copy of the other's index, so that the two threads
+    do not share cache lines while the ring is neither full nor empty.
+    Batches of objects are pushed or popped with a single index update.
+
+    The producer may close the ring once it is done: objects pushed
+    before are still popped, and a pop that fails after ring_closed()
+    returned 1 means that nothing more will come.
+   */
+  typedef struct ring_t *ring_t;
+
+#include <generic/callbacks.h>
+
+  /* room for at least `capacity` objects (rounded up to a power of two) */
+  ring_t ring_new( size_t capacity );
+  void   ring_delete( ring_t r, action_t delete_ ); /* on objects still in */
+
+  size_t ring_capacity( ring_t r );
+  int    ring_empty( ring_t r );
+
+  /* Producer side: 1 if pushed, 0 if the ring is full */
+  int    ring_push( ring_t r, void *object );
+  /* as many of the `count` objects as fit, returns how many */
+  size_t ring_push_batch( ring_t r, void **objects, size_t count );
+  void   ring_close( ring_t r );
+
+  /* Consumer side: 1 if *object was popped, 0 if the ring is empty */
+  int    ring_pop( ring_t r, void **object );
+  /* at most `count` objects, returns how many */
+  size_t ring_pop_batch( ring_t r, void **objects, size_t count );
+  int    ring_closed( ring_t r );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * @file threadpool.h
+ * @author Abdellah
+ * @brief Thread pools.
+ *
+ * Work-stealing task scheduler.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /*
+    A pool runs tasks on a fixed set of worker threads. A task is an
+    `action_t` callback and its argument, like the callbacks of lists:
+    it is run as task( arg ) and returns 0 on success.
+
+    Each worker has its own deque of tasks. The tasks a worker spawns go
+    to the bottom of its deque and it takes its next task from there
+    too (last in, first out: the data is still in cache). A worker
+    whose deque is empty steals from the top of the deque of another
+    worker chosen at random, so the oldest (usually biggest) tasks are
+    the ones that move. Tasks spawned by other threads go to a shared
+    deque which all workers look at.
+
+    Tasks are spawned in a group, and waiting on the group returns once
+    all its tasks (including the ones they spawned in the same group)
+    have run. A worker waiting on a group runs other tasks meanwhile,
+    so tasks may spawn and wait for subtasks without deadlocking the
+    pool, and sleeps when there are none left to run.
+   */
+  typedef struct threadpool_t *threadpool_t;
+  typedef struct taskgroup_t  *taskgroup_t;
+
+#include <generic/callbacks.h>
+
+  /* flags of threadpool_new(): */
+#define THREADPOOL_PIN 0x1 /* worker i only runs on the i-th CPU the pool may
+                              run on (modulo their count, see sched_getaffinity()) */
+
+  /* `workers` 0 means one per online CPU */
+  threadpool_t threadpool_new( int workers, int flags );
+  /* the tasks already spawned are run first */
+  void         threadpool_delete( threadpool_t pool );
+  int          threadpool_workers( threadpool_t pool );
+
+  /* index of the calling worker of `pool`, or -1 if it is not one */
+  int          threadpool_worker_id( threadpool_t pool );
+
+  taskgroup_t  taskgroup_new( threadpool_t pool );
+  void         taskgroup_delete( taskgroup_t group ); /* not while in use */
+
+  void         taskgroup_spawn( taskgroup_t group, action_t task, void *arg );
+  /*
+    Returns once all tasks of the group have run: 0 if they all
+    returned 0, otherwise the result of the first one that failed
+    (in the order they ended).
+    The group may then be used again.
+  */
+  int          taskgroup_wait( taskgroup_t group );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file vector.h
+ * @author Abdellah
+ * @brief Vectors.
+ *
+ * Growable arrays of generic pointers.
+ */
+
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h> /* size_t */
+
+#include <generic/list.h> /* conversions from/to lists */
+
+  /*
+    Same idea as `list_t` (generic `void*` contents, objects deleted
+    and printed through `action_t` callbacks), but the contents are
+    stored in one contiguous array which doubles when it is full:
+    appending is amortized O(1), reading the i-th object or the length
+    is O(1).
+
+    Unlike a list, a vector is never NULL: it must be created with
+    vector_new() and released with vector_delete().
+   */
+  typedef struct vector_t *vector_t;
+
+#include <generic/callbacks.h>
+
+  vector_t vector_new( void );
+  int      vector_is_empty( vector_t v );
+  size_t   vector_length( vector_t v );
+  size_t   vector_capacity( vector_t v );
+  void*    vector_get_at( vector_t v, size_t index );
+  void     vector_set_at( vector_t v, size_t index, void *object );
+  void*    vector_last( vector_t v );
+  void     vector_append( vector_t v, void *object );
+  void*    vector_pop( vector_t v );
+
+  /* room for at least `capacity` objects / no more room than needed */
+  void     vector_reserve( vector_t v, size_t capacity );
+  void     vector_shrink( vector_t v );
+
+  /* remove all the objects (the vector keeps its capacity) */
+  void     vector_clear( vector_t v, action_t delete_ );
+  void     vector_delete( vector_t v, action_t delete_ );
+  int      vector_print( vector_t v, action_t print );
+
+  /*
+    Iteration, either through the contents array, which is valid until
+    the next append/reserve/shrink:
+
+      void **data = vector_data( v );
+      for ( i = 0 ; i < vector_length( v ) ; i++ ) ... data[ i ] ...
+
+    or with a callback called on each object in order, which stops on
+    the first non-zero return value (returned by vector_foreach):
+  */
+  void**   vector_data( vector_t v );
+  int      vector_foreach( vector_t v, action_t action );
+
+  /* the list is left untouched */
+  vector_t vector_from_list( list_t l );
+  list_t   vector_to_list( vector_t v );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -13,6 +13,8 @@
 extern "C" {
 #endif
 
+#include <stddef.h> /* size_t */
+
   /*
     This is called a 'forward declaration': the actual definition of  a
     'struct lexem' is in lexem.c:16, and we only manipulate pointers to
@@ -47,6 +49,31 @@ extern "C" {
   int         lexem_line( lexem_t lex );
   int         lexem_column( lexem_t lex );
 
+  /*
+    Trivia flags. In a trivia-free stream (LEX_SKIP_TRIVIA, see lexer.h)
+    there are no blank, newline or comment lexems: the lexem following
+    them records what was skipped before it.
+  */
+#define LEXEM_AFTER_BLANK    0x1 /* blanks were skipped                */
+#define LEXEM_AFTER_NEWLINE  0x2 /* newlines were skipped              */
+#define LEXEM_AFTER_COMMENT  0x4 /* a comment was skipped              */
+#define LEXEM_NEWLINE_FIRST  0x8 /* the skipped trivia started with \n */
+
+  int         lexem_flags( lexem_t lex );
+  void        lexem_set_flags( lexem_t lex, int flags );
+
+  /*
+    Borrowed lexems live in an array owned by someone else (a token
+    buffer, see tokbuf.h): lexem_delete() does nothing on them, and the
+    whole array goes away with lexem_array_delete(). Lists of them can
+    still be deleted with lexem_delete() as the callback.
+  */
+  lexem_t     lexem_array_new( size_t count );
+  lexem_t     lexem_array_at( lexem_t array, size_t i );
+  void        lexem_array_delete( lexem_t array );
+  void        lexem_set( lexem_t lex, const char *type, const char *value, size_t length,
+                         int line, int column, int flags );
+
 
 
   /* Callbacks */
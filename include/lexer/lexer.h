@@ -6,16 +6,92 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <stdio.h>
 #include <generic/list.h> 
+#include <lexer/tokbuf.h>
 
 /* lexer function (Sujet 4.3) :
     lex_defs : path to the file containing lexem definitions
-    source_file : path to the source file to analyze
+    source_file : path to the source file to analyze ("-" for stdin)
     returns a list of lexems found in the source file
+    The source is read in chunks (see reader.h), it can be a pipe.
 */
 list_t lex(char *lex_defs, char *source_file);
 
-/* lex_rule deletion callback */
+/* lex() with options (Sujet 4.3 + extensions) :
+    LEX_SKIP_TRIVIA : blanks ([ \t]+), newlines (\n+) and comments (#^\n*)
+        are skipped by a vectorised scanner instead of the rules, and no
+        lexem is made for them. The next lexem gets LEXEM_AFTER_* flags
+        instead (see lexem.h), the parser accepts both kinds of streams.
+*/
+#define LEX_SKIP_TRIVIA 0x1
+
+/*  LEX_NO_SCANNERS : the rules using a native scanner ("@name", see
+        scanner.h) are ignored, so the regexp rules written after them
+        are used instead. Both must give the same lexems.
+*/
+#define LEX_NO_SCANNERS 0x2
+
+list_t lex_with(char *lex_defs, char *source_file, int options);
+
+/* same, reading an already opened descriptor (left open) */
+list_t lex_fd(char *lex_defs, int fd, int options);
+
+/* same, as a compact token buffer (see tokbuf.h) instead of a list.
+   This is what the lexer actually builds, lists are made from it. */
+tokbuf_t lex_tokens(char *lex_defs, char *source_file, int options);
+
+/* same, handing the tokens out while the source is read : each time
+    `batch` tokens are lexed, their buffer is given to `emit` (which owns
+    it from then on) and a new one is started, the last buffer holding
+    the rest. Returns 0 at the end of the input, -1 on a lexical error
+    or as soon as `emit` returns nonzero.
+*/
+typedef int (*lex_emit_t)(tokbuf_t tokens, void *arg);
+int lex_batched(char *lex_defs, char *source_file, int options,
+                size_t batch, lex_emit_t emit, void *arg);
+
+/* rules of a definitions file, in file order (NULL if it cannot be read) */
+list_t lex_rules_load(char *lex_defs);
+
+/* lex_rule accessors and deletion callback */
+const char *lex_rule_type(void *ptr);
+const char *lex_rule_regex(void *ptr);
+int lex_rule_is_native(void *ptr); /* "@name" rule, see scanner.h */
+struct lex_scanner *lex_rule_scanner(void *ptr); /* its scanner, NULL for a regexp */
 int lex_rule_delete(void *ptr);
 
+/* Per-rule profiling :
+    when enabled (lex_profile_enable(), or PYAS_LEX_PROFILE=1 in the
+    environment) lex() counts for each rule the match attempts, the
+    successes, the zero-length matches, the bytes consumed and the time
+    spent matching. The totals of all the calls to lex() are printed to
+    stderr at exit, most expensive rule first.
+    When disabled it costs a single branch per match attempt.
+
+    The totals are kept per thread, and those of the thread calling
+    exit() are printed: a thread lexing for another one hands its totals
+    over with lex_profile_take(), and the other one adds them to its own
+    with lex_profile_add() once it has joined it (see tokpipe.c).
+    Profiling must be decided (lex_profile_enable() or a first call to
+    lex_profile_enabled()) before such threads start.
+*/
+typedef struct lex_profile *lex_profile_t;
+
+void lex_profile_enable(void);
+int  lex_profile_enabled(void);
+void lex_profile_print(FILE *fp);
+
+/* totals of the calling thread, which starts over from none (NULL if
+   it has none) */
+lex_profile_t lex_profile_take(void);
+
+/* adds totals taken on another thread to those of the calling thread,
+   and frees them */
+void lex_profile_add(lex_profile_t profile);
+
+/* number of lexems produced so far by a rule on the calling thread
+   (0 unless profiling) */
+unsigned long lex_profile_hits(const char *type, const char *regex);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+/**
+ * @file numlit.h
+ * @author Abdellah
+ * @brief Decoding and formatting of number literals
+ */
+#ifndef NUMLIT_H
+#define NUMLIT_H
+
+#include <stddef.h> /* size_t */
+#include <stdint.h>
+
+#define NUMLIT_INVALID  -1
+#define NUMLIT_RANGE    -2
+
+/*
+  Decodes an integer lexem (`length` bytes, no '\0' needed) as the
+  number rules give them (see regexp_file.lex):
+
+    [-]NNN                decimal, leading zeros allowed
+    0xNNN, 0oNNN, 0bNNN   hexadecimal, octal, binary
+
+  in a single pass over the digits.
+
+  Returns 0 with the value in *value, NUMLIT_INVALID if the lexem is not
+  one of the above, or NUMLIT_RANGE if the value does not fit in an
+  int64_t (Python would make it a long).
+*/
+int numlit_int( const char *literal, size_t length, int64_t *value );
+
+/*
+  Decodes an integer lexem of any size, as numlit_int() reads them, into
+  the digits of a marshal long ('l'): base 2^15, least significant
+  first. `digits` must hold NUMLIT_LONG_DIGITS( length ) of them, the
+  sign goes in *negative.
+
+  Returns the number of digits (0 for zero), or NUMLIT_INVALID.
+*/
+#define NUMLIT_LONG_SHIFT 15
+#define NUMLIT_LONG_MASK  0x7fff
+#define NUMLIT_LONG_DIGITS( length ) ( ( length ) * 4 / NUMLIT_LONG_SHIFT + 1 )
+
+int numlit_long( const char *literal, size_t length, uint16_t *digits, int *negative );
+
+/*
+  Decodes a float lexem (`length` bytes, no '\0' needed):
+
+    [-]NNN.NNN[(e|E)[+-]NNN]   the dot or one of its runs of digits
+                               may be left out, not both runs
+
+  into the double nearest to it (ties to even), as strtod() does in the
+  "C" locale: an exponent too large gives an infinity, too small a zero.
+  Most lexems take one or two 64x128-bit products (Eisel-Lemire); those
+  with more than 19 significant digits that the product can not round
+  are left to strtod().
+
+  Returns 0 with the value in *value, or NUMLIT_INVALID.
+*/
+int numlit_float( const char *literal, size_t length, double *value );
+
+/*
+  Writes the shortest decimal that numlit_float() reads back as `value`,
+  the way repr() does in Python: 1.0, 0.1, 1e+16, 1.5e-07, -inf, nan.
+  out must hold NUMLIT_FLOAT_SIZE bytes, it is '\0' terminated.
+
+  Returns the length written.
+*/
+#define NUMLIT_FLOAT_SIZE 32
+
+int numlit_float_format( double value, char *out );
+
+#endif
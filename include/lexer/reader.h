@@ -0,0 +1,42 @@
+/**
+ * @file reader.h
+ * @author Abdellah
+ * @brief Buffered, refillable input for the lexer
+ */
+#ifndef READER_H
+#define READER_H
+
+#include <stddef.h> /* size_t */
+
+/*
+  A reader keeps a sliding window over its input: the bytes between the
+  current position and the end of what has been read so far. The window
+  is always followed by at least READER_PADDING '\0' bytes, so it can be
+  handed to re_match() as a string and scanned 16 bytes at a time.
+
+  Only read(2) is used (no fseek/ftell), so pipes, process substitution
+  and stdin work, and the memory used does not depend on the input size
+  but on the longest lexem.
+*/
+#define READER_PADDING 16
+
+typedef struct reader *reader_t;
+
+/* open a file, "-" meaning the standard input (NULL on error) */
+reader_t reader_open( char *filename );
+
+/* read from an already opened descriptor, which is not closed afterwards */
+reader_t reader_fdopen( int fd );
+
+void     reader_close( reader_t r );
+
+/* make at least n bytes available after the current position, or all
+   the remaining input if there is less. Returns -1 on read error */
+int      reader_require( reader_t r, size_t n );
+
+char    *reader_data( reader_t r );      /* current position             */
+size_t   reader_available( reader_t r ); /* bytes in the window          */
+int      reader_eof( reader_t r );       /* nothing left to read         */
+void     reader_advance( reader_t r, size_t n );
+
+#endif
@@ -0,0 +1,22 @@
+/**
+ * @file reorder.h
+ * @author Abdellah
+ * @brief Profile-guided reordering of the lexer rules
+ */
+#ifndef REORDER_H
+#define REORDER_H
+
+/* lex_rules_reorder :
+    lex_defs : path to the file containing lexem definitions
+    out_file : path of the reordered definitions file to write
+    The lexer keeps the first rule that matches, so two rules only have
+    to keep their relative order when they can match the same text
+    (see re_overlap); a native scanner is only known by the bytes its
+    lexems can start with (see scanner.h). Every other rule is moved up according to the hit
+    counts recorded by the lexer profiler, most used rules first. The
+    resulting file always produces the same lexems as lex_defs.
+    returns 0 on success, -1 on error
+*/
+int lex_rules_reorder(char *lex_defs, char *out_file);
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * @file scanner.h
+ * @author Abdellah
+ * @brief Native scanners usable as lexer rules
+ */
+#ifndef SCANNER_H
+#define SCANNER_H
+
+/*
+  A rule of the definitions file can use a native scanner instead of a
+  regexp, by giving its name after '@' :
+
+    number::*   @number
+
+  The lexer calls it exactly where it would call re_match() for a regexp
+  rule (rules are still tried in file order, first match wins), but one
+  scanner can produce several lexem types, so it tells which one it
+  matched. The regexp rules of these types written after it are not
+  tried anymore (unless the lexer is given LEX_NO_SCANNERS).
+
+  A scan function looks at the text starting at current (the window ends
+  at limit and is followed by '\0'). On success it sets *end after the
+  lexem and returns the index of its type in the scanner's types[].
+  It returns -1 if nothing matches, LEX_SCAN_MORE if it cannot tell
+  without looking past limit (the lexer then reads more input and calls
+  it again, unless the input ends at limit).
+*/
+typedef int (*lex_scan_t)( char *current, char *limit, char **end );
+
+#define LEX_SCAN_MORE (-2)
+
+struct lex_scanner {
+    char       *name;
+    char      **types; /* NULL terminated */
+    lex_scan_t  scan;
+    char       *first; /* the bytes its lexems can start with, NULL: any */
+};
+
+/* add a scanner (the strings are not copied), returns -1 if the name is
+   taken. first is only used to tell which rules it cannot compete with
+   (see reorder.h), NULL if any byte may start one of its lexems. */
+int                 lex_scanner_register( char *name, char **types, lex_scan_t scan, char *first );
+
+/* scanner registered under name, built-in ones included (NULL if none) */
+struct lex_scanner *lex_scanner_find( const char *name );
+
+/*
+  Built-in scanners, they give exactly the lexems of the regexp rules
+  they stand for in include/lexer/regexp_file.lex :
+
+    @number   number::hex, number::bin, number::oct, number::floatexp,
+              number::float, number::uint, number::int (in one pass)
+    @string   string::double, string::single (memchr for the closing quote)
+*/
+int lex_scan_number( char *current, char *limit, char **end );
+int lex_scan_string( char *current, char *limit, char **end );
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * @file strlit.h
+ * @author Abdellah
+ * @brief Decoding of string literals
+ */
+#ifndef STRLIT_H
+#define STRLIT_H
+
+#include <stddef.h> /* size_t */
+
+/*
+  Decodes a string lexem ("..." or '...', quotes included, `length`
+  bytes) into the bytes it stands for, like Python 2 does:
+
+    \n \t \r \a \b \f \v \\ \' \"   the usual control characters
+    \xNN                            one byte, two hexadecimal digits
+    \N, \NN, \NNN                   one byte, in octal
+    \ + newline                     nothing (continued line)
+    \ + anything else               kept as is, backslash included
+
+  out must hold at least `length` bytes (decoding never makes the string
+  longer); it is not '\0' terminated. Runs without backslash are copied
+  in bulk, 16 bytes at a time when SSE2 is available.
+
+  Returns the number of bytes written, or -1 if the lexem is not quoted
+  or a \x escape is not followed by two hexadecimal digits.
+*/
+long strlit_decode( const char *literal, size_t length, char *out );
+
+#endif
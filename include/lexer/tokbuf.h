@@ -0,0 +1,65 @@
+/**
+ * @file tokbuf.h
+ * @author Abdellah
+ * @brief Compact token buffer
+ */
+#ifndef TOKBUF_H
+#define TOKBUF_H
+
+#include <stddef.h> /* size_t */
+
+#include <generic/list.h>
+#include <lexer/lexem.h>
+
+/*
+  A token buffer stores tokens in parallel arrays (struct of arrays)
+  instead of one malloc'd lexem per token:
+
+    type    uint16  index in the table of type names
+    flags   uint8   LEXEM_AFTER_* trivia flags (see lexem.h)
+    offset  uint32  start of the value in the text pool
+    length  uint32  length of the value
+    line    uint16  line, delta-encoded from the previous token
+    column  uint16
+
+  that is 15 bytes per token, plus the value itself in a text pool where
+  values are stored back to back, each one followed by '\0'. Tokens are
+  numbered from 0, any of them can be read at any time, and walking
+  them in order reads each array sequentially.
+*/
+typedef struct tokbuf *tokbuf_t;
+
+tokbuf_t    tokbuf_new( void );
+/* an empty buffer with the same type ids as `model` */
+tokbuf_t    tokbuf_new_like( tokbuf_t model );
+int         tokbuf_delete( void *tb ); /* callback */
+
+/* id of a type name, added to the table if needed (-1 if it is full) */
+int         tokbuf_type_id( tokbuf_t tb, const char *type );
+
+/* append a token, value being `length` bytes long. Returns its index */
+size_t      tokbuf_append( tokbuf_t tb, int type_id, const char *value, size_t length,
+                           int line, int column, int flags );
+
+size_t      tokbuf_count( tokbuf_t tb );
+int         tokbuf_type_of( tokbuf_t tb, size_t i );
+const char *tokbuf_type( tokbuf_t tb, size_t i );
+const char *tokbuf_value( tokbuf_t tb, size_t i );
+size_t      tokbuf_length( tokbuf_t tb, size_t i );
+int         tokbuf_line( tokbuf_t tb, size_t i );
+int         tokbuf_column( tokbuf_t tb, size_t i );
+int         tokbuf_flags( tokbuf_t tb, size_t i );
+
+/* a new lexem holding a copy of token i */
+lexem_t     tokbuf_lexem( tokbuf_t tb, size_t i );
+
+/* a lexem of token i, borrowed from the buffer (see lexem.h): no
+   allocation per token, valid until the buffer is deleted. Each call
+   takes a new one, so a token should be viewed once. */
+lexem_t     tokbuf_view( tokbuf_t tb, size_t i );
+
+/* conversions from/to lists of lexems (the list is not modified) */
+list_t      tokbuf_to_list( tokbuf_t tb );
+tokbuf_t    tokbuf_from_list( list_t lexems );
+
+#endif
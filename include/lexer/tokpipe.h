@@ -0,0 +1,47 @@
+/**
+ * @file tokpipe.h
+ * @author Abdellah
+ * @brief Lexer running on its own thread
+ */
+#ifndef TOKPIPE_H
+#define TOKPIPE_H
+
+#include <lexer/tokbuf.h>
+
+/*
+  A token pipe lexes a source file on a thread of its own while the
+  tokens are read (parsed) on the calling thread. The lexer hands its
+  tokens out in buffers of TOKPIPE_BATCH tokens (the last one may be
+  shorter) through a bounded queue (see ring.h): when the reader is
+  TOKPIPE_QUEUE buffers behind, the lexer waits for it.
+
+  The buffers read are kept by the pipe until it is deleted, so their
+  tokens (and the lexems borrowed from them, see tokbuf_view()) stay
+  valid as long as the pipe.
+
+  If the calling thread has a current arena (see arena.h), the lexer
+  thread gets a scratch arena of its own, deleted when it is done.
+*/
+#define TOKPIPE_BATCH_SHIFT 12
+#define TOKPIPE_BATCH       (1 << TOKPIPE_BATCH_SHIFT)
+#define TOKPIPE_QUEUE       64
+
+typedef struct tokpipe *tokpipe_t;
+
+/* starts lexing, options as for lex_tokens() (see lexer.h).
+   NULL if the thread could not be started. */
+tokpipe_t   tokpipe_open( char *lex_defs, char *source_file, int options );
+
+/* next buffer of tokens, waiting for it if needed. NULL at the end of
+   the tokens, whether the input ended or the lexer failed. */
+tokbuf_t    tokpipe_next( tokpipe_t p );
+
+/* waits for the lexer to be done, the tokens not read yet are dropped.
+   0 if the whole input was lexed into at least one token, -1 if not
+   (when lex_tokens() would return NULL or an empty buffer). */
+int         tokpipe_finish( tokpipe_t p );
+
+/* finishes, then frees the pipe and every buffer it handed out */
+void        tokpipe_delete( tokpipe_t p );
+
+#endif
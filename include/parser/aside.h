@@ -0,0 +1,52 @@
+/**
+ * @file aside.h
+ * @author Abdellah
+ * @brief Data kept aside for code objects.
+ *
+ * What the parser hands to pyasm and struct pyobj has no room for.
+ */
+
+#ifndef ASIDE_H
+#define ASIDE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <generic/callbacks.h>
+#include <parser/pyobj.h>
+
+  /*
+    A code object may have one piece of data of each kind kept aside:
+    its instruction records (see insn.h) and its constant stream (see
+    conststream.h). The data belongs to the code object, it is deleted
+    (with the callback given with it) either when it is taken back, by
+    pyobj_delete() for one, or when the code object goes away with its
+    arena.
+
+    The arena is the one current (see arena.h) when the first piece of
+    data of the code object is put aside, which is where the parser has
+    just allocated it: once that arena is reset or deleted, nothing is
+    left aside for its code objects, and an address taken again by a
+    new code object finds nothing. Code objects allocated without an
+    arena must be deleted with pyobj_delete(); what is left aside for
+    them at exit is deleted then.
+   */
+#define ASIDE_INSN   0 /* insn_list_t */
+#define ASIDE_CONSTS 1 /* conststream_t */
+#define ASIDE_KINDS  2
+
+  /* data of a kind for the code object (a previous one is deleted) */
+  void  aside_put( pyobj_t code, int kind, void *data, action_t delete_ );
+
+  /* NULL if none */
+  void *aside_get( pyobj_t code, int kind );
+
+  /* same, and the data is not the code object's anymore */
+  void *aside_take( pyobj_t code, int kind );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
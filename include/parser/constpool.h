@@ -0,0 +1,63 @@
+/**
+ * @file constpool.h
+ * @author Abdellah
+ * @brief Constant pools.
+ *
+ * Structural hashing and equality of python objects, merging of
+ * duplicate constants and names.
+ */
+
+#ifndef CONSTPOOL_H
+#define CONSTPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include <parser/pyobj.h>
+#include <parser/insn.h>
+
+  /*
+    Two objects are equal when they would load as the same constant:
+    same type (1, 1L, 1.0 and True all differ), same value, and for
+    tuples and lists the same length and equal items. Floats are
+    compared by bit pattern, so 0.0 and -0.0 differ and a NaN equals
+    itself. Code objects are only equal to themselves.
+    Equal objects have the same hash.
+   */
+  uint64_t pyobj_hash( pyobj_t obj );
+  int      pyobj_equal( pyobj_t a, pyobj_t b );
+
+  /*
+    Merging keeps the first of equal entries of a table, in order, and
+    renumbers the operands of the instructions that index it:
+
+      CONSTPOOL_CONSTS  .consts, for LOAD_CONST. Only immutable
+                        constants are merged (not lists nor code
+                        objects, whose identity can be seen).
+      CONSTPOOL_NAMES   .names, for the *_NAME, *_ATTR, *_GLOBAL and
+                        IMPORT_* instructions.
+
+    .varnames are left alone: each entry is a slot of its own, two
+    locals with the same name are still two locals. A table is also
+    left alone if an instruction indexes past its end.
+
+    Returns how many entries were removed.
+   */
+#define CONSTPOOL_CONSTS 0x1
+#define CONSTPOOL_NAMES  0x2
+
+  int      constpool_merge( pyobj_t code, insn_list_t records, int flags );
+
+  /* pyasm() merges the tables of each code object with these flags
+     (none by default) */
+  void     constpool_enable( int flags );
+  int      constpool_enabled( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
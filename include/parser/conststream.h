@@ -0,0 +1,80 @@
+/**
+ * @file conststream.h
+ * @author Abdellah
+ * @brief Constant streams.
+ *
+ * .consts tables encoded as marshal bytes while they are parsed.
+ */
+
+#ifndef CONSTSTREAM_H
+#define CONSTSTREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h> /* size_t */
+#include <stdint.h>
+#include <stdio.h>
+
+#include <parser/pyobj.h>
+
+  /*
+    A .consts table made of marshal bytes, the ones pyobj_write() would
+    write for its constants, rather than of objects: there is no object
+    nor list link per constant, the table takes about the room it takes
+    in the .pyc.
+
+    Constants are added one after the other, collections as an opening,
+    their items and a closing. What pyasm needs is kept on the side: the
+    number of constants (the LOAD_CONST operands below it) and the code
+    objects, each with the offset where it is written once assembled.
+   */
+  typedef struct conststream *conststream_t;
+
+  conststream_t conststream_new( void );
+  void          conststream_delete( conststream_t s );
+
+  void          conststream_none( conststream_t s );
+  void          conststream_bool( conststream_t s, int value );
+  void          conststream_int( conststream_t s, int64_t value ); /* 'i', or 'I' past 32 bits */
+  /* 'l': digits in base 2^15, least significant first (see numlit.h) */
+  void          conststream_long( conststream_t s, int negative, const uint16_t *digits, size_t count );
+  void          conststream_float( conststream_t s, double value );
+  void          conststream_string( conststream_t s, const char *bytes, size_t length );
+  void          conststream_list_open( conststream_t s );
+  void          conststream_list_close( conststream_t s );
+  /* the stream does not own the code object */
+  void          conststream_code( conststream_t s, pyobj_t code );
+
+  size_t        conststream_count( conststream_t s );      /* constants in the table */
+  size_t        conststream_size( conststream_t s );       /* bytes, code objects aside */
+  size_t        conststream_code_count( conststream_t s );
+  pyobj_t       conststream_code_at( conststream_t s, size_t i );
+
+  /* the table as a marshal tuple, write_code() writing the code objects */
+  int           conststream_write( conststream_t s, FILE *fp, int (*write_code)( FILE *, pyobj_t ) );
+
+  /*
+    The stream of a code object is kept aside (see aside.h), its .consts
+    is left an empty list. conststream_of() finds it, conststream_detach()
+    also takes it back (when the code object is deleted). It goes with
+    the arena of the code object otherwise.
+   */
+  void          conststream_attach( pyobj_t code, conststream_t s );
+  conststream_t conststream_of( pyobj_t code );     /* NULL if none */
+  conststream_t conststream_detach( pyobj_t code ); /* NULL if none */
+
+  /*
+    The parser streams the .consts tables when enabled (not by default).
+    constpool_merge() leaves streamed tables as they are: there are no
+    objects left in them to compare.
+   */
+  void          conststream_enable( int on );
+  int           conststream_enabled( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * @file insn.h
+ * @author Abdellah
+ * @brief Instruction records.
+ *
+ * Compact form of the .text section, made by the parser for pyasm.
+ */
+
+#ifndef INSN_H
+#define INSN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h> /* size_t */
+#include <stdint.h>
+
+#include <generic/list.h>
+#include <parser/pyobj.h>
+
+  /*
+    The .text section as an array of fixed-size records, one per
+    instruction, label definition or .line directive, in source order.
+    Everything pyasm needs is decoded by the parser: the opcode, the
+    operand (a number, or the ID of the label it names) and the line,
+    so assembling is a loop over contiguous memory without strings.
+
+    Labels are numbered from 0 in order of first appearance, as a
+    definition or as an operand. Their names are interned (see
+    intern.h).
+   */
+
+  /* kinds of records: */
+#define INSN_OP    0 /* opcode, and operand if arg_kind is not INSN_ARG_NONE */
+#define INSN_LABEL 1 /* definition of label `arg` here */
+#define INSN_LINE  2 /* .line `arg` */
+
+  /* kinds of operands: */
+#define INSN_ARG_NONE   0
+#define INSN_ARG_VALUE  1 /* arg is the value */
+#define INSN_ARG_LABEL  2 /* arg is a label ID (the operand was a symbol) */
+#define INSN_ARG_STRING 3 /* same, but the operand was a string literal */
+
+  typedef struct {
+    uint8_t kind;
+    uint8_t opcode;
+    uint8_t arg_kind;
+    uint8_t unused;
+    int32_t arg;
+    int32_t line;    /* source line of the instruction */
+  } insn_t;
+
+  typedef struct insn_list *insn_list_t;
+
+  insn_list_t   insn_list_new( void );
+  void          insn_list_delete( insn_list_t l );
+
+  size_t        insn_count( insn_list_t l );
+  const insn_t *insn_data( insn_list_t l ); /* insn_count() records */
+  void          insn_append( insn_list_t l, int kind, int opcode, int arg_kind, int32_t arg, int line );
+  /* operand of record i (the constant or name tables were renumbered) */
+  void          insn_set_arg( insn_list_t l, size_t i, int32_t arg );
+
+  /* ID of a label (name without ':', interned or not), added if needed */
+  int           insn_label_id( insn_list_t l, const char *name, size_t length );
+  size_t        insn_label_count( insn_list_t l );
+  const char   *insn_label_name( insn_list_t l, int id );
+
+  /* opcode written in an instruction type ("insn::1::0x64", etc.) */
+  int           insn_opcode_of_type( const char *type );
+  /* value of a numeric operand, as pyasm always read them */
+  int32_t       insn_value_of( const char *value );
+
+  /* records of a list of lexems as the parser builds it, NULL if an
+     instruction has no operand */
+  insn_list_t   insn_lower( list_t lexems );
+
+  /*
+    The records of a code object are kept aside (see aside.h) until
+    pyasm takes them, or the code object is deleted or released with
+    its arena.
+   */
+  void          insn_attach( pyobj_t code, insn_list_t l );
+  insn_list_t   insn_detach( pyobj_t code ); /* NULL if none */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
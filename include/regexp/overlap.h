@@ -0,0 +1,43 @@
+/**
+ * @file overlap.h
+ * @author Abdellah
+ * @brief Regexp overlap analysis
+ */
+#ifndef OVERLAP_H
+#define OVERLAP_H
+
+/* re_overlap :
+    tells whether two regexps can both match a non-empty prefix of the
+    same text, i.e. whether there exist u (matched by regexp1) and v
+    (matched by regexp2), both non-empty, such that one is a prefix of
+    the other.
+    When two lexer rules do not overlap, the lexer can never have to
+    choose between them and their relative order does not matter.
+    returns 1 if they overlap, 0 if they never do, -1 if a regexp is
+    invalid or too long to be analysed (callers should assume overlap)
+*/
+int re_overlap(char *regexp1, char *regexp2);
+
+/* re_first_bytes :
+    sets first[c] to 1 for every byte c a non-empty text matched by the
+    regexp can start with, and to 0 for the others (first[0] is 0).
+    Two rules whose first bytes differ never overlap: this is how a
+    regexp is compared with a native scanner (see scanner.h).
+    returns 0, or -1 if the regexp is too long to be analysed (first is
+    then all ones). An invalid regexp matches nothing: all zeros.
+*/
+int re_first_bytes(char *regexp, char first[256]);
+
+/* re_goes_on :
+    tells whether a match of regexp at text could still go on after
+    limit, i.e. whether [text, limit) is the beginning of some text the
+    regexp matches. A '\0' before limit stops it, as it does re_match().
+    When it does not, whatever follows limit cannot change the result of
+    re_match() at text.
+    returns 1 if it could, 0 if not (always for an invalid regexp, which
+    re_match() never matches), -1 if the regexp is too long to be
+    analysed (callers should assume it could)
+*/
+int re_goes_on(char *regexp, char *text, char *limit);
+
+#endif
@@ -0,0 +1,348 @@
+/**
+ * @file arena.c
+ * @author Abdellah
+ * @brief Arenas.
+ *
+ * Bump allocation with checkpoints and whole-arena reset.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <generic/arena.h>
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN      16
+
+/* Chunks are aligned on granules and made of whole ones: the granule of
+   a pointer is its address with the low bits off. */
+#define ARENA_GRANULE    ( (size_t)64 * 1024 )
+#define ARENA_GRANULES   65536 /* slots of the granule table, a power of two */
+#define ARENA_PROBES     64    /* a granule is at most that far from its slot */
+#define GRANULE_GONE     ( (uintptr_t)1 )
+
+/*
+  Chunks are stacked, the most recent one on top: a checkpoint is the
+  top chunk and how much of it was used, rewinding pops the chunks
+  above it. One popped chunk is kept aside for the next allocations, so
+  that a loop of mark/allocate/rewind does not call malloc() each time.
+ */
+struct chunk {
+  struct chunk *prev;
+  size_t        size;
+  size_t        used;
+  size_t        pad; /* data starts 16-byte aligned */
+};
+
+/* called at the next reset, see arena_on_reset() */
+struct cleanup {
+  struct cleanup *next;
+  action_t        action;
+  void           *arg;
+};
+
+struct arena_t {
+  struct chunk   *top;
+  struct chunk   *spare;
+  size_t          chunk_size;
+  size_t          allocations;
+  size_t          bytes;
+  struct cleanup *cleanups; /* the last one added first */
+};
+
+/*
+  The granules of all the chunks of all the arenas, whatever the thread,
+  so that unit_free() tells their memory from malloc()'s. Open
+  addressing on the granule addresses: a freed granule leaves
+  GRANULE_GONE in its slot, taken again by the next one, so a granule is
+  never moved and lookups need no lock (only changes take it).
+ */
+static struct {
+  pthread_mutex_t  lock;
+  atomic_uintptr_t slots[ ARENA_GRANULES ];
+} granules = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static size_t granule_slot( uintptr_t granule ) {
+  return (size_t)( ( granule / ARENA_GRANULE ) * 2654435761u ) & ( ARENA_GRANULES - 1 );
+}
+
+static int granule_owned( const void *p ) {
+  uintptr_t granule = (uintptr_t)p & ~(uintptr_t)( ARENA_GRANULE - 1 );
+  size_t    i       = granule_slot( granule ), n;
+
+  for ( n = 0 ; n < ARENA_PROBES ; n++, i = ( i + 1 ) & ( ARENA_GRANULES - 1 ) ) {
+    uintptr_t g = atomic_load_explicit( &granules.slots[ i ], memory_order_acquire );
+
+    if ( g == granule ) return 1;
+    if ( !g ) return 0;
+  }
+
+  return 0;
+}
+
+/* the granules of `bytes` from c, on (1) or off (0) */
+static void granules_mark( struct chunk *c, size_t bytes, int on ) {
+  uintptr_t granule;
+
+  pthread_mutex_lock( &granules.lock );
+  for ( granule = (uintptr_t)c ; granule < (uintptr_t)c + bytes ; granule += ARENA_GRANULE ) {
+    size_t i = granule_slot( granule ), n;
+
+    for ( n = 0 ; n < ARENA_PROBES ; n++, i = ( i + 1 ) & ( ARENA_GRANULES - 1 ) ) {
+      uintptr_t g = atomic_load_explicit( &granules.slots[ i ], memory_order_relaxed );
+
+      if ( on ? g <= GRANULE_GONE : g == granule ) break;
+    }
+    assert( n < ARENA_PROBES );
+    atomic_store_explicit( &granules.slots[ i ], on ? granule : GRANULE_GONE, memory_order_release );
+  }
+  pthread_mutex_unlock( &granules.lock );
+}
+
+static size_t chunk_bytes( size_t size ) {
+  return ( sizeof( struct chunk ) + size + ARENA_GRANULE - 1 ) & ~( ARENA_GRANULE - 1 );
+}
+
+static void chunk_free( struct chunk *c ) {
+  if ( !c ) return;
+
+  /* before the memory may be handed out by malloc() */
+  granules_mark( c, chunk_bytes( c->size ), 0 );
+  free( c );
+}
+
+static char *chunk_data( struct chunk *c ) {
+  return (char *)( c + 1 );
+}
+
+arena_t arena_new( size_t chunk_size ) {
+  arena_t a     = calloc( 1, sizeof( *a ) );
+  size_t  bytes = chunk_size ? chunk_size : ARENA_CHUNK_SIZE;
+
+  assert( a );
+
+  /* what whole granules hold, header aside */
+  bytes = chunk_bytes( bytes > sizeof( struct chunk ) ? bytes - sizeof( struct chunk ) : 0 );
+  a->chunk_size = bytes - sizeof( struct chunk );
+
+  return a;
+}
+
+void    arena_delete( arena_t a ) {
+
+  if ( !a ) return;
+
+  arena_reset( a );
+  chunk_free( a->spare );
+  free( a );
+}
+
+static struct chunk *chunk_new( arena_t a, size_t size ) {
+  struct chunk *c;
+  void         *p;
+
+  if ( size <= a->chunk_size && a->spare ) {
+    c = a->spare;
+    a->spare = NULL;
+  }
+  else {
+    size_t bytes = chunk_bytes( size < a->chunk_size ? a->chunk_size : size );
+
+    if ( posix_memalign( &p, ARENA_GRANULE, bytes ) ) p = NULL;
+    assert( p );
+    c = p;
+    c->size = bytes - sizeof( *c );
+    granules_mark( c, bytes, 1 );
+  }
+
+  c->used = 0;
+  c->prev = a->top;
+  a->top  = c;
+
+  return c;
+}
+
+static void chunk_pop( arena_t a ) {
+  struct chunk *c = a->top;
+
+  a->top = c->prev;
+
+  if ( !a->spare && c->size == a->chunk_size ) {
+    a->spare = c;
+  }
+  else {
+    chunk_free( c );
+  }
+}
+
+void   *arena_alloc( arena_t a, size_t size ) {
+  struct chunk *c;
+  size_t        start;
+
+  assert( a );
+
+  c = a->top;
+  size  = size ? size : 1;
+  start = c ? ( c->used + ARENA_ALIGN - 1 ) & ~(size_t)( ARENA_ALIGN - 1 ) : 0;
+
+  if ( !c || start + size > c->size ) {
+    c     = chunk_new( a, size );
+    start = 0;
+  }
+
+  c->used = start + size;
+  a->allocations++;
+  a->bytes += size;
+
+  return chunk_data( c ) + start;
+}
+
+void   *arena_calloc( arena_t a, size_t count, size_t size ) {
+  void *p;
+
+  assert( !size || count <= (size_t)-1 / size );
+
+  p = arena_alloc( a, count * size );
+  memset( p, 0, count * size );
+
+  return p;
+}
+
+char   *arena_strdup( arena_t a, const char *s ) {
+  size_t len = strlen( s ) + 1;
+
+  return memcpy( arena_alloc( a, len ), s, len );
+}
+
+arena_mark_t arena_mark( arena_t a ) {
+  arena_mark_t mark;
+
+  assert( a );
+
+  mark.chunk = a->top;
+  mark.used  = a->top ? a->top->used : 0;
+
+  return mark;
+}
+
+void    arena_rewind( arena_t a, arena_mark_t mark ) {
+
+  assert( a );
+
+  while ( a->top && a->top != mark.chunk ) chunk_pop( a );
+
+  if ( a->top ) a->top->used = mark.used;
+}
+
+void    arena_on_reset( arena_t a, action_t cleanup, void *arg ) {
+  struct cleanup *c = malloc( sizeof( *c ) );
+
+  assert( a && cleanup && c );
+
+  c->action   = cleanup;
+  c->arg      = arg;
+  c->next     = a->cleanups;
+  a->cleanups = c;
+}
+
+void    arena_reset( arena_t a ) {
+  arena_mark_t empty = { NULL, 0 };
+
+  /* a cleanup may add another one */
+  while ( a->cleanups ) {
+    struct cleanup *c = a->cleanups;
+
+    a->cleanups = c->next;
+    c->action( c->arg );
+    free( c );
+  }
+
+  arena_rewind( a, empty );
+  a->allocations = 0;
+  a->bytes       = 0;
+}
+
+int     arena_owns( arena_t a, const void *p ) {
+  const char   *q = p;
+  struct chunk *c;
+
+  assert( a );
+
+  for ( c = a->top ; c ; c = c->prev ) {
+    if ( q >= chunk_data( c ) && q < chunk_data( c ) + c->used ) return 1;
+  }
+
+  return 0;
+}
+
+size_t  arena_allocations( arena_t a ) {
+  return a->allocations;
+}
+
+size_t  arena_bytes( arena_t a ) {
+  return a->bytes;
+}
+
+
+/*
+  Memory of the compilation unit, per thread:
+ */
+#ifdef __GNUC__
+static __thread arena_t current = NULL;
+#else
+static arena_t current = NULL;
+#endif
+
+arena_t arena_current( void ) {
+  return current;
+}
+
+arena_t arena_set_current( arena_t a ) {
+  arena_t previous = current;
+
+  current = a;
+
+  return previous;
+}
+
+void   *unit_malloc( size_t size ) {
+  void *p;
+
+  if ( current ) return arena_alloc( current, size );
+
+  p = malloc( size );
+  assert( p );
+
+  return p;
+}
+
+void   *unit_calloc( size_t count, size_t size ) {
+  void *p;
+
+  if ( current ) return arena_calloc( current, count, size );
+
+  p = calloc( count, size );
+  assert( p );
+
+  return p;
+}
+
+char   *unit_strdup( const char *s ) {
+  char *p;
+
+  if ( current ) return arena_strdup( current, s );
+
+  p = strdup( s );
+  assert( p );
+
+  return p;
+}
+
+/* by where the memory comes from, not by the arena current */
+void    unit_free( void *ptr ) {
+  if ( ptr && !granule_owned( ptr ) ) free( ptr );
+}
@@ -0,0 +1,130 @@
+/**
+ * @file chain.c
+ * @author Abdellah
+ * @brief Lists with a header.
+ *
+ * Lists that know their last link and their length.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <generic/chain.h>
+#include <generic/linkpool.h>
+
+/* Same layout as in `src/list.c`: */
+struct link_t {
+  void          *contents;
+  struct link_t *next;
+};
+
+struct chain_t {
+  struct link_t *first;
+  struct link_t *last;
+  size_t         length;
+};
+
+chain_t chain_new( void ) {
+  chain_t c = calloc( 1, sizeof( *c ) );
+
+  assert( c );
+
+  return c;
+}
+
+int     chain_is_empty( chain_t c ) {
+  assert( c );
+  return 0 == c->length;
+}
+
+size_t  chain_length( chain_t c ) {
+  assert( c );
+  return c->length;
+}
+
+void*   chain_first( chain_t c ) {
+  assert( c && c->first );
+  return c->first->contents;
+}
+
+void*   chain_last( chain_t c ) {
+  assert( c && c->last );
+  return c->last->contents;
+}
+
+void    chain_add_first( chain_t c, void *object ) {
+  assert( c );
+
+  c->first = list_add_first( object, c->first );
+  if ( !c->last ) c->last = c->first;
+  c->length++;
+}
+
+void    chain_add_last( chain_t c, void *object ) {
+  struct link_t *link;
+
+  assert( c );
+
+  link = link_alloc();
+  assert( link );
+
+  link->contents = object;
+  link->next     = NULL;
+
+  if ( c->last ) c->last->next = link;
+  else           c->first      = link;
+
+  c->last = link;
+  c->length++;
+}
+
+void    chain_move_next( chain_t c, list_t before ) {
+  struct link_t *link;
+
+  assert( c && before && before->next );
+
+  link         = before->next;
+  before->next = link->next;
+  link->next   = NULL;
+
+  if ( c->last ) c->last->next = link;
+  else           c->first      = link;
+
+  c->last = link;
+  c->length++;
+}
+
+list_t  chain_list( chain_t c ) {
+  assert( c );
+  return c->first;
+}
+
+chain_t chain_from_list( list_t l ) {
+  chain_t c = chain_new();
+
+  c->first = l;
+  for ( ; l ; l = l->next ) {
+    c->last = l;
+    c->length++;
+  }
+
+  return c;
+}
+
+list_t  chain_to_list( chain_t c ) {
+  list_t l;
+
+  assert( c );
+
+  l = c->first;
+  free( c );
+
+  return l;
+}
+
+void    chain_delete( chain_t c, action_t delete_ ) {
+  if ( !c ) return;
+
+  list_delete( c->first, delete_ );
+  free( c );
+}
@@ -0,0 +1,268 @@
+/**
+ * @file hashmap.c
+ * @author Abdellah
+ * @brief Hash maps.
+ *
+ * Hash maps from strings or integers to generic pointers.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <generic/hashmap.h>
+
+#define HASHMAP_MIN_CAPACITY 16
+
+/* An entry is empty when its hash is 0 (real hashes never are): */
+struct entry {
+  uint64_t  hash;
+  void     *value;
+  union {
+    char     *str;
+    uint64_t  num;
+  } key;
+  size_t    length;
+};
+
+struct hashmap_t {
+  struct entry *entries;
+  size_t        capacity; /* a power of two */
+  size_t        length;
+  int           int_keys;
+};
+
+/* FNV-1a for strings, the splitmix64 finaliser for integers: */
+static uint64_t hash_string( const char *key, size_t length ) {
+  uint64_t h = 14695981039346656037ULL;
+  size_t   i;
+
+  for ( i = 0 ; i < length ; i++ ) {
+    h ^= (unsigned char)key[ i ];
+    h *= 1099511628211ULL;
+  }
+
+  return h ? h : 1;
+}
+
+static uint64_t hash_int( uint64_t key ) {
+  key ^= key >> 30; key *= 0xbf58476d1ce4e5b9ULL;
+  key ^= key >> 27; key *= 0x94d049bb133111ebULL;
+  key ^= key >> 31;
+
+  return key ? key : 1;
+}
+
+static hashmap_t hashmap_alloc( int int_keys ) {
+  hashmap_t m = calloc( 1, sizeof( *m ) );
+
+  assert( m );
+
+  m->int_keys = int_keys;
+
+  return m;
+}
+
+hashmap_t hashmap_new( void ) {
+  return hashmap_alloc( 0 );
+}
+
+hashmap_t hashmap_new_int( void ) {
+  return hashmap_alloc( 1 );
+}
+
+void      hashmap_delete( hashmap_t m, action_t delete_ ) {
+  size_t i;
+
+  if ( !m ) return;
+
+  for ( i = 0 ; i < m->capacity ; i++ ) {
+    struct entry *e = &m->entries[ i ];
+    if ( !e->hash ) continue;
+    if ( delete_ ) delete_( e->value );
+    if ( !m->int_keys ) free( e->key.str );
+  }
+
+  free( m->entries );
+  free( m );
+}
+
+size_t    hashmap_length( hashmap_t m ) {
+
+  assert( m );
+
+  return m->length;
+}
+
+static int same_key( hashmap_t m, struct entry *e, uint64_t hash,
+                     const char *key, size_t length, uint64_t num ) {
+  if ( e->hash != hash ) return 0;
+  if ( m->int_keys ) return e->key.num == num;
+  return e->length == length && 0 == memcmp( e->key.str, key, length );
+}
+
+/* slot of the key, or of the empty entry where it would go */
+static size_t probe( hashmap_t m, uint64_t hash, const char *key, size_t length, uint64_t num ) {
+  size_t mask = m->capacity - 1;
+  size_t i    = hash & mask;
+
+  while ( m->entries[ i ].hash && !same_key( m, &m->entries[ i ], hash, key, length, num ) ) {
+    i = ( i + 1 ) & mask;
+  }
+
+  return i;
+}
+
+static void hashmap_resize( hashmap_t m, size_t capacity ) {
+  struct entry *old      = m->entries;
+  size_t        old_size = m->capacity;
+  size_t        i;
+
+  m->entries  = calloc( capacity, sizeof( *m->entries ) );
+  assert( m->entries );
+  m->capacity = capacity;
+
+  for ( i = 0 ; i < old_size ; i++ ) {
+    if ( old[ i ].hash ) {
+      size_t mask = capacity - 1;
+      size_t j    = old[ i ].hash & mask;
+      while ( m->entries[ j ].hash ) j = ( j + 1 ) & mask;
+      m->entries[ j ] = old[ i ];
+    }
+  }
+
+  free( old );
+}
+
+void      hashmap_reserve( hashmap_t m, size_t count ) {
+  size_t capacity = m->capacity ? m->capacity : HASHMAP_MIN_CAPACITY;
+
+  /* At most 3/4 full: */
+  while ( 4 * count > 3 * capacity ) capacity *= 2;
+
+  if ( capacity > m->capacity ) hashmap_resize( m, capacity );
+}
+
+static int put( hashmap_t m, uint64_t hash, const char *key, size_t length, uint64_t num, void *value ) {
+  struct entry *e;
+
+  hashmap_reserve( m, m->length + 1 );
+
+  e = &m->entries[ probe( m, hash, key, length, num ) ];
+  if ( e->hash ) {
+    e->value = value;
+    return 0;
+  }
+
+  e->hash   = hash;
+  e->value  = value;
+  e->length = length;
+  if ( m->int_keys ) {
+    e->key.num = num;
+  }
+  else {
+    e->key.str = malloc( length + 1 );
+    assert( e->key.str );
+    memcpy( e->key.str, key, length );
+    e->key.str[ length ] = '\0';
+  }
+  m->length++;
+
+  return 1;
+}
+
+static int find( hashmap_t m, uint64_t hash, const char *key, size_t length, uint64_t num, void **value ) {
+  struct entry *e;
+
+  if ( 0 == m->length ) return 0;
+
+  e = &m->entries[ probe( m, hash, key, length, num ) ];
+  if ( !e->hash ) return 0;
+
+  if ( value ) *value = e->value;
+  return 1;
+}
+
+/* Linear probing without tombstones: the entries after the removed one
+   are shifted back when their own slot allows it. */
+static int remove_entry( hashmap_t m, uint64_t hash, const char *key, size_t length, uint64_t num, action_t delete_ ) {
+  size_t mask, i, j;
+
+  if ( 0 == m->length ) return 0;
+
+  mask = m->capacity - 1;
+  i    = probe( m, hash, key, length, num );
+  if ( !m->entries[ i ].hash ) return 0;
+
+  if ( delete_ ) delete_( m->entries[ i ].value );
+  if ( !m->int_keys ) free( m->entries[ i ].key.str );
+
+  for ( j = ( i + 1 ) & mask ; m->entries[ j ].hash ; j = ( j + 1 ) & mask ) {
+    size_t home = m->entries[ j ].hash & mask;
+    /* can the entry at j move to i ? (home not in the cyclic range ]i, j]) */
+    int stays = ( i <= j ) ? ( i < home && home <= j ) : ( i < home || home <= j );
+    if ( !stays ) {
+      m->entries[ i ] = m->entries[ j ];
+      i = j;
+    }
+  }
+
+  memset( &m->entries[ i ], 0, sizeof( m->entries[ i ] ) );
+  m->length--;
+
+  return 1;
+}
+
+int       hashmap_put( hashmap_t m, const char *key, size_t length, void *value ) {
+  assert( m && !m->int_keys );
+  return put( m, hash_string( key, length ), key, length, 0, value );
+}
+
+int       hashmap_find( hashmap_t m, const char *key, size_t length, void **value ) {
+  assert( m && !m->int_keys );
+  return find( m, hash_string( key, length ), key, length, 0, value );
+}
+
+int       hashmap_remove( hashmap_t m, const char *key, size_t length, action_t delete_ ) {
+  assert( m && !m->int_keys );
+  return remove_entry( m, hash_string( key, length ), key, length, 0, delete_ );
+}
+
+void*     hashmap_get( hashmap_t m, const char *key ) {
+  void *value = NULL;
+
+  hashmap_find( m, key, strlen( key ), &value );
+
+  return value;
+}
+
+int       hashmap_put_int( hashmap_t m, uint64_t key, void *value ) {
+  assert( m && m->int_keys );
+  return put( m, hash_int( key ), NULL, 0, key, value );
+}
+
+int       hashmap_find_int( hashmap_t m, uint64_t key, void **value ) {
+  assert( m && m->int_keys );
+  return find( m, hash_int( key ), NULL, 0, key, value );
+}
+
+int       hashmap_remove_int( hashmap_t m, uint64_t key, action_t delete_ ) {
+  assert( m && m->int_keys );
+  return remove_entry( m, hash_int( key ), NULL, 0, key, delete_ );
+}
+
+int       hashmap_foreach( hashmap_t m, action_t action ) {
+  size_t i;
+  int    ret;
+
+  assert( m && action );
+
+  for ( i = 0 ; i < m->capacity ; i++ ) {
+    if ( m->entries[ i ].hash ) {
+      ret = action( m->entries[ i ].value );
+      if ( ret ) return ret;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,288 @@
+/**
+ * @file intern.c
+ * @author Abdellah
+ * @brief String interning.
+ *
+ * One canonical copy of each string.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <generic/hashmap.h>
+#include <generic/vector.h>
+#include <generic/intern.h>
+
+/* Canonical strings are bump-allocated in chunks of this size, aligned
+   on it: the chunk of a string is its address with the low bits off. */
+#define INTERN_CHUNK_SIZE ( (size_t)1024 * 1024 )
+#define INTERN_CHUNKS     4096  /* slots of the chunk table, a power of two */
+#define INTERN_ID_BLOCK   16384 /* IDs per block of the ID table */
+#define INTERN_ID_BLOCKS  4096
+#define INTERN_CACHE      256   /* per thread, a power of two */
+
+/* Each canonical string is preceded by its ID and length: */
+struct header {
+  uint32_t id;
+  uint32_t length;
+};
+
+/*
+  Only new strings take the lock. What readers look at without it is
+  written before it is published:
+  - the IDs are in blocks that never move, an ID is published by the
+    release store of `count` after its slot is written;
+  - the chunk table is open addressing on the chunk addresses, whose
+    slots are only written once (until intern_release());
+  - each thread keeps the last strings it interned in a direct-mapped
+    cache, emptied when `generation` changes (intern_release()).
+ */
+static struct {
+  pthread_mutex_t  lock;
+  hashmap_t        table;     /* string -> canonical string */
+  vector_t         blocks;    /* the allocations of the chunks, to free them */
+  char            *chunk;     /* the chunk being filled */
+  size_t           used;
+  const char     **ids[ INTERN_ID_BLOCKS ];
+  atomic_uintptr_t chunks[ INTERN_CHUNKS ];
+  size_t           nchunks;
+  atomic_size_t    count;
+  atomic_size_t    bytes;
+  atomic_uint      generation;
+} interned = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static int at_exit_registered = 0;
+
+static int free_block( void *block ) {
+  free( block );
+  return 0;
+}
+
+static void intern_at_exit( void ) {
+  intern_release();
+}
+
+static struct header *header_of( const char *canonical ) {
+  return (struct header *)canonical - 1;
+}
+
+static uint32_t hash_of( const char *s, size_t length ) {
+  uint32_t h = 2166136261u;   /* FNV-1a */
+
+  while ( length-- ) h = ( h ^ (unsigned char)*s++ ) * 16777619u;
+
+  return h;
+}
+
+static size_t chunk_slot( uintptr_t chunk ) {
+  return (size_t)( ( chunk / INTERN_CHUNK_SIZE ) * 2654435761u ) & ( INTERN_CHUNKS - 1 );
+}
+
+/* 1 if the chunk at this address holds canonical strings, no lock */
+static int chunk_owned( uintptr_t chunk ) {
+  size_t i = chunk_slot( chunk );
+
+  for ( ;; i = ( i + 1 ) & ( INTERN_CHUNKS - 1 ) ) {
+    uintptr_t c = atomic_load_explicit( &interned.chunks[ i ], memory_order_acquire );
+
+    if ( c == chunk ) return 1;
+    if ( !c ) return 0;
+  }
+}
+
+/* called with the lock held: room for `size` bytes (the chunks of large
+   strings are allocated on their own, the chunk being filled stays) */
+static char *chunk_alloc( size_t size ) {
+  size_t n = ( size + INTERN_CHUNK_SIZE - 1 ) / INTERN_CHUNK_SIZE, k;
+  void  *p;
+
+  size = ( size + 7 ) & ~(size_t)7; /* headers stay aligned */
+  if ( 1 == n && interned.chunk && interned.used + size <= INTERN_CHUNK_SIZE ) {
+    interned.used += size;
+    return interned.chunk + interned.used - size;
+  }
+
+  if ( posix_memalign( &p, INTERN_CHUNK_SIZE, n * INTERN_CHUNK_SIZE ) ) p = NULL;
+  assert( p );
+  vector_append( interned.blocks, p );
+
+  /* kept under half full, so that lookups stay short */
+  assert( 2 * ( interned.nchunks + n ) <= INTERN_CHUNKS );
+  for ( k = 0 ; k < n ; k++ ) {
+    uintptr_t chunk = (uintptr_t)p + k * INTERN_CHUNK_SIZE;
+    size_t    i     = chunk_slot( chunk );
+
+    while ( atomic_load_explicit( &interned.chunks[ i ], memory_order_relaxed ) ) i = ( i + 1 ) & ( INTERN_CHUNKS - 1 );
+    atomic_store_explicit( &interned.chunks[ i ], chunk, memory_order_release );
+  }
+  interned.nchunks += n;
+
+  if ( 1 == n ) {
+    interned.chunk = p;
+    interned.used  = size;
+  }
+
+  return p;
+}
+
+/* called with the lock held */
+static const char *intern_locked( const char *s, size_t length ) {
+  size_t         id = atomic_load_explicit( &interned.count, memory_order_relaxed );
+  struct header *h;
+  void          *canonical;
+  char          *copy;
+
+  if ( !interned.table ) {
+    interned.table  = hashmap_new();
+    interned.blocks = vector_new();
+    if ( !at_exit_registered ) {
+      at_exit_registered = 1;
+      atexit( intern_at_exit );
+    }
+  }
+
+  if ( hashmap_find( interned.table, s, length, &canonical ) ) return canonical;
+
+  assert( length < UINT32_MAX && id < (size_t)INTERN_ID_BLOCK * INTERN_ID_BLOCKS );
+
+  /* Not from unit_malloc(): canonical strings outlive compilation units. */
+  h = (struct header *)chunk_alloc( sizeof( *h ) + length + 1 );
+  h->id     = (uint32_t)id;
+  h->length = (uint32_t)length;
+
+  copy = (char *)( h + 1 );
+  memcpy( copy, s, length );
+  copy[ length ] = '\0';
+
+  hashmap_put( interned.table, s, length, copy );
+
+  if ( !interned.ids[ id / INTERN_ID_BLOCK ] ) {
+    interned.ids[ id / INTERN_ID_BLOCK ] = calloc( INTERN_ID_BLOCK, sizeof( const char * ) );
+    assert( interned.ids[ id / INTERN_ID_BLOCK ] );
+  }
+  interned.ids[ id / INTERN_ID_BLOCK ][ id % INTERN_ID_BLOCK ] = copy;
+  atomic_store_explicit( &interned.count, id + 1, memory_order_release );
+  atomic_fetch_add_explicit( &interned.bytes, length + 1, memory_order_relaxed );
+
+  return copy;
+}
+
+/*
+  Strings interned by this thread lately:
+ */
+#ifdef __GNUC__
+struct cache {
+  unsigned    generation;
+  const char *canonical[ INTERN_CACHE ];
+};
+
+static __thread struct cache cache;
+
+static const char **cache_slot( const char *s, size_t length ) {
+  unsigned generation = atomic_load_explicit( &interned.generation, memory_order_acquire );
+
+  if ( cache.generation != generation ) {
+    memset( cache.canonical, 0, sizeof( cache.canonical ) );
+    cache.generation = generation;
+  }
+
+  return &cache.canonical[ hash_of( s, length ) & ( INTERN_CACHE - 1 ) ];
+}
+#endif
+
+const char *intern_n( const char *s, size_t length ) {
+  const char  *canonical;
+#ifdef __GNUC__
+  const char **slot;
+#endif
+
+  assert( s || !length );
+
+  s = s ? s : "";
+
+#ifdef __GNUC__
+  slot      = cache_slot( s, length );
+  canonical = *slot;
+  if ( canonical && intern_length_of( canonical ) == length && 0 == memcmp( canonical, s, length ) ) {
+    return canonical;
+  }
+#endif
+
+  pthread_mutex_lock( &interned.lock );
+  canonical = intern_locked( s, length );
+  pthread_mutex_unlock( &interned.lock );
+
+#ifdef __GNUC__
+  *slot = canonical;
+#endif
+
+  return canonical;
+}
+
+const char *intern( const char *s ) {
+  return s ? intern_n( s, strlen( s ) ) : NULL;
+}
+
+int         intern_id( const char *s, size_t length ) {
+  return intern_id_of( intern_n( s, length ) );
+}
+
+const char *intern_string( int id ) {
+  size_t count = atomic_load_explicit( &interned.count, memory_order_acquire );
+
+  if ( id < 0 || (size_t)id >= count ) return NULL;
+
+  return interned.ids[ id / INTERN_ID_BLOCK ][ id % INTERN_ID_BLOCK ];
+}
+
+int         intern_id_of( const char *canonical ) {
+  assert( canonical );
+  return (int)header_of( canonical )->id;
+}
+
+size_t      intern_length_of( const char *canonical ) {
+  assert( canonical );
+  return header_of( canonical )->length;
+}
+
+int         intern_owns( const char *s ) {
+  return s && chunk_owned( (uintptr_t)s & ~(uintptr_t)( INTERN_CHUNK_SIZE - 1 ) );
+}
+
+size_t      intern_count( void ) {
+  return atomic_load_explicit( &interned.count, memory_order_acquire );
+}
+
+size_t      intern_bytes( void ) {
+  return atomic_load_explicit( &interned.bytes, memory_order_relaxed );
+}
+
+void        intern_release( void ) {
+  size_t i;
+
+  pthread_mutex_lock( &interned.lock );
+
+  hashmap_delete( interned.table, NULL );
+  if ( interned.blocks ) vector_delete( interned.blocks, free_block );
+  for ( i = 0 ; i < INTERN_ID_BLOCKS && interned.ids[ i ] ; i++ ) {
+    free( interned.ids[ i ] );
+    interned.ids[ i ] = NULL;
+  }
+  for ( i = 0 ; i < INTERN_CHUNKS ; i++ ) atomic_store_explicit( &interned.chunks[ i ], 0, memory_order_relaxed );
+
+  interned.table   = NULL;
+  interned.blocks  = NULL;
+  interned.chunk   = NULL;
+  interned.used    = 0;
+  interned.nchunks = 0;
+  atomic_store_explicit( &interned.count, 0, memory_order_release );
+  atomic_store_explicit( &interned.bytes, 0, memory_order_relaxed );
+  /* the caches of all the threads are now stale */
+  atomic_fetch_add_explicit( &interned.generation, 1, memory_order_release );
+
+  pthread_mutex_unlock( &interned.lock );
+}
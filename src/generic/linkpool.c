@@ -0,0 +1,269 @@
+/**
+ * @file linkpool.c
+ * @author Abdellah
+ * @brief Pool of list links.
+ *
+ * Allocation of the links of lists and queues.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <generic/arena.h>
+#include <generic/linkpool.h>
+
+/* Same layout as in `src/list.c` and `src/queue.c`: */
+struct link_t {
+  void          *contents;
+  struct link_t *next;
+};
+
+/* Blocks are aligned on their size (a power of two): the block of a
+   link is its address with the low bits off. The first link of a block
+   is not handed out, its `contents` is the pool of the block. */
+#define BLOCK_BYTES ( LINKPOOL_BLOCK * sizeof( struct link_t ) )
+#define BLOCK_SLOTS 65536 /* of the block table, a power of two */
+
+/*
+  The free lists are stacks of chains. The first link of each chain
+  uses its `contents` to point to the first link of the next chain.
+
+  A pool belongs to one thread at a time: links freed by another thread
+  are pushed on its `remote` stack (lock-free, of the same shape), which
+  it takes whole once its free list is empty. When its thread ends, the
+  pool is left to the next thread that needs one, blocks, free lists
+  and all: links of the ended thread that lists still hold stay valid.
+ */
+struct pool {
+  struct link_t    *top;    /* the block being cut */
+  size_t            used;   /* links handed out from it */
+  struct link_t    *free;
+  atomic_uintptr_t  remote;
+  struct pool      *next;   /* all the pools */
+  struct pool      *orphan; /* pools whose thread ended */
+};
+
+/*
+  The blocks of all the pools, in an open addressing table on their
+  addresses, written under the lock (blocks are only freed at exit) and
+  read without it: it tells links of the pools from the others in O(1).
+ */
+static struct {
+  pthread_mutex_t  lock;
+  atomic_uintptr_t blocks[ BLOCK_SLOTS ];
+  size_t           nblocks;
+  struct pool     *pools;
+  struct pool     *orphans;
+} pools = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+#ifdef __GNUC__
+static __thread struct pool *mine;
+static pthread_key_t         pool_key;
+#else
+static struct pool *mine;
+#endif
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static size_t block_slot( uintptr_t block ) {
+  return (size_t)( ( block / BLOCK_BYTES ) * 2654435761u ) & ( BLOCK_SLOTS - 1 );
+}
+
+/* the pool of the block at this address, NULL if none */
+static struct pool *block_owner( uintptr_t block ) {
+  size_t i;
+
+  for ( i = block_slot( block ) ; ; i = ( i + 1 ) & ( BLOCK_SLOTS - 1 ) ) {
+    uintptr_t b = atomic_load_explicit( &pools.blocks[ i ], memory_order_acquire );
+
+    if ( b == block ) return ( (struct link_t *)b )->contents;
+    if ( !b ) return NULL;
+  }
+}
+
+static uintptr_t block_of( const struct link_t *link ) {
+  return (uintptr_t)link & ~(uintptr_t)( BLOCK_BYTES - 1 );
+}
+
+/* the pool of the thread calling exit(), and all the others */
+static void link_pool_at_exit( void ) {
+  link_pool_release();
+}
+
+#ifdef __GNUC__
+/* the pool of any other thread, when it ends: left to the next one */
+static void pool_at_thread_exit( void *p ) {
+  pthread_mutex_lock( &pools.lock );
+  ( (struct pool *)p )->orphan = pools.orphans;
+  pools.orphans = p;
+  pthread_mutex_unlock( &pools.lock );
+
+  mine = NULL;
+}
+#endif
+
+static void pool_once_init( void ) {
+#ifdef __GNUC__
+  pthread_key_create( &pool_key, pool_at_thread_exit );
+#endif
+  atexit( link_pool_at_exit );
+}
+
+static struct pool *pool_of_thread( void ) {
+  if ( mine ) return mine;
+
+  pthread_once( &pool_once, pool_once_init );
+
+  pthread_mutex_lock( &pools.lock );
+  if ( pools.orphans ) {
+    mine          = pools.orphans;
+    pools.orphans = mine->orphan;
+  }
+  else {
+    mine = calloc( 1, sizeof( *mine ) );
+    assert( mine );
+    mine->next  = pools.pools;
+    pools.pools = mine;
+  }
+  pthread_mutex_unlock( &pools.lock );
+
+#ifdef __GNUC__
+  pthread_setspecific( pool_key, mine );
+#endif
+
+  return mine;
+}
+
+static void pool_new_block( struct pool *p ) {
+  struct link_t *block;
+  void          *b;
+  size_t         i;
+
+  assert( 0 == ( BLOCK_BYTES & ( BLOCK_BYTES - 1 ) ) );
+  if ( posix_memalign( &b, BLOCK_BYTES, BLOCK_BYTES ) ) b = NULL;
+  assert( b );
+
+  block = b;
+  block->contents = p;
+
+  pthread_mutex_lock( &pools.lock );
+  /* kept under half full, so that lookups stay short */
+  assert( 2 * ( pools.nblocks + 1 ) <= BLOCK_SLOTS );
+  for ( i = block_slot( (uintptr_t)b ) ; atomic_load_explicit( &pools.blocks[ i ], memory_order_relaxed ) ; i = ( i + 1 ) & ( BLOCK_SLOTS - 1 ) );
+  atomic_store_explicit( &pools.blocks[ i ], (uintptr_t)b, memory_order_release );
+  pools.nblocks++;
+  pthread_mutex_unlock( &pools.lock );
+
+  p->top  = block;
+  p->used = 1;
+}
+
+void *link_alloc( void ) {
+  struct pool   *p;
+  struct link_t *link;
+
+  if ( arena_current() ) return unit_malloc( sizeof( struct link_t ) );
+
+  p = pool_of_thread();
+
+  /* Links freed by other threads, once ours are used: */
+  if ( !p->free && atomic_load_explicit( &p->remote, memory_order_relaxed ) ) {
+    p->free = (struct link_t *)atomic_exchange_explicit( &p->remote, 0, memory_order_acquire );
+  }
+
+  /* Recycled link first: */
+  if ( p->free ) {
+    link = p->free;
+    if ( link->next ) {
+      link->next->contents = link->contents;
+      p->free = link->next;
+    }
+    else {
+      p->free = link->contents;
+    }
+    return link;
+  }
+
+  if ( !p->top || LINKPOOL_BLOCK == p->used ) pool_new_block( p );
+
+  return &p->top[ p->used++ ];
+}
+
+/* a chain of links of p back to p, whatever the thread */
+static void pool_give( struct pool *p, struct link_t *chain ) {
+  uintptr_t head;
+
+  if ( p == mine ) {
+    chain->contents = p->free;
+    p->free = chain;
+    return;
+  }
+
+  head = atomic_load_explicit( &p->remote, memory_order_relaxed );
+  do {
+    chain->contents = (void *)head;
+  } while ( !atomic_compare_exchange_weak_explicit( &p->remote, &head, (uintptr_t)chain,
+                                                    memory_order_release, memory_order_relaxed ) );
+}
+
+void  link_free_chain( void *first ) {
+  struct link_t *chain = first;
+
+  /* Split where the pool changes, one lookup per block: */
+  while ( chain ) {
+    uintptr_t      block = block_of( chain );
+    struct pool   *owner = block_owner( block );
+    struct link_t *last  = chain, *next;
+
+    while ( last->next ) {
+      uintptr_t b = block_of( last->next );
+
+      if ( b != block ) {
+        if ( block_owner( b ) != owner ) break;
+        block = b;
+      }
+      last = last->next;
+    }
+    next = last->next;
+
+    /* Links of an arena go with it: */
+    if ( owner ) {
+      last->next = NULL;
+      pool_give( owner, chain );
+    }
+    chain = next;
+  }
+}
+
+void  link_free( void *link ) {
+  struct link_t *l = link;
+
+  if ( !l ) return;
+
+  l->next = NULL;
+  link_free_chain( l );
+}
+
+void  link_pool_release( void ) {
+  struct pool *p;
+  size_t       i;
+
+  pthread_mutex_lock( &pools.lock );
+  for ( i = 0 ; i < BLOCK_SLOTS ; i++ ) {
+    free( (void *)atomic_load_explicit( &pools.blocks[ i ], memory_order_relaxed ) );
+    atomic_store_explicit( &pools.blocks[ i ], 0, memory_order_relaxed );
+  }
+  pools.nblocks = 0;
+
+  /* the pools stay, empty, for the threads which hold them */
+  for ( p = pools.pools ; p ; p = p->next ) {
+    p->top  = NULL;
+    p->used = 0;
+    p->free = NULL;
+    atomic_store_explicit( &p->remote, 0, memory_order_relaxed );
+  }
+  pthread_mutex_unlock( &pools.lock );
+}
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 
 #include <generic/list.h>
+#include <generic/linkpool.h> /* links come from a pool */
 
 /*
 
@@ -71,7 +72,7 @@ list_t list_next( list_t l ) {
 }
 
 list_t list_add_first( void* object, list_t l ) {
-  struct link_t *new = malloc( sizeof( *new ) );
+  struct link_t *new = link_alloc();
 
   assert( new );
 
@@ -187,13 +188,22 @@ list_t list_del_first( list_t l, action_t delete_ ) {
   /* Execute deletion callback if it exists: */
   if ( delete_ ) delete_( list_first( l ) );
 
-  free( l );
+  link_free( l );
 
   return next;
 }
 
 void   list_delete( list_t l, action_t delete_ ) {
-  for ( ; !list_is_empty( l ) ; l = list_del_first( l, delete_ ) );
+  list_t cur;
+
+  if ( delete_ ) {
+    for ( cur = l ; !list_is_empty( cur ) ; cur = list_next( cur ) ) {
+      delete_( list_first( cur ) );
+    }
+  }
+
+  /* The links go back to the pool all at once: */
+  link_free_chain( l );
 }
 
 int    list_print( list_t l, action_t print ) {
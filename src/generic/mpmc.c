@@ -0,0 +1,158 @@
+/**
+ * @file mpmc.c
+ * @author Abdellah
+ * @brief Concurrent queues.
+ *
+ * Bounded lock-free queue between any number of threads.
+ */
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <generic/mpmc.h>
+
+#define CACHE_LINE 64
+
+/*
+  Bounded queue of D. Vyukov. The slot of position pos is
+  cells[ pos & mask ]; its sequence is pos when it may be written for
+  that position, and pos + 1 once it holds the object, to be read. The
+  reader then sets it to pos + capacity, for the next lap.
+ */
+struct cell {
+  atomic_size_t  sequence;
+  void          *object;
+};
+
+union padded_index {
+  atomic_size_t index;
+  char          pad[ CACHE_LINE ];
+};
+
+struct mpmc_t {
+  union padded_index tail;   /* next position to push */
+  union padded_index head;   /* next position to pop */
+  struct cell       *cells;
+  size_t             mask;
+  atomic_int         closed;
+};
+
+mpmc_t mpmc_new( size_t capacity ) {
+  mpmc_t q;
+  size_t size = 2; /* one slot would be ready for both sides at once */
+  size_t i;
+  void  *p;
+
+  while ( size < capacity ) size *= 2;
+
+  if ( posix_memalign( &p, CACHE_LINE, sizeof( *q ) ) ) p = NULL;
+  assert( p );
+  q = p;
+  memset( q, 0, sizeof( *q ) );
+
+  q->cells = calloc( size, sizeof( *q->cells ) );
+  assert( q->cells );
+  q->mask = size - 1;
+
+  for ( i = 0 ; i < size ; i++ ) atomic_init( &q->cells[ i ].sequence, i );
+  atomic_init( &q->tail.index, 0 );
+  atomic_init( &q->head.index, 0 );
+  atomic_init( &q->closed, 0 );
+
+  return q;
+}
+
+void   mpmc_delete( mpmc_t q, action_t delete_ ) {
+  void *object;
+
+  if ( !q ) return;
+
+  if ( delete_ ) {
+    while ( mpmc_pop( q, &object ) ) delete_( object );
+  }
+
+  free( q->cells );
+  free( q );
+}
+
+size_t mpmc_capacity( mpmc_t q ) {
+  return q->mask + 1;
+}
+
+int    mpmc_push( mpmc_t q, void *object ) {
+  size_t pos = atomic_load_explicit( &q->tail.index, memory_order_relaxed );
+
+  for ( ;; ) {
+    struct cell *cell = &q->cells[ pos & q->mask ];
+    size_t       seq  = atomic_load_explicit( &cell->sequence, memory_order_acquire );
+    intptr_t     diff = (intptr_t)seq - (intptr_t)pos;
+
+    if ( 0 == diff ) {
+      if ( atomic_compare_exchange_weak_explicit( &q->tail.index, &pos, pos + 1,
+                                                  memory_order_relaxed, memory_order_relaxed ) ) {
+        cell->object = object;
+        atomic_store_explicit( &cell->sequence, pos + 1, memory_order_release );
+        return 1;
+      }
+      /* pos was reloaded by the failed exchange */
+    }
+    else if ( diff < 0 ) {
+      return 0; /* full: the slot still holds the object of the last lap */
+    }
+    else {
+      pos = atomic_load_explicit( &q->tail.index, memory_order_relaxed );
+    }
+  }
+}
+
+int    mpmc_pop( mpmc_t q, void **object ) {
+  size_t pos = atomic_load_explicit( &q->head.index, memory_order_relaxed );
+
+  for ( ;; ) {
+    struct cell *cell = &q->cells[ pos & q->mask ];
+    size_t       seq  = atomic_load_explicit( &cell->sequence, memory_order_acquire );
+    intptr_t     diff = (intptr_t)seq - (intptr_t)( pos + 1 );
+
+    if ( 0 == diff ) {
+      if ( atomic_compare_exchange_weak_explicit( &q->head.index, &pos, pos + 1,
+                                                  memory_order_relaxed, memory_order_relaxed ) ) {
+        *object = cell->object;
+        atomic_store_explicit( &cell->sequence, pos + q->mask + 1, memory_order_release );
+        return 1;
+      }
+    }
+    else if ( diff < 0 ) {
+      return 0; /* empty: the slot was not written for this lap yet */
+    }
+    else {
+      pos = atomic_load_explicit( &q->head.index, memory_order_relaxed );
+    }
+  }
+}
+
+size_t mpmc_push_batch( mpmc_t q, void **objects, size_t count ) {
+  size_t i;
+
+  for ( i = 0 ; i < count && mpmc_push( q, objects[ i ] ) ; i++ );
+
+  return i;
+}
+
+size_t mpmc_pop_batch( mpmc_t q, void **objects, size_t count ) {
+  size_t i;
+
+  for ( i = 0 ; i < count && mpmc_pop( q, &objects[ i ] ) ; i++ );
+
+  return i;
+}
+
+void   mpmc_close( mpmc_t q ) {
+  atomic_store_explicit( &q->closed, 1, memory_order_release );
+}
+
+int    mpmc_closed( mpmc_t q ) {
+  return atomic_load_explicit( &q->closed, memory_order_acquire );
+}
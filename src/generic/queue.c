@@ -11,9 +11,16 @@
 #include <stdlib.h> /* NULL */
 
 #include <generic/queue.h>
+#include <generic/linkpool.h>
 
+/*
+  A queue is a circular list seen from its last link: q points to the
+  tail, and q->next is the head. Enqueueing is O(1), and since the links
+  are those of `src/list.c` (same struct link_t), the queue becomes a
+  list by just cutting the circle after the tail.
+ */
 struct link_t {
-  void          *content;
+  void          *contents;
   struct link_t *next;
 };
 
@@ -26,26 +33,24 @@ int     queue_empty( queue_t q ) {
 }
 
 queue_t enqueue( queue_t q, void* object ) {
-  struct link_t *new_node = malloc(sizeof(struct link_t));
-  new_node->content = object;
-  new_node->next = NULL;
+  struct link_t *new_node = link_alloc();
+
+  assert( new_node );
+
+  new_node->contents = object;
   if (!q) {
+    new_node->next = new_node;
     return new_node;
   }
-  struct link_t *tail = q;
-  while (tail->next) tail = tail->next;
-  tail->next = new_node;
-  return q;
+  new_node->next = q->next;
+  q->next = new_node;
+  return new_node;
 }
 
 list_t  queue_to_list( queue_t q ) {
-  list_t l = list_new();
-  struct link_t *cur = q;
-  while (cur) {
-    l = list_add_last(cur->content, l);
-    struct link_t *temp = cur;
-    cur = cur->next;
-    free(temp);
-  }
-  return l;
+  if (queue_empty(q)) return list_new();
+
+  list_t head = q->next;
+  q->next = NULL;
+  return head;
 }
@@ -0,0 +1,140 @@
+/**
+ * @file ring.c
+ * @author Abdellah
+ * @brief Ring buffers.
+ *
+ * Bounded lock-free queue between two threads.
+ */
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <generic/ring.h>
+
+#define CACHE_LINE 64
+
+/*
+  head and tail only grow: the ring holds tail - head objects, object i
+  being in slots[ i & mask ]. Each side owns one index (written with
+  release, read by the other side with acquire) and caches the index of
+  the other side, to be reloaded only when the ring looks full (or
+  empty).
+ */
+struct side {
+  atomic_size_t index;
+  size_t        cached; /* last value read of the other side's index */
+};
+
+union padded_side {
+  struct side side;
+  char        pad[ CACHE_LINE ];
+};
+
+struct ring_t {
+  union padded_side producer; /* tail */
+  union padded_side consumer; /* head */
+  void            **slots;
+  size_t            mask;
+  atomic_int        closed;
+};
+
+ring_t ring_new( size_t capacity ) {
+  ring_t r;
+  size_t size = 1;
+  void  *p;
+
+  while ( size < capacity ) size *= 2;
+
+  if ( posix_memalign( &p, CACHE_LINE, sizeof( *r ) ) ) p = NULL;
+  assert( p );
+  r = p;
+  memset( r, 0, sizeof( *r ) );
+
+  r->slots = calloc( size, sizeof( *r->slots ) );
+  assert( r->slots );
+  r->mask = size - 1;
+
+  atomic_init( &r->producer.side.index, 0 );
+  atomic_init( &r->consumer.side.index, 0 );
+  atomic_init( &r->closed, 0 );
+
+  return r;
+}
+
+void   ring_delete( ring_t r, action_t delete_ ) {
+  void *object;
+
+  if ( !r ) return;
+
+  if ( delete_ ) {
+    while ( ring_pop( r, &object ) ) delete_( object );
+  }
+
+  free( r->slots );
+  free( r );
+}
+
+size_t ring_capacity( ring_t r ) {
+  return r->mask + 1;
+}
+
+int    ring_empty( ring_t r ) {
+  return atomic_load_explicit( &r->consumer.side.index, memory_order_acquire )
+      == atomic_load_explicit( &r->producer.side.index, memory_order_acquire );
+}
+
+size_t ring_push_batch( ring_t r, void **objects, size_t count ) {
+  struct side *p    = &r->producer.side;
+  size_t       tail = atomic_load_explicit( &p->index, memory_order_relaxed );
+  size_t       room = ring_capacity( r ) - ( tail - p->cached );
+  size_t       i;
+
+  if ( room < count ) {
+    p->cached = atomic_load_explicit( &r->consumer.side.index, memory_order_acquire );
+    room      = ring_capacity( r ) - ( tail - p->cached );
+  }
+  if ( count > room ) count = room;
+
+  for ( i = 0 ; i < count ; i++ ) r->slots[ ( tail + i ) & r->mask ] = objects[ i ];
+
+  atomic_store_explicit( &p->index, tail + count, memory_order_release );
+
+  return count;
+}
+
+int    ring_push( ring_t r, void *object ) {
+  return (int)ring_push_batch( r, &object, 1 );
+}
+
+void   ring_close( ring_t r ) {
+  atomic_store_explicit( &r->closed, 1, memory_order_release );
+}
+
+size_t ring_pop_batch( ring_t r, void **objects, size_t count ) {
+  struct side *c    = &r->consumer.side;
+  size_t       head = atomic_load_explicit( &c->index, memory_order_relaxed );
+  size_t       used = c->cached - head;
+  size_t       i;
+
+  if ( used < count ) {
+    c->cached = atomic_load_explicit( &r->producer.side.index, memory_order_acquire );
+    used      = c->cached - head;
+  }
+  if ( count > used ) count = used;
+
+  for ( i = 0 ; i < count ; i++ ) objects[ i ] = r->slots[ ( head + i ) & r->mask ];
+
+  atomic_store_explicit( &c->index, head + count, memory_order_release );
+
+  return count;
+}
+
+int    ring_pop( ring_t r, void **object ) {
+  return (int)ring_pop_batch( r, object, 1 );
+}
+
+int    ring_closed( ring_t r ) {
+  return atomic_load_explicit( &r->closed, memory_order_acquire );
+}
@@ -0,0 +1,404 @@
+/**
+ * @file threadpool.c
+ * @author Abdellah
+ * @brief Thread pools.
+ *
+ * Work-stealing task scheduler.
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE /* sched_getaffinity(), sched_setaffinity(), CPU_SET() */
+#endif
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <generic/threadpool.h>
+
+struct task {
+  action_t     run;
+  void        *arg;
+  taskgroup_t  group;
+};
+
+/*
+  The deque of a worker: a circular array, the owner pushes and pops at
+  the bottom, thieves take from the top. A short mutex guards it, tasks
+  are coarse enough (a code object, a file) for it not to matter.
+ */
+struct deque {
+  pthread_mutex_t  lock;
+  struct task     *tasks;
+  size_t           capacity; /* a power of two */
+  size_t           top;
+  size_t           bottom;
+};
+
+struct worker {
+  threadpool_t     pool;
+  int              id;
+  pthread_t        thread;
+  struct deque     deque;
+  uint64_t         seed; /* of the choice of victims */
+};
+
+struct threadpool_t {
+  struct worker   *workers;
+  int              count;
+  int              flags;
+  struct deque     shared;  /* tasks spawned from outside the pool */
+
+  atomic_size_t    pending; /* tasks in the deques */
+  atomic_int       sleeping;
+  atomic_int       stop;
+  pthread_mutex_t  lock;
+  pthread_cond_t   work;
+};
+
+/*
+  A task that ends decrements `running` under the lock, and nothing
+  touches the group after it unlocks, so once a waiter saw `running` at
+  0 under the lock the group may be deleted. `running` itself, not a
+  flag left by an earlier task, is what waiters wait on: it may go
+  back to 0 several times between two waits (a task that ends before
+  the next one is spawned).
+ */
+struct taskgroup_t {
+  threadpool_t     pool;
+  atomic_size_t    running; /* spawned and not ended yet */
+  atomic_int       spawned; /* since the last wait */
+  atomic_int       result;
+  atomic_int       sleepers; /* workers waiting on it with nothing to run */
+  pthread_mutex_t  lock;
+  pthread_cond_t   done;     /* also signaled when a task is spawned in it */
+};
+
+#ifdef __GNUC__
+static __thread struct worker *self = NULL;
+#else
+static struct worker *self = NULL;
+#endif
+
+static void deque_init( struct deque *d ) {
+  pthread_mutex_init( &d->lock, NULL );
+  d->capacity = 64;
+  d->tasks    = malloc( d->capacity * sizeof( *d->tasks ) );
+  assert( d->tasks );
+  d->top      = 0;
+  d->bottom   = 0;
+}
+
+static void deque_destroy( struct deque *d ) {
+  free( d->tasks );
+  pthread_mutex_destroy( &d->lock );
+}
+
+static void deque_push( struct deque *d, struct task *t ) {
+  pthread_mutex_lock( &d->lock );
+
+  if ( d->bottom - d->top == d->capacity ) {
+    struct task *tasks = malloc( 2 * d->capacity * sizeof( *tasks ) );
+    size_t       i;
+
+    assert( tasks );
+    for ( i = d->top ; i != d->bottom ; i++ ) {
+      tasks[ i & ( 2 * d->capacity - 1 ) ] = d->tasks[ i & ( d->capacity - 1 ) ];
+    }
+    free( d->tasks );
+    d->tasks     = tasks;
+    d->capacity *= 2;
+  }
+
+  d->tasks[ d->bottom++ & ( d->capacity - 1 ) ] = *t;
+
+  pthread_mutex_unlock( &d->lock );
+}
+
+/* from the bottom (owner) or the top (thieves) */
+static int deque_take( struct deque *d, struct task *t, int from_bottom ) {
+  int found = 0;
+
+  pthread_mutex_lock( &d->lock );
+
+  if ( d->bottom != d->top ) {
+    *t    = from_bottom ? d->tasks[ --d->bottom & ( d->capacity - 1 ) ]
+                        : d->tasks[ d->top++ & ( d->capacity - 1 ) ];
+    found = 1;
+  }
+
+  pthread_mutex_unlock( &d->lock );
+
+  return found;
+}
+
+/* xorshift64 */
+static uint64_t next_random( uint64_t *seed ) {
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 7;
+  *seed ^= *seed << 17;
+  return *seed;
+}
+
+/* Own deque first, then the shared one, then the other workers. */
+static int find_task( threadpool_t pool, struct worker *w, struct task *t ) {
+  int i, victim;
+
+  if ( 0 == atomic_load( &pool->pending ) ) return 0;
+
+  if ( w && deque_take( &w->deque, t, 1 ) ) goto found;
+  if ( deque_take( &pool->shared, t, 0 ) ) goto found;
+
+  /* Random first victim, then all the others in turn: */
+  victim = w ? (int)( next_random( &w->seed ) % pool->count ) : 0;
+  for ( i = 0 ; i < pool->count ; i++, victim = ( victim + 1 ) % pool->count ) {
+    if ( w && victim == w->id ) continue;
+    if ( deque_take( &pool->workers[ victim ].deque, t, 0 ) ) goto found;
+  }
+
+  return 0;
+
+ found:
+  atomic_fetch_sub( &pool->pending, 1 );
+  return 1;
+}
+
+static void run_task( struct task *t ) {
+  taskgroup_t group  = t->group;
+  int         result = t->run( t->arg );
+
+  if ( result ) {
+    int none = 0;
+    atomic_compare_exchange_strong( &group->result, &none, result );
+  }
+
+  pthread_mutex_lock( &group->lock );
+  if ( 1 == atomic_fetch_sub( &group->running, 1 ) ) pthread_cond_broadcast( &group->done );
+  pthread_mutex_unlock( &group->lock );
+}
+
+/* On the CPUs the pool was made on: they need not be 0 to n - 1 (taskset,
+   cgroups), nor all online. */
+static void pin_worker( struct worker *w ) {
+#ifdef __linux__
+  cpu_set_t allowed, set;
+  int       cpus[ CPU_SETSIZE ];
+  int       count = 0, cpu;
+
+  if ( sched_getaffinity( 0, sizeof( allowed ), &allowed ) ) return;
+
+  for ( cpu = 0 ; cpu < CPU_SETSIZE ; cpu++ ) {
+    if ( CPU_ISSET( cpu, &allowed ) ) cpus[ count++ ] = cpu;
+  }
+  if ( !count ) return;
+
+  CPU_ZERO( &set );
+  CPU_SET( cpus[ w->id % count ], &set );
+  sched_setaffinity( 0, sizeof( set ), &set ); /* best effort */
+#else
+  (void)w;
+#endif
+}
+
+static void *worker_main( void *arg ) {
+  struct worker *w    = arg;
+  threadpool_t   pool = w->pool;
+  struct task    t;
+
+  self = w;
+  if ( pool->flags & THREADPOOL_PIN ) pin_worker( w );
+
+  for ( ;; ) {
+    if ( find_task( pool, w, &t ) ) {
+      run_task( &t );
+      continue;
+    }
+
+    /* Sleep until a task is spawned. Both sides check the other's
+       counter after updating their own, so no wakeup is lost. */
+    pthread_mutex_lock( &pool->lock );
+    atomic_fetch_add( &pool->sleeping, 1 );
+    while ( 0 == atomic_load( &pool->pending ) && !atomic_load( &pool->stop ) ) {
+      pthread_cond_wait( &pool->work, &pool->lock );
+    }
+    atomic_fetch_sub( &pool->sleeping, 1 );
+    pthread_mutex_unlock( &pool->lock );
+
+    if ( atomic_load( &pool->stop ) && 0 == atomic_load( &pool->pending ) ) break;
+  }
+
+  self = NULL;
+
+  return NULL;
+}
+
+threadpool_t threadpool_new( int workers, int flags ) {
+  threadpool_t pool = calloc( 1, sizeof( *pool ) );
+  int          i;
+
+  assert( pool );
+
+  if ( workers <= 0 ) {
+    long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    workers = cpus > 0 ? (int)cpus : 1;
+  }
+
+  pool->count   = workers;
+  pool->flags   = flags;
+  pool->workers = calloc( workers, sizeof( *pool->workers ) );
+  assert( pool->workers );
+
+  deque_init( &pool->shared );
+  atomic_init( &pool->pending, 0 );
+  atomic_init( &pool->sleeping, 0 );
+  atomic_init( &pool->stop, 0 );
+  pthread_mutex_init( &pool->lock, NULL );
+  pthread_cond_init( &pool->work, NULL );
+
+  for ( i = 0 ; i < workers ; i++ ) {
+    struct worker *w = &pool->workers[ i ];
+
+    w->pool = pool;
+    w->id   = i;
+    w->seed = 0x9e3779b97f4a7c15ULL * ( i + 1 );
+    deque_init( &w->deque );
+  }
+
+  for ( i = 0 ; i < workers ; i++ ) {
+    int rc = pthread_create( &pool->workers[ i ].thread, NULL, worker_main, &pool->workers[ i ] );
+    assert( 0 == rc );
+    (void)rc;
+  }
+
+  return pool;
+}
+
+void         threadpool_delete( threadpool_t pool ) {
+  int i;
+
+  if ( !pool ) return;
+
+  pthread_mutex_lock( &pool->lock );
+  atomic_store( &pool->stop, 1 );
+  pthread_cond_broadcast( &pool->work );
+  pthread_mutex_unlock( &pool->lock );
+
+  for ( i = 0 ; i < pool->count ; i++ ) pthread_join( pool->workers[ i ].thread, NULL );
+
+  for ( i = 0 ; i < pool->count ; i++ ) deque_destroy( &pool->workers[ i ].deque );
+  deque_destroy( &pool->shared );
+  pthread_mutex_destroy( &pool->lock );
+  pthread_cond_destroy( &pool->work );
+  free( pool->workers );
+  free( pool );
+}
+
+int          threadpool_workers( threadpool_t pool ) {
+  return pool->count;
+}
+
+int          threadpool_worker_id( threadpool_t pool ) {
+  return self && self->pool == pool ? self->id : -1;
+}
+
+taskgroup_t  taskgroup_new( threadpool_t pool ) {
+  taskgroup_t group = calloc( 1, sizeof( *group ) );
+
+  assert( pool && group );
+
+  group->pool = pool;
+  atomic_init( &group->running, 0 );
+  atomic_init( &group->spawned, 0 );
+  atomic_init( &group->result, 0 );
+  atomic_init( &group->sleepers, 0 );
+  pthread_mutex_init( &group->lock, NULL );
+  pthread_cond_init( &group->done, NULL );
+
+  return group;
+}
+
+void         taskgroup_delete( taskgroup_t group ) {
+  if ( !group ) return;
+
+  pthread_mutex_destroy( &group->lock );
+  pthread_cond_destroy( &group->done );
+  free( group );
+}
+
+void         taskgroup_spawn( taskgroup_t group, action_t task, void *arg ) {
+  threadpool_t pool = group->pool;
+  struct task  t;
+
+  assert( task );
+
+  t.run   = task;
+  t.arg   = arg;
+  t.group = group;
+
+  atomic_fetch_add( &group->running, 1 );
+  atomic_store( &group->spawned, 1 );
+
+  /* counted first: a worker may take it as soon as it is pushed */
+  atomic_fetch_add( &pool->pending, 1 );
+
+  if ( self && self->pool == pool ) deque_push( &self->deque, &t );
+  else                              deque_push( &pool->shared, &t );
+
+  if ( atomic_load( &pool->sleeping ) ) {
+    pthread_mutex_lock( &pool->lock );
+    pthread_cond_signal( &pool->work );
+    pthread_mutex_unlock( &pool->lock );
+  }
+
+  /* the workers waiting on the group may be the ones to run it */
+  if ( atomic_load( &group->sleepers ) ) {
+    pthread_mutex_lock( &group->lock );
+    pthread_cond_broadcast( &group->done );
+    pthread_mutex_unlock( &group->lock );
+  }
+}
+
+int          taskgroup_wait( taskgroup_t group ) {
+  threadpool_t   pool = group->pool;
+  struct worker *w    = self && self->pool == pool ? self : NULL;
+  struct task    t;
+
+  if ( !atomic_load( &group->spawned ) ) return 0;
+
+  while ( atomic_load( &group->running ) ) {
+    /* Help while waiting: */
+    if ( find_task( pool, w, &t ) ) {
+      run_task( &t );
+      continue;
+    }
+
+    /* Other threads sleep while the last tasks of the group run on
+       the workers. */
+    if ( !w ) break;
+
+    /* A worker sleeps until the group is done or a task is spawned in
+       it: the tasks of the group still to run may have to run here.
+       As for the pool, both sides check the other's counter after
+       updating their own, so no wakeup is lost. While tasks of other
+       groups are left in the deques it does not sleep but helps. */
+    pthread_mutex_lock( &group->lock );
+    atomic_fetch_add( &group->sleepers, 1 );
+    while ( atomic_load( &group->running ) && 0 == atomic_load( &pool->pending ) ) {
+      pthread_cond_wait( &group->done, &group->lock );
+    }
+    atomic_fetch_sub( &group->sleepers, 1 );
+    pthread_mutex_unlock( &group->lock );
+  }
+
+  pthread_mutex_lock( &group->lock );
+  while ( atomic_load( &group->running ) ) pthread_cond_wait( &group->done, &group->lock );
+  atomic_store( &group->spawned, 0 );
+  pthread_mutex_unlock( &group->lock );
+
+  return atomic_exchange( &group->result, 0 );
+}
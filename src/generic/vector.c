@@ -0,0 +1,196 @@
+/**
+ * @file vector.c
+ * @author Abdellah
+ * @brief Vectors.
+ *
+ * Growable arrays of generic pointers.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <generic/vector.h>
+
+#define VECTOR_MIN_CAPACITY 8
+
+struct vector_t {
+  void  **contents;
+  size_t  length;
+  size_t  capacity;
+};
+
+vector_t vector_new( void ) {
+  vector_t v = calloc( 1, sizeof( *v ) );
+
+  assert( v );
+
+  return v;
+}
+
+int      vector_is_empty( vector_t v ) {
+  return 0 == vector_length( v );
+}
+
+size_t   vector_length( vector_t v ) {
+
+  assert( v );
+
+  return v->length;
+}
+
+size_t   vector_capacity( vector_t v ) {
+
+  assert( v );
+
+  return v->capacity;
+}
+
+void*    vector_get_at( vector_t v, size_t index ) {
+
+  assert( index < vector_length( v ) );
+
+  return v->contents[ index ];
+}
+
+void     vector_set_at( vector_t v, size_t index, void *object ) {
+
+  assert( index < vector_length( v ) );
+
+  v->contents[ index ] = object;
+}
+
+void*    vector_last( vector_t v ) {
+
+  assert( !vector_is_empty( v ) );
+
+  return v->contents[ v->length - 1 ];
+}
+
+/* reallocation to exactly `capacity` objects */
+static void vector_resize( vector_t v, size_t capacity ) {
+  void **contents = NULL;
+
+  if ( capacity > 0 ) {
+    contents = realloc( v->contents, capacity * sizeof( *contents ) );
+    assert( contents );
+  }
+  else {
+    free( v->contents );
+  }
+
+  v->contents = contents;
+  v->capacity = capacity;
+}
+
+void     vector_reserve( vector_t v, size_t capacity ) {
+
+  assert( v );
+
+  if ( capacity > v->capacity ) vector_resize( v, capacity );
+}
+
+void     vector_shrink( vector_t v ) {
+
+  assert( v );
+
+  if ( v->length < v->capacity ) vector_resize( v, v->length );
+}
+
+void     vector_append( vector_t v, void *object ) {
+
+  assert( v );
+
+  /* Doubling keeps appends amortized O(1): */
+  if ( v->length == v->capacity ) {
+    vector_resize( v, v->capacity ? 2 * v->capacity : VECTOR_MIN_CAPACITY );
+  }
+
+  v->contents[ v->length++ ] = object;
+}
+
+void*    vector_pop( vector_t v ) {
+
+  assert( !vector_is_empty( v ) );
+
+  return v->contents[ --v->length ];
+}
+
+void     vector_clear( vector_t v, action_t delete_ ) {
+  size_t i;
+
+  assert( v );
+
+  if ( delete_ ) {
+    for ( i = 0 ; i < v->length ; i++ ) delete_( v->contents[ i ] );
+  }
+
+  v->length = 0;
+}
+
+void     vector_delete( vector_t v, action_t delete_ ) {
+
+  if ( !v ) return;
+
+  vector_clear( v, delete_ );
+  free( v->contents );
+  free( v );
+}
+
+int      vector_print( vector_t v, action_t print ) {
+  /* Same output as list_print(): */
+  int    nchars = printf( "%s", vector_is_empty( v ) ? "" : " " );
+  size_t i;
+
+  for ( i = 0 ; i < v->length ; i++ ) {
+    nchars += print ? print( v->contents[ i ] ) : printf( "#OBJECT#" );
+    nchars += printf( " " );
+  }
+
+  return nchars;
+}
+
+void**   vector_data( vector_t v ) {
+
+  assert( v );
+
+  return v->contents;
+}
+
+int      vector_foreach( vector_t v, action_t action ) {
+  size_t i;
+  int    ret;
+
+  assert( v && action );
+
+  for ( i = 0 ; i < v->length ; i++ ) {
+    ret = action( v->contents[ i ] );
+    if ( ret ) return ret;
+  }
+
+  return 0;
+}
+
+vector_t vector_from_list( list_t l ) {
+  vector_t v = vector_new();
+
+  vector_reserve( v, list_length( l ) );
+
+  for ( ; !list_is_empty( l ) ; l = list_next( l ) ) {
+    vector_append( v, list_first( l ) );
+  }
+
+  return v;
+}
+
+list_t   vector_to_list( vector_t v ) {
+  list_t l = list_new();
+  size_t i;
+
+  /* Built from the end, so that each link is added first: */
+  for ( i = vector_length( v ) ; i > 0 ; i-- ) {
+    l = list_add_first( v->contents[ i - 1 ], l );
+  }
+
+  return l;
+}
@@ -11,13 +11,18 @@
 #include <string.h>
 #include <assert.h>
 
+#include <generic/arena.h>
+#include <generic/intern.h>
 #include <lexer/lexem.h>
 
+/* type and value are interned (see intern.h) */
 struct lexem {
-  char *type;
-  char *value;
-  int   line;    /* Start at line 1   */
-  int   column;  /* Start at column 0 */
+  const char *type;
+  const char *value;
+  int         line;    /* Start at line 1   */
+  int         column;  /* Start at column 0 */
+  int         flags;   /* LEXEM_AFTER_* trivia flags */
+  int         borrowed;
 };
 
 const char *lexem_type( lexem_t lex ) {
@@ -36,16 +41,24 @@ int lexem_column( lexem_t lex ) {
   return lex ? lex->column : 0;
 }
 
+int lexem_flags( lexem_t lex ) {
+  return lex ? lex->flags : 0;
+}
+
+void lexem_set_flags( lexem_t lex, int flags ) {
+  if ( lex ) lex->flags = flags;
+}
+
 /*
   Constructor and callbacks for lists/queues of lexems:
  */
 lexem_t lexem_new( char *type, char *value, int line, int column ) {
-  lexem_t lex = calloc( 1, sizeof( *lex ) );
+  lexem_t lex = unit_calloc( 1, sizeof( *lex ) );
 
   assert( lex );
 
-  if ( type  && *type  ) lex->type  = strdup( type );
-  if ( value && *value ) lex->value = strdup( value );
+  if ( type  && *type  ) lex->type  = intern( type );
+  if ( value && *value ) lex->value = intern( value );
 
   lex->line   = line;
   lex->column = column;
@@ -53,6 +66,35 @@ lexem_t lexem_new( char *type, char *value, int line, int column ) {
   return lex;
 }
 
+lexem_t lexem_array_new( size_t count ) {
+  lexem_t array = calloc( count ? count : 1, sizeof( *array ) );
+  size_t  i;
+
+  assert( array );
+
+  for ( i = 0 ; i < count ; i++ ) array[ i ].borrowed = 1;
+
+  return array;
+}
+
+lexem_t lexem_array_at( lexem_t array, size_t i ) {
+  return &array[ i ];
+}
+
+void    lexem_array_delete( lexem_t array ) {
+  free( array );
+}
+
+/* same as lexem_new(), in place, value being `length` bytes long */
+void    lexem_set( lexem_t lex, const char *type, const char *value, size_t length,
+                   int line, int column, int flags ) {
+  lex->type   = type  && *type ? intern( type ) : NULL;
+  lex->value  = value && length ? intern_n( value, length ) : NULL;
+  lex->line   = line;
+  lex->column = column;
+  lex->flags  = flags;
+}
+
 int     lexem_print( void *_lex ) {
   lexem_t lex = _lex; /* Start by casting to actual type */
 
@@ -66,12 +108,8 @@ int     lexem_print( void *_lex ) {
 int     lexem_delete( void *_lex ) {
   lexem_t lex = _lex;
 
-  if ( lex ) {
-    free( lex->type );
-    free( lex->value );
-  }
-
-  free( lex );
+  /* type and value are interned, they stay */
+  if ( lex && !lex->borrowed ) unit_free( lex );
 
   return 0;
 }
@@ -89,10 +127,11 @@ int lexem_is_type(lexem_t lex, char *type) {
 }
 
 
+// interned strings: equal iff same pointer
 int lexem_is_egal( lexem_t lex1, lexem_t lex2 ) {
-    if (strcmp(lex1->type, lex2->type) != 0)
+    if (lex1->type != lex2->type)
         return 0;
-    if (strcmp(lex1->value, lex2->value) != 0)
+    if (lex1->value != lex2->value)
         return 0;
     if (lex1->line != lex2->line)
         return 0;
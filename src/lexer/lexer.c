@@ -9,39 +9,70 @@
 #include <string.h>
 #include <ctype.h> 
 #include <assert.h>
+#include <time.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <lexer/lexem.h>
 #include <generic/list.h>
-#include <generic/queue.h>
+#include <generic/arena.h>
 #include <regexp/regexp.h>
+#include <regexp/overlap.h>
 #include <lexer/lexer.h>
+#include <lexer/reader.h>
+#include <lexer/tokbuf.h>
+#include <lexer/scanner.h>
 
 // We should start first by reading the directives dictionary so we make a structure to link each type with the correspondant regex
 struct lex_rule {
     char *type;
     char *regex; // the regex string to match against
+    int type_id; // type of the rule in the token buffer being filled
+
+    // native scanner for "@name" rules (NULL for a regexp), which can give
+    // several types: type_ids[k] is the id of its k-th type
+    struct lex_scanner *scanner;
+    int *type_ids;
+    int shadowed; // regexp rule standing for what an earlier scanner does
+
+    // profiling counters, only updated when profiling is on
+    unsigned long attempts;
+    unsigned long hits;
+    unsigned long empty_hits;  // zero-length matches (ignored by the lexer)
+    size_t        bytes;       // total length of the accepted lexems
+    double        seconds;     // time spent in re_match for this rule
 };
 
-//kkkkkkk Few helper functions (static) kkkkkkkkkk
+// Profiling (see lexer.h): -1 means "not decided yet", the environment
+// variable LEX_PROFILE_ENV is then checked on the first call to lex().
+#define LEX_PROFILE_ENV "PYAS_LEX_PROFILE"
 
-// this function reads a whole file into a string ;)
-static char *read_file_content(char *filename) {
-    FILE *f = fopen(filename, "r");
-    if (!f) {
-        perror("Unable to open file");
-        return NULL;
-    }
-    fseek(f, 0, SEEK_END);
-    long length = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    char *buffer = calloc(length + 1, 1);
-    if (buffer) {
-        fread(buffer, 1, length, f);
-    }
-    fclose(f);
-    return buffer;
-}
+static int lex_profiling = -1;
+
+// per-rule totals accumulated over all the calls to lex(), printed at exit
+struct lex_profile_entry {
+    char *type;
+    char *regex;
+    int   rank;  // position of the rule in the definitions file
+    unsigned long attempts;
+    unsigned long hits;
+    unsigned long empty_hits;
+    size_t        bytes;
+    double        seconds;
+};
+
+struct lex_profile {
+    struct lex_profile_entry *table;
+    size_t count;
+};
+
+// the totals of the calls to lex() made on this thread: only this thread
+// touches them, other threads hand theirs over (lex_profile_take/add)
+static __thread struct lex_profile *lex_profile_mine = NULL;
+
+//kkkkkkk Few helper functions (static) kkkkkkkkkk
 
 // remove the \n at the end of lines (solution suggested after fails with fread())
 static void trim_newline(char *s) {
@@ -50,7 +81,7 @@ static void trim_newline(char *s) {
 }
 
 // upload the rules from the dictionary
-static list_t load_lex_rules(char *lex_defs_filename) {
+list_t lex_rules_load(char *lex_defs_filename) {
     FILE *f = fopen(lex_defs_filename, "r");
     if (!f) {
         fprintf(stderr, "Error: Cannot open config file %s\n", lex_defs_filename);
@@ -75,9 +106,21 @@ static list_t load_lex_rules(char *lex_defs_filename) {
             // remove space in beginings
             while(isspace(*regex_str)) regex_str++;
 
-            struct lex_rule *rule = malloc(sizeof(struct lex_rule));
+            struct lex_rule *rule = calloc(1, sizeof(struct lex_rule));
             rule->type = strdup(type_str);
             rule->regex = strdup(regex_str); // store the regex string as-is
+
+            if ('@' == regex_str[0]) {
+                regex_str[1 + strcspn(regex_str + 1, " \t")] = '\0';
+                rule->scanner = lex_scanner_find(regex_str + 1);
+                if (!rule->scanner) {
+                    fprintf(stderr, "Error: unknown scanner %s in %s\n", regex_str, lex_defs_filename);
+                    lex_rule_delete(rule);
+                    list_delete(rules, lex_rule_delete);
+                    fclose(f);
+                    return NULL;
+                }
+            }
             
             rules = list_add_last(rule, rules);
         }
@@ -86,108 +129,502 @@ static list_t load_lex_rules(char *lex_defs_filename) {
     return rules;
 }
 
+const char *lex_rule_type(void *ptr) {
+    return ptr ? ((struct lex_rule *)ptr)->type : NULL;
+}
+
+const char *lex_rule_regex(void *ptr) {
+    return ptr ? ((struct lex_rule *)ptr)->regex : NULL;
+}
+
+int lex_rule_is_native(void *ptr) {
+    return ptr && ((struct lex_rule *)ptr)->scanner;
+}
+
+struct lex_scanner *lex_rule_scanner(void *ptr) {
+    return ptr ? ((struct lex_rule *)ptr)->scanner : NULL;
+}
+
 // delete a lex_rule structure
 int lex_rule_delete(void *ptr) {
     struct lex_rule *rule = (struct lex_rule *)ptr;
     if (!rule) return 0;
     free(rule->type);
     free(rule->regex);
+    free(rule->type_ids);
     free(rule);
     return 0;
 }
 
 
-// The main lex function
-list_t lex(char *lex_defs, char *source_file) {
+//kkkkkkk Profiling kkkkkkkkkk
+
+static double lex_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// try a rule at current: id of the type of the lexem, -1 if no match,
+// LEX_SCAN_MORE if a scanner needs to see past limit
+static int lex_rule_match(struct lex_rule *rule, char *current, char *limit, char **end) {
+    if (rule->scanner) {
+        int k = rule->scanner->scan(current, limit, end);
+        if (LEX_SCAN_MORE == k) return LEX_SCAN_MORE;
+        return k < 0 ? -1 : rule->type_ids[k];
+    }
+    return re_match(rule->regex, current, end) ? rule->type_id : -1;
+}
+
+// lex_rule_match() with the rule counters updated, only used when profiling
+static int lex_rule_match_profiled(struct lex_rule *rule, char *current, char *limit, char **end) {
+    double start = lex_clock();
+    int type_id = lex_rule_match(rule, current, limit, end);
+    rule->seconds += lex_clock() - start;
+
+    rule->attempts++;
+    if (type_id >= 0) {
+        if (*end == current) {
+            rule->empty_hits++;
+        } else {
+            rule->hits++;
+            rule->bytes += *end - current;
+        }
+    }
+    return type_id;
+}
+
+// entry of the rule in the totals of this thread, made if needed
+static struct lex_profile_entry *lex_profile_entry_of(const char *type, const char *regex, int rank) {
+    if (!lex_profile_mine) {
+        lex_profile_mine = calloc(1, sizeof(*lex_profile_mine));
+        assert(lex_profile_mine);
+    }
+    struct lex_profile *p = lex_profile_mine;
+
+    for (size_t i = 0; i < p->count; i++) {
+        if (0 == strcmp(p->table[i].type, type) && 0 == strcmp(p->table[i].regex, regex)) {
+            return &p->table[i];
+        }
+    }
+
+    struct lex_profile_entry *table = realloc(p->table, (p->count + 1) * sizeof(*table));
+    assert(table);
+    p->table = table;
+    struct lex_profile_entry *entry = &p->table[p->count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->type = strdup(type);
+    entry->regex = strdup(regex);
+    entry->rank = rank;
+    return entry;
+}
+
+static void lex_profile_free(struct lex_profile *p) {
+    if (!p) return;
+    for (size_t i = 0; i < p->count; i++) {
+        free(p->table[i].type);
+        free(p->table[i].regex);
+    }
+    free(p->table);
+    free(p);
+}
+
+// add the counters of one lex() run to the totals of this thread
+static void lex_profile_merge(list_t rules) {
+    int rank = 0;
+
+    for (list_t l = rules; !list_is_empty(l); l = list_next(l), rank++) {
+        struct lex_rule *rule = list_first(l);
+        struct lex_profile_entry *entry = lex_profile_entry_of(rule->type, rule->regex, rank);
+
+        entry->attempts += rule->attempts;
+        entry->hits += rule->hits;
+        entry->empty_hits += rule->empty_hits;
+        entry->bytes += rule->bytes;
+        entry->seconds += rule->seconds;
+    }
+}
+
+lex_profile_t lex_profile_take(void) {
+    lex_profile_t p = lex_profile_mine;
+    lex_profile_mine = NULL;
+    return p;
+}
+
+void lex_profile_add(lex_profile_t p) {
+    if (!p) return;
+    for (size_t i = 0; i < p->count; i++) {
+        struct lex_profile_entry *from = &p->table[i];
+        struct lex_profile_entry *entry = lex_profile_entry_of(from->type, from->regex, from->rank);
+
+        entry->attempts += from->attempts;
+        entry->hits += from->hits;
+        entry->empty_hits += from->empty_hits;
+        entry->bytes += from->bytes;
+        entry->seconds += from->seconds;
+    }
+    lex_profile_free(p);
+}
+
+unsigned long lex_profile_hits(const char *type, const char *regex) {
+    struct lex_profile *p = lex_profile_mine;
+
+    for (size_t i = 0; p && i < p->count; i++) {
+        if (0 == strcmp(p->table[i].type, type) && 0 == strcmp(p->table[i].regex, regex)) {
+            return p->table[i].hits;
+        }
+    }
+    return 0;
+}
+
+// most expensive rules first
+static int lex_profile_cmp(const void *a, const void *b) {
+    const struct lex_profile_entry *ea = a;
+    const struct lex_profile_entry *eb = b;
+
+    if (ea->seconds != eb->seconds) return ea->seconds < eb->seconds ? 1 : -1;
+    return ea->rank - eb->rank;
+}
+
+void lex_profile_print(FILE *fp) {
+    struct lex_profile *p = lex_profile_mine;
+    if (!p || 0 == p->count) return;
+
+    qsort(p->table, p->count, sizeof(*p->table), lex_profile_cmp);
+
+    double total = 0;
+    for (size_t i = 0; i < p->count; i++) total += p->table[i].seconds;
+
+    fprintf(fp, "\n ======== Lexer profile ========\n\n");
+    fprintf(fp, " %4s  %-24s %-20s %10s %9s %7s %10s %10s %6s\n",
+            "rank", "rule", "regexp", "attempts", "hits", "empty", "bytes", "ms", "%time");
+
+    for (size_t i = 0; i < p->count; i++) {
+        struct lex_profile_entry *e = &p->table[i];
+        fprintf(fp, " %4d  %-24s %-20.20s %10lu %9lu %7lu %10zu %10.3f %5.1f%%\n",
+                e->rank, e->type, e->regex, e->attempts, e->hits, e->empty_hits, e->bytes,
+                e->seconds * 1e3, total > 0 ? 100. * e->seconds / total : 0.);
+    }
+    fprintf(fp, "\n total time in re_match: %.3f ms\n", total * 1e3);
+}
+
+static void lex_profile_at_exit(void) {
+    lex_profile_print(stderr);
+    lex_profile_free(lex_profile_take());
+}
+
+void lex_profile_enable(void) {
+    if (lex_profiling <= 0) atexit(lex_profile_at_exit);
+    lex_profiling = 1;
+}
+
+int lex_profile_enabled(void) {
+    if (lex_profiling < 0) {
+        const char *env = getenv(LEX_PROFILE_ENV);
+        lex_profiling = 0;
+        if (env && *env && strcmp(env, "0")) lex_profile_enable();
+    }
+    return lex_profiling;
+}
+
+
+//kkkkkkk Trivia scanner (LEX_SKIP_TRIVIA) kkkkkkkkkk
+
+// length of the run of c1/c2 characters at p, which stops on the final '\0'
+static size_t span_of(const char *p, char c1, char c2) {
+    size_t n = 0;
+#ifdef __SSE2__
+    const __m128i v1 = _mm_set1_epi8(c1);
+    const __m128i v2 = _mm_set1_epi8(c2);
+    for (;;) {
+        // reading past the '\0' is fine thanks to READER_PADDING
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(p + n));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, v1),
+                                                  _mm_cmpeq_epi8(chunk, v2)));
+        if (mask != 0xFFFF) return n + __builtin_ctz(~mask);
+        n += 16;
+    }
+#else
+    while (p[n] == c1 || p[n] == c2) n++;
+    return n;
+#endif
+}
+
+// skip the trivia at *current and update the coordinates and the flags.
+// A comment that goes past the end of an incomplete window is left for
+// later: returns 1 if more input is needed, 0 otherwise
+static int skip_trivia(char **current, char *limit, int complete, int *flags, int *line, int *col) {
+    char *p = *current;
+    int starved = 0;
+
+    for (;;) {
+        size_t n;
+        if (*p == ' ' || *p == '\t') {
+            n = span_of(p, ' ', '\t');
+            *flags |= LEXEM_AFTER_BLANK;
+            *col += n;
+        } else if (*p == '\n') {
+            n = span_of(p, '\n', '\n');
+            if (!*flags) *flags |= LEXEM_NEWLINE_FIRST;
+            *flags |= LEXEM_AFTER_NEWLINE;
+            *line += n;
+            *col = 0;
+        } else if (*p == '#') {
+            char *eol = memchr(p, '\n', limit - p);
+            if (!eol && !complete) {
+                starved = 1;
+                break;
+            }
+            n = (eol ? eol : limit) - p;
+            *flags |= LEXEM_AFTER_COMMENT;
+            *col += n;
+        } else {
+            break;
+        }
+        p += n;
+    }
+
+    *current = p;
+    return starved;
+}
+
+
+// whether a regexp rule that did not match at current could still match
+// with what follows limit (scanners say it themselves)
+static int lex_rules_go_on(list_t rules, char *current, char *limit, int no_scanners) {
+    for (list_t l = rules; !list_is_empty(l); l = list_next(l)) {
+        struct lex_rule *rule = list_first(l);
+        if (rule->scanner || (!no_scanners && rule->shadowed)) continue;
+        if (re_goes_on(rule->regex, current, limit)) return 1;
+    }
+    return 0;
+}
+
+// The lexer reads its input through a sliding window (see reader.h). The
+// window holds at least LEX_LOOKAHEAD bytes from the current position
+// (unless the input ends before), and is grown whenever a match reaches
+// its end, so that no lexem is ever cut by a refill.
+#define LEX_LOOKAHEAD (64 * 1024)
+
+// where lex_batched() hands its full buffers
+struct lex_sink {
+    size_t     batch;
+    lex_emit_t emit;
+    void      *arg;
+};
+
+// sink is NULL for a single buffer, otherwise the buffer returned only
+// holds the tokens after the last full batch
+static tokbuf_t lex_reader(char *lex_defs, reader_t input, int options, struct lex_sink *sink) {
     // load lex rules
-    list_t rules = load_lex_rules(lex_defs);
+    list_t rules = lex_rules_load(lex_defs);
     if (!rules) return NULL;
 
-    // read the source code
-    char *source = read_file_content(source_file);
-    if (!source) return NULL;
+    tokbuf_t tokens = tokbuf_new();
+    for (list_t l = rules; !list_is_empty(l); l = list_next(l)) {
+        struct lex_rule *rule = list_first(l);
+        int type_id = 0;
 
-    queue_t lexems_queue = queue_new();
-    char *current = source;
+        // a scanner replaces the rules of its types written after it
+        for (list_t e = rules; e != l && !rule->scanner; e = list_next(e)) {
+            struct lex_rule *earlier = list_first(e);
+            for (int k = 0; earlier->scanner && earlier->scanner->types[k]; k++) {
+                if (0 == strcmp(earlier->scanner->types[k], rule->type)) rule->shadowed = 1;
+            }
+        }
+
+        if (rule->scanner) {
+            int n = 0;
+            while (rule->scanner->types[n]) n++;
+            rule->type_ids = calloc(n, sizeof(int));
+            assert(rule->type_ids);
+            for (int k = 0; k < n && type_id >= 0; k++) {
+                type_id = rule->type_ids[k] = tokbuf_type_id(tokens, rule->scanner->types[k]);
+            }
+        } else {
+            type_id = rule->type_id = tokbuf_type_id(tokens, rule->type);
+        }
+        if (type_id < 0) {
+            fprintf(stderr, "Error: too many lexem types in %s\n", lex_defs);
+            list_delete(rules, lex_rule_delete);
+            tokbuf_delete(tokens);
+            return NULL;
+        }
+    }
+
+    // re_match() builds and frees its regexp at each call: when the unit
+    // allocates from an arena, that memory is given back by rewinding it
+    arena_t unit = arena_current();
+    arena_mark_t mark = { NULL, 0 };
+    if (unit) mark = arena_mark(unit);
+
+    int profiling = lex_profile_enabled();
+    int skip = options & LEX_SKIP_TRIVIA;
+    int no_scanners = options & LEX_NO_SCANNERS;
+    int flags = 0; // trivia skipped before the next lexem
+    int failed = 0;
+
+    size_t lookahead = LEX_LOOKAHEAD;
     char *end = NULL; // a pointer that depends on the re-match
     int line = 1;
     int col = 0;
 
     // THE LOOP :o 
-    while (*current != '\0') {
-        int matched = 0;
-        
+    for (;;) {
+        if (reader_require(input, lookahead) < 0) {
+            failed = 1;
+            break;
+        }
+        char *current = reader_data(input);
+        char *limit = current + reader_available(input);
+        int complete = reader_eof(input); // the window holds the end of the input
+
+        if (skip) {
+            char *next = current;
+            int starved = skip_trivia(&next, limit, complete, &flags, &line, &col);
+            reader_advance(input, next - current);
+            current = next;
+
+            if (starved) lookahead = 2 * (limit - current);
+            if (starved || (current == limit && !complete)) continue;
+        }
+
+        if (*current == '\0') break;
+
+        struct lex_rule *matched = NULL;
+        int type_id = -1;
+        int more = 0; // a scanner tried before needs to see past limit
+
         // we read the lex rules in order
         list_t runner = rules; 
         
         while (!list_is_empty(runner)) {
             struct lex_rule *rule = list_first(runner);
-            //Now we use the rematch 
-            if (re_match(rule->regex, current, &end)) {
-                //we compare the regex with the current
-                // measure the length of the match
-                int length = end - current;
-                
-                // WARNING if legth = 0 we might fall into an infinite loop so we continue and ignore
-                if (length == 0) {
-                    runner = list_next(runner);
-                    continue; 
-                }
-
-                //Catch the value
-                char *value = calloc(length + 1, 1);
-                strncpy(value, current, length); // we copy the value from current with a length into value with strncpy
-
-                // Creation of lexem !
-                lexem_t new_lex = lexem_new(rule->type, value, line, col);
-                lexems_queue = enqueue(lexems_queue, new_lex);
-
-                // update the coordinate line/column
-                for (int i = 0; i < length; i++) {
-                    if (current[i] == '\n') {
-                        line++;
-                        col = 0;
-                    } else {
-                        col++;
-                    }
-                }
+            runner = list_next(runner);
+            if (no_scanners ? rule->scanner != NULL : rule->shadowed) continue;
 
-                //continue through the source code
-                current = end;
-                matched = 1;
-                free(value);
-                break; // We found a match we restart the loop
+            //Now we use the rematch 
+            type_id = profiling ? lex_rule_match_profiled(rule, current, limit, &end)
+                                : lex_rule_match(rule, current, limit, &end);
+            // WARNING if legth = 0 we might fall into an infinite loop so we continue and ignore
+            if (type_id >= 0 && end > current) {
+                matched = rule;
+                break; // We found a match
             }
+            more |= LEX_SCAN_MORE == type_id;
+        }
 
-            runner = list_next(runner);
+        // the lexem may go on after the window (or start to match only
+        // with more input): read more and try again. Without a match,
+        // only if one of the attempts got to the end of the window,
+        // otherwise the error is the same whatever comes next
+        int grow = !complete && (more || (matched ? end == limit : lex_rules_go_on(rules, current, limit, no_scanners)));
+        if (unit) arena_rewind(unit, mark);
+
+        if (grow) {
+            lookahead = 2 * (limit - current);
+            continue;
         }
 
         if (!matched) {
             // A case added if nothing matches :(
             fprintf(stderr, "[ERROR] Lexical error at %d:%d. Unexpected char: '%c'\n", 
                     line, col, *current);
+            failed = 1;
+            break;
+        }
 
-            ////printf of char after error for debug
-            //fprintf(stderr, "Next chars: ");
-            //for (int i = 0; i < 30 && current[i] != '\0'; i++) {
-            //    fprintf(stderr, "%c", current[i]);
-            //    if (current[i] == '\n') break;
-            //}
-            //fprintf(stderr, "\n");
+        // measure the length of the match
+        int length = end - current;
 
-            // Clean up and exit
-            free(source);
-            list_delete(rules, lex_rule_delete);
-            list_delete(queue_to_list(lexems_queue), lexem_delete);
-            
-            return NULL;
+        // Creation of lexem ! (its value is copied in the buffer)
+        tokbuf_append(tokens, type_id, current, length, line, col, flags);
+        flags = 0;
+
+        if (sink && tokbuf_count(tokens) == sink->batch) {
+            tokbuf_t full = tokens;
+            tokens = tokbuf_new_like(full);
+            if (sink->emit(full, sink->arg)) {
+                failed = 1;
+                break;
+            }
+        }
+
+        // update the coordinate line/column
+        for (int i = 0; i < length; i++) {
+            if (current[i] == '\n') {
+                line++;
+                col = 0;
+            } else {
+                col++;
+            }
         }
+
+        //continue through the source code
+        reader_advance(input, length);
+        lookahead = LEX_LOOKAHEAD;
     }
 
-    free(source);
+    if (profiling) lex_profile_merge(rules);
     // maybe we need to free the rules from memory too ? idk if this is how
     list_delete(rules, lex_rule_delete);
-    // Convert queue to list and return
-    list_t lexems = queue_to_list(lexems_queue);
+
+    if (failed) {
+        tokbuf_delete(tokens);
+        return NULL;
+    }
+    return tokens;
+}
+
+// lists of lexems are made from the token buffer
+static list_t tokens_to_lexems(tokbuf_t tokens) {
+    if (!tokens) return NULL;
+
+    list_t lexems = tokbuf_to_list(tokens);
+    tokbuf_delete(tokens);
     return lexems;
-}
\ No newline at end of file
+}
+
+
+// The main lex function
+list_t lex(char *lex_defs, char *source_file) {
+    return lex_with(lex_defs, source_file, 0);
+}
+
+list_t lex_with(char *lex_defs, char *source_file, int options) {
+    return tokens_to_lexems(lex_tokens(lex_defs, source_file, options));
+}
+
+tokbuf_t lex_tokens(char *lex_defs, char *source_file, int options) {
+    // read the source code ("-" is the standard input)
+    reader_t input = reader_open(source_file);
+    if (!input) return NULL;
+
+    tokbuf_t tokens = lex_reader(lex_defs, input, options, NULL);
+    reader_close(input);
+    return tokens;
+}
+
+int lex_batched(char *lex_defs, char *source_file, int options,
+                size_t batch, lex_emit_t emit, void *arg) {
+    reader_t input = reader_open(source_file);
+    if (!input) return -1;
+
+    struct lex_sink sink = { batch, emit, arg };
+    tokbuf_t rest = lex_reader(lex_defs, input, options, &sink);
+    reader_close(input);
+    if (!rest) return -1;
+
+    if (0 == tokbuf_count(rest)) {
+        tokbuf_delete(rest);
+        return 0;
+    }
+    return emit(rest, arg) ? -1 : 0;
+}
+
+list_t lex_fd(char *lex_defs, int fd, int options) {
+    reader_t input = reader_fdopen(fd);
+    tokbuf_t tokens = lex_reader(lex_defs, input, options, NULL);
+    reader_close(input);
+    return tokens_to_lexems(tokens);
+}
@@ -0,0 +1,139 @@
+/**
+ * @file reader.c
+ * @author Abdellah
+ * @brief Buffered, refillable input for the lexer
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <lexer/reader.h>
+
+// reads are done by whole chunks, into page-aligned memory
+#define READER_ALIGN 4096
+#define READER_CHUNK (64 * 1024)
+
+struct reader {
+    int     fd;
+    int     owns_fd;
+    char   *buffer;
+    size_t  capacity; // usable bytes, the padding comes after
+    size_t  pos;      // current position in buffer
+    size_t  end;      // end of the data read so far
+    int     eof;
+};
+
+static size_t align_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+static char *reader_alloc(size_t capacity) {
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, READER_ALIGN, capacity + READER_PADDING)) return NULL;
+    return buffer;
+}
+
+reader_t reader_fdopen( int fd ) {
+    reader_t r = calloc(1, sizeof(*r));
+    assert(r);
+
+    r->fd = fd;
+    r->capacity = 4 * READER_CHUNK;
+    r->buffer = reader_alloc(r->capacity);
+    assert(r->buffer);
+    memset(r->buffer, 0, READER_PADDING);
+
+    return r;
+}
+
+reader_t reader_open( char *filename ) {
+    if (0 == strcmp(filename, "-")) return reader_fdopen(STDIN_FILENO);
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Unable to open file");
+        return NULL;
+    }
+
+    reader_t r = reader_fdopen(fd);
+    r->owns_fd = 1;
+    return r;
+}
+
+void reader_close( reader_t r ) {
+    if (!r) return;
+    if (r->owns_fd) close(r->fd);
+    free(r->buffer);
+    free(r);
+}
+
+// make room for `room` more bytes after the window, keeping the window
+// contiguous. It is moved so that the next read starts on an aligned address.
+static int reader_make_room(reader_t r, size_t room) {
+    size_t kept = r->end - r->pos;
+    size_t offset = align_up(kept, READER_ALIGN) - kept;
+    size_t needed = offset + kept + room;
+
+    if (needed > r->capacity) {
+        size_t capacity = r->capacity;
+        while (capacity < needed) capacity *= 2;
+
+        char *buffer = reader_alloc(capacity);
+        if (!buffer) return -1;
+        memcpy(buffer + offset, r->buffer + r->pos, kept);
+        free(r->buffer);
+        r->buffer = buffer;
+        r->capacity = capacity;
+    } else {
+        memmove(r->buffer + offset, r->buffer + r->pos, kept);
+    }
+
+    r->pos = offset;
+    r->end = offset + kept;
+    return 0;
+}
+
+int reader_require( reader_t r, size_t n ) {
+    while (!r->eof && r->end - r->pos < n) {
+        if (r->capacity - r->end < READER_CHUNK) {
+            if (reader_make_room(r, align_up(n, READER_CHUNK)) < 0) return -1;
+        }
+
+        size_t size = (r->capacity - r->end) / READER_CHUNK * READER_CHUNK;
+        ssize_t got = read(r->fd, r->buffer + r->end, size);
+
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            perror("Unable to read file");
+            return -1;
+        }
+        if (got == 0) r->eof = 1;
+        r->end += got;
+    }
+
+    // the window always ends with '\0' padding
+    memset(r->buffer + r->end, 0, READER_PADDING);
+    return 0;
+}
+
+char *reader_data( reader_t r ) {
+    return r->buffer + r->pos;
+}
+
+size_t reader_available( reader_t r ) {
+    return r->end - r->pos;
+}
+
+int reader_eof( reader_t r ) {
+    return r->eof;
+}
+
+void reader_advance( reader_t r, size_t n ) {
+    assert(n <= r->end - r->pos);
+    r->pos += n;
+}
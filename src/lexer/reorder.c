@@ -0,0 +1,127 @@
+/**
+ * @file reorder.c
+ * @author Abdellah
+ * @brief Profile-guided reordering of the lexer rules
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include <generic/list.h>
+#include <regexp/overlap.h>
+#include <lexer/lexer.h>
+#include <lexer/reorder.h>
+#include <lexer/scanner.h>
+
+// the rules and what we know about them
+struct reorder {
+    size_t         n;
+    void         **rule;
+    unsigned long *hits;
+    size_t        *pending;  // overlapping rules that still have to be written before
+    char          *overlap;  // overlap[i * n + j] for i < j
+    int           *placed;
+    char         (*first)[256]; // the bytes the lexems of each rule can start with
+};
+
+static void first_bytes(void *rule, char first[256]) {
+    struct lex_scanner *scanner = lex_rule_scanner(rule);
+
+    if (!scanner) {
+        re_first_bytes((char *)lex_rule_regex(rule), first);
+        return;
+    }
+    memset(first, !scanner->first, 256);
+    first[0] = 0;
+    for (char *c = scanner->first; c && *c; c++) first[(unsigned char)*c] = 1;
+}
+
+// two rules can only match the same text if it starts with the same byte
+static int first_bytes_meet(char *a, char *b) {
+    for (int c = 1; c < 256; c++) {
+        if (a[c] && b[c]) return 1;
+    }
+    return 0;
+}
+
+static void reorder_analyse(struct reorder *r, list_t rules) {
+    size_t i = 0;
+    for (list_t l = rules; !list_is_empty(l); l = list_next(l), i++) {
+        r->rule[i] = list_first(l);
+        r->hits[i] = lex_profile_hits(lex_rule_type(r->rule[i]), lex_rule_regex(r->rule[i]));
+        first_bytes(r->rule[i], r->first[i]);
+    }
+
+    // an earlier rule that may match the same text as a later one must stay before it
+    // (a native scanner is only known by the bytes its lexems start with)
+    for (i = 0; i < r->n; i++) {
+        for (size_t j = i + 1; j < r->n; j++) {
+            int native = lex_rule_is_native(r->rule[i]) || lex_rule_is_native(r->rule[j]);
+
+            if (!first_bytes_meet(r->first[i], r->first[j])) continue;
+            if (native || 0 != re_overlap((char *)lex_rule_regex(r->rule[i]), (char *)lex_rule_regex(r->rule[j]))) {
+                r->overlap[i * r->n + j] = 1;
+                r->pending[j]++;
+            }
+        }
+    }
+}
+
+static void reorder_write(struct reorder *r, FILE *f, char *lex_defs) {
+    fprintf(f, "# Rules of %s, reordered by lexer hit count.\n", lex_defs);
+    fprintf(f, "# Rules that can match the same text keep their original order.\n\n");
+
+    // among the rules free to go next, take the most used one (file order on ties).
+    // Overlaps only point forward so there is always one.
+    for (size_t k = 0; k < r->n; k++) {
+        size_t best = r->n;
+        for (size_t i = 0; i < r->n; i++) {
+            if (r->placed[i] || r->pending[i]) continue;
+            if (best == r->n || r->hits[i] > r->hits[best]) best = i;
+        }
+        assert(best < r->n);
+
+        r->placed[best] = 1;
+        for (size_t j = best + 1; j < r->n; j++) {
+            if (r->overlap[best * r->n + j]) r->pending[j]--;
+        }
+        fprintf(f, "%s    %s\n", lex_rule_type(r->rule[best]), lex_rule_regex(r->rule[best]));
+    }
+}
+
+int lex_rules_reorder(char *lex_defs, char *out_file) {
+    list_t rules = lex_rules_load(lex_defs);
+    if (!rules) return -1;
+
+    struct reorder r;
+    r.n = list_length(rules);
+    r.rule = calloc(r.n, sizeof(*r.rule));
+    r.hits = calloc(r.n, sizeof(*r.hits));
+    r.pending = calloc(r.n, sizeof(*r.pending));
+    r.overlap = calloc(r.n * r.n, 1);
+    r.placed = calloc(r.n, sizeof(*r.placed));
+    r.first = calloc(r.n, sizeof(*r.first));
+    assert(r.rule && r.hits && r.pending && r.overlap && r.placed && r.first);
+
+    reorder_analyse(&r, rules);
+
+    int res = -1;
+    FILE *f = fopen(out_file, "w");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot write %s\n", out_file);
+    } else {
+        reorder_write(&r, f, lex_defs);
+        res = fclose(f) ? -1 : 0;
+    }
+
+    free(r.rule);
+    free(r.hits);
+    free(r.pending);
+    free(r.overlap);
+    free(r.placed);
+    free(r.first);
+    list_delete(rules, lex_rule_delete);
+    return res;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file scanner.c
+ * @author Abdellah
+ * @brief Native scanners usable as lexer rules
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <lexer/scanner.h>
+
+static struct lex_scanner *scanners = NULL;
+static int scanner_count = 0;
+static int builtins_registered = 0;
+
+// number::floatexp is never returned (see lex_scan_number) but its rule
+// is replaced all the same
+static char *number_types[] = {
+    "number::hex", "number::bin", "number::oct", "number::floatexp",
+    "number::float", "number::uint", "number::int", NULL
+};
+enum { NUMBER_HEX, NUMBER_BIN, NUMBER_OCT, NUMBER_FLOATEXP,
+       NUMBER_FLOAT, NUMBER_UINT, NUMBER_INT };
+
+static char *string_types[] = { "string::double", "string::single", NULL };
+enum { STRING_DOUBLE, STRING_SINGLE };
+
+static void register_builtins(void) {
+    if (builtins_registered) return;
+    builtins_registered = 1;
+    lex_scanner_register("number", number_types, lex_scan_number, "-0123456789");
+    lex_scanner_register("string", string_types, lex_scan_string, "\"'");
+}
+
+int lex_scanner_register(char *name, char **types, lex_scan_t scan, char *first) {
+    register_builtins();
+    if (lex_scanner_find(name)) return -1;
+
+    struct lex_scanner *grown = realloc(scanners, (scanner_count + 1) * sizeof(*grown));
+    assert(grown);
+    scanners = grown;
+    scanners[scanner_count].name = name;
+    scanners[scanner_count].types = types;
+    scanners[scanner_count].scan = scan;
+    scanners[scanner_count].first = first;
+    scanner_count++;
+    return 0;
+}
+
+struct lex_scanner *lex_scanner_find(const char *name) {
+    register_builtins();
+    for (int i = 0; i < scanner_count; i++) {
+        if (0 == strcmp(scanners[i].name, name)) return &scanners[i];
+    }
+    return NULL;
+}
+
+
+//kkkkkkk Numbers kkkkkkkkkk
+
+static int is_digit(char c)     { return c >= '0' && c <= '9'; }
+static int is_bin_digit(char c) { return c == '0' || c == '1'; }
+static int is_oct_digit(char c) { return c >= '0' && c <= '7'; }
+static int is_hex_digit(char c) {
+    return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static char *skip_digits(char *p, int (*is_in_base)(char)) {
+    while (is_in_base(*p)) p++;
+    return p;
+}
+
+// The regexp rules are tried in this order, the first one wins:
+//   hex 0x[0-9a-fA-F]+   bin 0b[01]+   oct 0o[0-7]+
+//   float [0-9]+\.[0-9]*   uint [0-9]+   int -?[0-9]+
+// number::floatexp is left out: its regexp ([-\+] in a group) is
+// rejected by re_match(), so it never produces a lexem.
+int lex_scan_number(char *current, char *limit, char **end) {
+    char *p = current;
+    // digits stop on the '\0' after the window
+
+    if ('-' == *p) {
+        if (p + 1 == limit) return LEX_SCAN_MORE;
+        if (!is_digit(p[1])) return -1;
+        *end = skip_digits(p + 1, is_digit);
+        return NUMBER_INT;
+    }
+    if (!is_digit(*p)) return -1;
+
+    if ('0' == p[0]) {
+        if ('x' == p[1] && is_hex_digit(p[2])) {
+            *end = skip_digits(p + 2, is_hex_digit);
+            return NUMBER_HEX;
+        }
+        if ('b' == p[1] && is_bin_digit(p[2])) {
+            *end = skip_digits(p + 2, is_bin_digit);
+            return NUMBER_BIN;
+        }
+        if ('o' == p[1] && is_oct_digit(p[2])) {
+            *end = skip_digits(p + 2, is_oct_digit);
+            return NUMBER_OCT;
+        }
+    }
+
+    p = skip_digits(p, is_digit);
+    if ('.' == *p) {
+        *end = skip_digits(p + 1, is_digit);
+        return NUMBER_FLOAT;
+    }
+    *end = p;
+    return NUMBER_UINT;
+}
+
+
+//kkkkkkk Strings kkkkkkkkkk
+
+// "^["]*" and '^[']*' : the closing quote is found with memchr(), then
+// the content is checked like the negated group would (chars 1..127).
+int lex_scan_string(char *current, char *limit, char **end) {
+    char quote = *current;
+    if ('"' != quote && '\'' != quote) return -1;
+
+    char *close = memchr(current + 1, quote, limit - (current + 1));
+
+    for (unsigned char *c = (unsigned char *)current + 1; c < (unsigned char *)(close ? close : limit); c++) {
+        if (0 == *c || *c >= 128) return -1;
+    }
+    // the closing quote may come after the window
+    if (NULL == close) return LEX_SCAN_MORE;
+
+    *end = close + 1;
+    return '"' == quote ? STRING_DOUBLE : STRING_SINGLE;
+}
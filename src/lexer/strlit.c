@@ -0,0 +1,103 @@
+/**
+ * @file strlit.c
+ * @author Abdellah
+ * @brief Decoding of string literals
+ */
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <lexer/strlit.h>
+
+// length of the run without backslash at p (at most n bytes)
+static size_t span_no_backslash(const char *p, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for ( ; i + 16 <= n; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(p + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#endif
+    const char *found = memchr(p + i, '\\', n - i);
+    return found ? (size_t)(found - p) : n;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int is_oct_digit(char c) { return c >= '0' && c <= '7'; }
+
+long strlit_decode(const char *literal, size_t length, char *out) {
+    if (length < 2 || (literal[0] != '"' && literal[0] != '\'') || literal[length - 1] != literal[0]) {
+        return -1;
+    }
+
+    // between the quotes
+    const char *p = literal + 1;
+    const char *end = literal + length - 1;
+    char *o = out;
+
+    while (p < end) {
+        size_t run = span_no_backslash(p, end - p);
+        memcpy(o, p, run);
+        o += run;
+        p += run;
+        if (p == end) break;
+
+        // p is on a backslash: a lone one at the end is kept
+        if (p + 1 == end) {
+            *o++ = *p++;
+            break;
+        }
+
+        char c = p[1];
+        p += 2;
+        switch (c) {
+            case 'n':  *o++ = '\n'; break;
+            case 't':  *o++ = '\t'; break;
+            case 'r':  *o++ = '\r'; break;
+            case 'a':  *o++ = '\a'; break;
+            case 'b':  *o++ = '\b'; break;
+            case 'f':  *o++ = '\f'; break;
+            case 'v':  *o++ = '\v'; break;
+            case '\\': *o++ = '\\'; break;
+            case '\'': *o++ = '\''; break;
+            case '"':  *o++ = '"';  break;
+            case '\n': break;
+
+            case 'x': {
+                int high = p < end ? hex_value(p[0]) : -1;
+                int low = p + 1 < end ? hex_value(p[1]) : -1;
+                if (high < 0 || low < 0) return -1;
+                *o++ = (char)(high << 4 | low);
+                p += 2;
+                break;
+            }
+
+            default:
+                if (is_oct_digit(c)) {
+                    int value = c - '0';
+                    for (int digits = 1; digits < 3 && p < end && is_oct_digit(*p); digits++) {
+                        value = value * 8 + (*p++ - '0');
+                    }
+                    *o++ = (char)value;
+                } else {
+                    // unknown escape: Python keeps it
+                    *o++ = '\\';
+                    *o++ = c;
+                }
+                break;
+        }
+    }
+
+    return o - out;
+}
@@ -0,0 +1,319 @@
+/**
+ * @file tokbuf.c
+ * @author Abdellah
+ * @brief Compact token buffer
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include <generic/intern.h>
+#include <generic/list.h>
+#include <generic/queue.h>
+#include <lexer/lexem.h>
+#include <lexer/tokbuf.h>
+
+// borrowed lexems (tokbuf_view) are allocated TOKBUF_VIEW_BLOCK at a time
+#define TOKBUF_VIEW_BLOCK 1024
+
+// the absolute line is stored every TOKBUF_CHECKPOINT tokens,
+// so finding the line of a token sums at most that many deltas
+#define TOKBUF_CHECKPOINT 64
+
+// line deltas and columns that do not fit in 16 bits are marked with
+// TOKBUF_ESCAPE and stored exactly in a side table
+#define TOKBUF_ESCAPE UINT16_MAX
+
+#define TOKBUF_MAX_TYPES UINT16_MAX
+
+struct tokbuf_escape {
+    size_t index;
+    int    line;
+    int    column;
+};
+
+struct tokbuf {
+    size_t    count;
+    size_t    capacity;
+
+    // one entry per token
+    uint16_t *type;
+    uint8_t  *flags;
+    uint32_t *offset;
+    uint32_t *length;
+    uint16_t *line_delta;
+    uint16_t *column;
+
+    // one entry per TOKBUF_CHECKPOINT tokens
+    int      *checkpoint;
+
+    // exact coordinates of the tokens with an escaped delta or column
+    struct tokbuf_escape *escapes;
+    size_t    escape_count;
+    size_t    escape_capacity;
+    int       last_line;
+
+    // values, each one followed by '\0'
+    char     *text;
+    size_t    text_size;
+    size_t    text_capacity;
+
+    // type names, interned
+    const char **types;
+    int       type_count;
+    int       type_capacity;
+
+    // blocks of borrowed lexems, filled in the order they are asked for
+    lexem_t  *views;
+    size_t    view_blocks;
+    size_t    view_count;
+};
+
+static void *grow(void *array, size_t count, size_t size) {
+    void *grown = realloc(array, count * size);
+    assert(grown);
+    return grown;
+}
+
+tokbuf_t tokbuf_new( void ) {
+    tokbuf_t tb = calloc(1, sizeof(*tb));
+    assert(tb);
+    tb->last_line = 1;
+    return tb;
+}
+
+tokbuf_t tokbuf_new_like( tokbuf_t model ) {
+    tokbuf_t tb = tokbuf_new();
+
+    if (model->type_count) {
+        tb->types = grow(NULL, model->type_capacity, sizeof(*tb->types));
+        memcpy(tb->types, model->types, model->type_count * sizeof(*tb->types));
+        tb->type_count = model->type_count;
+        tb->type_capacity = model->type_capacity;
+    }
+    return tb;
+}
+
+int tokbuf_delete( void *_tb ) {
+    tokbuf_t tb = _tb;
+    if (!tb) return 0;
+
+    free(tb->type);
+    free(tb->flags);
+    free(tb->offset);
+    free(tb->length);
+    free(tb->line_delta);
+    free(tb->column);
+    free(tb->checkpoint);
+    free(tb->escapes);
+    free(tb->text);
+    free(tb->types);
+    for (size_t i = 0; i < tb->view_blocks; i++) lexem_array_delete(tb->views[i]);
+    free(tb->views);
+    free(tb);
+    return 0;
+}
+
+int tokbuf_type_id( tokbuf_t tb, const char *type ) {
+    const char *canonical = intern(type);
+
+    for (int i = 0; i < tb->type_count; i++) {
+        if (tb->types[i] == canonical) return i;
+    }
+    if (tb->type_count == TOKBUF_MAX_TYPES) return -1;
+
+    if (tb->type_count == tb->type_capacity) {
+        tb->type_capacity = tb->type_capacity ? 2 * tb->type_capacity : 64;
+        tb->types = grow(tb->types, tb->type_capacity, sizeof(*tb->types));
+    }
+    tb->types[tb->type_count] = canonical;
+    return tb->type_count++;
+}
+
+static void tokbuf_reserve(tokbuf_t tb, size_t count) {
+    if (count <= tb->capacity) return;
+
+    size_t capacity = tb->capacity ? tb->capacity : 1024;
+    while (capacity < count) capacity *= 2;
+
+    tb->type = grow(tb->type, capacity, sizeof(*tb->type));
+    tb->flags = grow(tb->flags, capacity, sizeof(*tb->flags));
+    tb->offset = grow(tb->offset, capacity, sizeof(*tb->offset));
+    tb->length = grow(tb->length, capacity, sizeof(*tb->length));
+    tb->line_delta = grow(tb->line_delta, capacity, sizeof(*tb->line_delta));
+    tb->column = grow(tb->column, capacity, sizeof(*tb->column));
+    tb->checkpoint = grow(tb->checkpoint, capacity / TOKBUF_CHECKPOINT + 1, sizeof(*tb->checkpoint));
+    tb->capacity = capacity;
+}
+
+static void tokbuf_reserve_text(tokbuf_t tb, size_t size) {
+    if (size <= tb->text_capacity) return;
+
+    size_t capacity = tb->text_capacity ? tb->text_capacity : 16 * 1024;
+    while (capacity < size) capacity *= 2;
+
+    tb->text = grow(tb->text, capacity, 1);
+    tb->text_capacity = capacity;
+}
+
+size_t tokbuf_append( tokbuf_t tb, int type_id, const char *value, size_t length,
+                      int line, int column, int flags ) {
+    size_t i = tb->count;
+
+    assert(type_id >= 0 && type_id < tb->type_count);
+    assert(tb->text_size + length + 1 <= UINT32_MAX);
+
+    tokbuf_reserve(tb, i + 1);
+    tokbuf_reserve_text(tb, tb->text_size + length + 1);
+
+    tb->type[i] = (uint16_t)type_id;
+    tb->flags[i] = (uint8_t)flags;
+    tb->offset[i] = (uint32_t)tb->text_size;
+    tb->length[i] = (uint32_t)length;
+
+    memcpy(tb->text + tb->text_size, value, length);
+    tb->text[tb->text_size + length] = '\0';
+    tb->text_size += length + 1;
+
+    int delta = line - tb->last_line;
+    if (0 == i % TOKBUF_CHECKPOINT) {
+        tb->checkpoint[i / TOKBUF_CHECKPOINT] = line;
+        delta = 0;
+    }
+
+    if (delta < 0 || delta >= TOKBUF_ESCAPE || column < 0 || column >= TOKBUF_ESCAPE) {
+        if (tb->escape_count == tb->escape_capacity) {
+            tb->escape_capacity = tb->escape_capacity ? 2 * tb->escape_capacity : 16;
+            tb->escapes = grow(tb->escapes, tb->escape_capacity, sizeof(*tb->escapes));
+        }
+        tb->escapes[tb->escape_count].index = i;
+        tb->escapes[tb->escape_count].line = line;
+        tb->escapes[tb->escape_count].column = column;
+        tb->escape_count++;
+
+        tb->line_delta[i] = TOKBUF_ESCAPE;
+        tb->column[i] = TOKBUF_ESCAPE;
+    } else {
+        tb->line_delta[i] = (uint16_t)delta;
+        tb->column[i] = (uint16_t)column;
+    }
+
+    tb->last_line = line;
+    tb->count++;
+    return i;
+}
+
+size_t tokbuf_count( tokbuf_t tb ) {
+    return tb ? tb->count : 0;
+}
+
+int tokbuf_type_of( tokbuf_t tb, size_t i ) {
+    assert(i < tb->count);
+    return tb->type[i];
+}
+
+const char *tokbuf_type( tokbuf_t tb, size_t i ) {
+    assert(i < tb->count);
+    return tb->types[tb->type[i]];
+}
+
+const char *tokbuf_value( tokbuf_t tb, size_t i ) {
+    assert(i < tb->count);
+    return tb->text + tb->offset[i];
+}
+
+size_t tokbuf_length( tokbuf_t tb, size_t i ) {
+    assert(i < tb->count);
+    return tb->length[i];
+}
+
+int tokbuf_flags( tokbuf_t tb, size_t i ) {
+    assert(i < tb->count);
+    return tb->flags[i];
+}
+
+// escapes are appended in token order, so they are sorted by index
+static struct tokbuf_escape *tokbuf_escape_of(tokbuf_t tb, size_t i) {
+    size_t lo = 0, hi = tb->escape_count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (tb->escapes[mid].index < i) lo = mid + 1;
+        else hi = mid;
+    }
+    assert(lo < tb->escape_count && tb->escapes[lo].index == i);
+    return &tb->escapes[lo];
+}
+
+int tokbuf_line( tokbuf_t tb, size_t i ) {
+    assert(i < tb->count);
+
+    if (TOKBUF_ESCAPE == tb->line_delta[i]) return tokbuf_escape_of(tb, i)->line;
+
+    // go back to the closest checkpoint or escaped token, then add the deltas
+    size_t first = i - i % TOKBUF_CHECKPOINT;
+    size_t k = i;
+    while (k > first && TOKBUF_ESCAPE != tb->line_delta[k]) k--;
+
+    int line = TOKBUF_ESCAPE == tb->line_delta[k] ? tokbuf_escape_of(tb, k)->line
+                                                   : tb->checkpoint[i / TOKBUF_CHECKPOINT];
+    for (k = k + 1; k <= i; k++) line += tb->line_delta[k];
+    return line;
+}
+
+int tokbuf_column( tokbuf_t tb, size_t i ) {
+    assert(i < tb->count);
+
+    if (TOKBUF_ESCAPE == tb->column[i]) return tokbuf_escape_of(tb, i)->column;
+    return tb->column[i];
+}
+
+lexem_t tokbuf_lexem( tokbuf_t tb, size_t i ) {
+    lexem_t lex = lexem_new((char *)tokbuf_type(tb, i), (char *)tokbuf_value(tb, i),
+                            tokbuf_line(tb, i), tokbuf_column(tb, i));
+    lexem_set_flags(lex, tokbuf_flags(tb, i));
+    return lex;
+}
+
+lexem_t tokbuf_view( tokbuf_t tb, size_t i ) {
+    assert(i < tb->count);
+
+    // only the tokens which are asked for take room: the parser keeps
+    // the instructions, not the blanks, comments and newlines around them
+    size_t block = tb->view_count / TOKBUF_VIEW_BLOCK;
+    if (block == tb->view_blocks) {
+        tb->views = grow(tb->views, block + 1, sizeof(*tb->views));
+        tb->views[block] = lexem_array_new(TOKBUF_VIEW_BLOCK);
+        tb->view_blocks = block + 1;
+    }
+
+    lexem_t lex = lexem_array_at(tb->views[block], tb->view_count++ % TOKBUF_VIEW_BLOCK);
+    lexem_set(lex, tokbuf_type(tb, i), tokbuf_value(tb, i), tokbuf_length(tb, i),
+              tokbuf_line(tb, i), tokbuf_column(tb, i), tokbuf_flags(tb, i));
+    return lex;
+}
+
+list_t tokbuf_to_list( tokbuf_t tb ) {
+    queue_t q = queue_new();
+
+    for (size_t i = 0; i < tokbuf_count(tb); i++) {
+        q = enqueue(q, tokbuf_lexem(tb, i));
+    }
+    return queue_to_list(q);
+}
+
+tokbuf_t tokbuf_from_list( list_t lexems ) {
+    tokbuf_t tb = tokbuf_new();
+
+    for ( ; !list_is_empty(lexems); lexems = list_next(lexems)) {
+        lexem_t lex = list_first(lexems);
+        const char *type = lexem_type(lex) ? lexem_type(lex) : "";
+        const char *value = lexem_value(lex) ? lexem_value(lex) : "";
+
+        tokbuf_append(tb, tokbuf_type_id(tb, type), value, strlen(value),
+                      lexem_line(lex), lexem_column(lex), lexem_flags(lex));
+    }
+    return tb;
+}
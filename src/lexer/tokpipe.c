@@ -0,0 +1,151 @@
+/**
+ * @file tokpipe.c
+ * @author Abdellah
+ * @brief Lexer running on its own thread
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <generic/arena.h>
+#include <generic/ring.h>
+#include <lexer/lexer.h>
+#include <lexer/tokpipe.h>
+
+// a side waiting for the other yields TOKPIPE_SPINS times, then sleeps
+// TOKPIPE_NAP ns at a time, so that a waiting parser does not hold a core
+#define TOKPIPE_SPINS 64
+#define TOKPIPE_NAP   (50 * 1000)
+
+struct tokpipe {
+    char       *lex_defs;
+    char       *source_file;
+    int         options;
+    int         scratch;  // the lexer thread makes its own arena
+
+    ring_t      queue;
+    pthread_t   thread;
+    atomic_int  discard;  // the reader is done: drop the next buffers
+    int         joined;
+
+    // written by the lexer thread, read once it is joined
+    int         status;
+    size_t      count;
+    lex_profile_t profile;
+
+    // buffers handed out, deleted with the pipe
+    tokbuf_t   *read;
+    size_t      read_count;
+    size_t      read_capacity;
+};
+
+static void tokpipe_wait(unsigned *spins) {
+    if (++*spins < TOKPIPE_SPINS) {
+        sched_yield();
+    } else {
+        struct timespec nap = { 0, TOKPIPE_NAP };
+        nanosleep(&nap, NULL);
+    }
+}
+
+static int tokpipe_emit(tokbuf_t tokens, void *arg) {
+    tokpipe_t p = arg;
+    unsigned spins = 0;
+
+    p->count += tokbuf_count(tokens);
+    while (!atomic_load(&p->discard)) {
+        if (ring_push(p->queue, tokens)) return 0;
+        tokpipe_wait(&spins);
+    }
+    // the rest of the input is still lexed, for its errors
+    tokbuf_delete(tokens);
+    return 0;
+}
+
+static void *tokpipe_lex(void *arg) {
+    tokpipe_t p = arg;
+
+    arena_t scratch = p->scratch ? arena_new(0) : NULL;
+    arena_set_current(scratch);
+
+    p->status = lex_batched(p->lex_defs, p->source_file, p->options,
+                            TOKPIPE_BATCH, tokpipe_emit, p);
+
+    arena_set_current(NULL);
+    arena_delete(scratch);
+
+    p->profile = lex_profile_take();
+    ring_close(p->queue);
+    return NULL;
+}
+
+tokpipe_t tokpipe_open( char *lex_defs, char *source_file, int options ) {
+    tokpipe_t p = calloc(1, sizeof(*p));
+    assert(p);
+
+    p->lex_defs = lex_defs;
+    p->source_file = source_file;
+    p->options = options;
+    p->scratch = NULL != arena_current();
+    p->queue = ring_new(TOKPIPE_QUEUE);
+    atomic_init(&p->discard, 0);
+    lex_profile_enabled(); // decided here, only read by the lexer thread
+
+    if (pthread_create(&p->thread, NULL, tokpipe_lex, p)) {
+        ring_delete(p->queue, NULL);
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+tokbuf_t tokpipe_next( tokpipe_t p ) {
+    void *tokens = NULL;
+    unsigned spins = 0;
+
+    if (p->joined) return NULL;
+
+    for (;;) {
+        // closed before the pop: nothing can come after a failed pop then
+        int closed = ring_closed(p->queue);
+        if (ring_pop(p->queue, &tokens)) break;
+        if (closed) return NULL;
+        tokpipe_wait(&spins);
+    }
+
+    if (p->read_count == p->read_capacity) {
+        p->read_capacity = p->read_capacity ? 2 * p->read_capacity : 64;
+        p->read = realloc(p->read, p->read_capacity * sizeof(*p->read));
+        assert(p->read);
+    }
+    p->read[p->read_count++] = tokens;
+    return tokens;
+}
+
+int tokpipe_finish( tokpipe_t p ) {
+    if (!p->joined) {
+        atomic_store(&p->discard, 1);
+        pthread_join(p->thread, NULL);
+        p->joined = 1;
+        lex_profile_add(p->profile);
+        p->profile = NULL;
+
+        void *tokens;
+        while (ring_pop(p->queue, &tokens)) tokbuf_delete(tokens);
+    }
+    return (p->status < 0 || 0 == p->count) ? -1 : 0;
+}
+
+void tokpipe_delete( tokpipe_t p ) {
+    if (!p) return;
+
+    tokpipe_finish(p);
+    for (size_t i = 0; i < p->read_count; i++) tokbuf_delete(p->read[i]);
+    free(p->read);
+    ring_delete(p->queue, NULL);
+    free(p);
+}
@@ -0,0 +1,186 @@
+/**
+ * @file aside.c
+ * @author Abdellah
+ * @brief Data kept aside for code objects.
+ *
+ * What the parser hands to pyasm and struct pyobj has no room for.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <generic/arena.h>
+#include <generic/hashmap.h>
+#include <generic/vector.h>
+#include <parser/aside.h>
+
+/* the code objects of an arena that have data aside */
+struct owner {
+  arena_t  arena;
+  vector_t codes;
+};
+
+struct entry {
+  struct owner *owner; /* NULL: no arena, pyobj_delete() takes it back */
+  void         *data[ ASIDE_KINDS ];
+  action_t      delete_[ ASIDE_KINDS ];
+};
+
+static struct {
+  pthread_mutex_t lock;
+  hashmap_t       entries; /* code object -> entry */
+  hashmap_t       owners;  /* arena -> owner */
+} aside = { PTHREAD_MUTEX_INITIALIZER, NULL, NULL };
+
+/* called without the lock: the callbacks may take it */
+static void entry_delete( struct entry *e ) {
+  int k;
+
+  for ( k = 0 ; k < ASIDE_KINDS ; k++ ) {
+    if ( e->data[ k ] && e->delete_[ k ] ) e->delete_[ k ]( e->data[ k ] );
+  }
+  free( e );
+}
+
+/* the arena of the owner is reset or deleted */
+static int owner_release( void *arg ) {
+  struct owner *o     = arg;
+  vector_t      gone  = vector_new();
+  size_t        i;
+
+  pthread_mutex_lock( &aside.lock );
+  for ( i = 0 ; i < vector_length( o->codes ) ; i++ ) {
+    pyobj_t  code = vector_get_at( o->codes, i );
+    void    *found;
+
+    /* taken back earlier, the address may have a new entry since */
+    if ( !hashmap_find_int( aside.entries, (uintptr_t)code, &found ) ) continue;
+    if ( o != ( (struct entry *)found )->owner ) continue;
+
+    hashmap_remove_int( aside.entries, (uintptr_t)code, NULL );
+    vector_append( gone, found );
+  }
+  hashmap_remove_int( aside.owners, (uintptr_t)o->arena, NULL );
+  pthread_mutex_unlock( &aside.lock );
+
+  for ( i = 0 ; i < vector_length( gone ) ; i++ ) entry_delete( vector_get_at( gone, i ) );
+  vector_delete( gone, NULL );
+  vector_delete( o->codes, NULL );
+  free( o );
+
+  return 0;
+}
+
+static int entry_delete_cb( void *e ) {
+  entry_delete( e );
+  return 0;
+}
+
+static int owner_delete_cb( void *o ) {
+  vector_delete( ( (struct owner *)o )->codes, NULL );
+  free( o );
+  return 0;
+}
+
+/* what no arena release took back */
+static void aside_at_exit( void ) {
+  pthread_mutex_lock( &aside.lock );
+  hashmap_delete( aside.entries, entry_delete_cb );
+  hashmap_delete( aside.owners, owner_delete_cb );
+  aside.entries = NULL;
+  aside.owners  = NULL;
+  pthread_mutex_unlock( &aside.lock );
+}
+
+/* called with the lock held */
+static struct owner *owner_of( arena_t arena ) {
+  void         *found;
+  struct owner *o;
+
+  if ( !arena ) return NULL;
+  if ( hashmap_find_int( aside.owners, (uintptr_t)arena, &found ) ) return found;
+
+  o = calloc( 1, sizeof( *o ) );
+  assert( o );
+  o->arena = arena;
+  o->codes = vector_new();
+  hashmap_put_int( aside.owners, (uintptr_t)arena, o );
+  arena_on_reset( arena, owner_release, o );
+
+  return o;
+}
+
+void  aside_put( pyobj_t code, int kind, void *data, action_t delete_ ) {
+  void         *found    = NULL;
+  void         *previous = NULL;
+  action_t      drop     = NULL;
+  struct entry *e;
+
+  assert( code && kind >= 0 && kind < ASIDE_KINDS );
+
+  pthread_mutex_lock( &aside.lock );
+  if ( !aside.entries ) {
+    aside.entries = hashmap_new_int();
+    aside.owners  = hashmap_new_int();
+    atexit( aside_at_exit );
+  }
+
+  if ( hashmap_find_int( aside.entries, (uintptr_t)code, &found ) ) {
+    e = found;
+  }
+  else {
+    e = calloc( 1, sizeof( *e ) );
+    assert( e );
+    e->owner = owner_of( arena_current() );
+    if ( e->owner ) vector_append( e->owner->codes, code );
+    hashmap_put_int( aside.entries, (uintptr_t)code, e );
+  }
+
+  previous = e->data[ kind ];
+  drop     = e->delete_[ kind ];
+  e->data[ kind ]    = data;
+  e->delete_[ kind ] = delete_;
+  pthread_mutex_unlock( &aside.lock );
+
+  if ( previous && previous != data && drop ) drop( previous );
+}
+
+static void *aside_find( pyobj_t code, int kind, int take ) {
+  void         *found = NULL;
+  void         *data  = NULL;
+  struct entry *e;
+  int           k;
+
+  assert( kind >= 0 && kind < ASIDE_KINDS );
+
+  pthread_mutex_lock( &aside.lock );
+  if ( aside.entries && hashmap_find_int( aside.entries, (uintptr_t)code, &found ) ) {
+    e    = found;
+    data = e->data[ kind ];
+
+    if ( take ) {
+      e->data[ kind ]    = NULL;
+      e->delete_[ kind ] = NULL;
+
+      for ( k = 0 ; k < ASIDE_KINDS && !e->data[ k ] ; k++ );
+      /* nothing left: the entry goes (the owner skips it) */
+      if ( ASIDE_KINDS == k ) {
+        hashmap_remove_int( aside.entries, (uintptr_t)code, NULL );
+        free( e );
+      }
+    }
+  }
+  pthread_mutex_unlock( &aside.lock );
+
+  return data;
+}
+
+void *aside_get( pyobj_t code, int kind ) {
+  return aside_find( code, kind, 0 );
+}
+
+void *aside_take( pyobj_t code, int kind ) {
+  return aside_find( code, kind, 1 );
+}
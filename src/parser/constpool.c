@@ -0,0 +1,285 @@
+/**
+ * @file constpool.c
+ * @author Abdellah
+ * @brief Constant pools.
+ *
+ * Structural hashing and equality of python objects, merging of
+ * duplicate constants and names.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <generic/chain.h>
+#include <parser/constpool.h>
+
+#define OP_LOAD_CONST 0x64
+
+static int merge_flags = 0;
+
+void     constpool_enable( int flags ) {
+  merge_flags = flags;
+}
+
+int      constpool_enabled( void ) {
+  return merge_flags;
+}
+
+/* the splitmix64 finaliser, as in hashmap.c */
+static uint64_t mix( uint64_t h ) {
+  h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+
+  return h;
+}
+
+/* the type goes in every hash, so that 1, 1L, 1.0 and True differ */
+static uint64_t seed( pyobj_t obj ) {
+  return 0x9e3779b97f4a7c15ULL * ( 1 + (uint64_t)obj->type );
+}
+
+uint64_t pyobj_hash( pyobj_t obj ) {
+  uint64_t h, bits;
+  list_t   l;
+  int      i;
+
+  if ( !obj ) return mix( 0 );
+
+  h = seed( obj );
+
+  switch ( obj->type ) {
+  case PYOBJ_INT:
+    return mix( h ^ (uint32_t)obj->py._int );
+
+  case PYOBJ_INT64:
+    return mix( h ^ (uint64_t)obj->py._int64 );
+
+  case PYOBJ_FLOAT:
+    memcpy( &bits, &obj->py._float, sizeof( bits ) );
+    return mix( h ^ bits );
+
+  case PYOBJ_STRING:
+    /* FNV-1a, as in hashmap.c */
+    h ^= 14695981039346656037ULL;
+    for ( i = 0 ; i < obj->py._string.length ; i++ ) {
+      h ^= (unsigned char)obj->py._string.buffer[ i ];
+      h *= 1099511628211ULL;
+    }
+    return mix( h );
+
+  case PYOBJ_LIST:
+  case PYOBJ_TUPLE:
+    for ( l = obj->py._list ; !list_is_empty( l ) ; l = list_next( l ) ) {
+      h = mix( h ^ pyobj_hash( list_first( l ) ) );
+    }
+    return h;
+
+  case PYOBJ_CODE:
+    return mix( h ^ (uint64_t)(uintptr_t)obj );
+
+  default:
+    return mix( h );
+  }
+}
+
+int      pyobj_equal( pyobj_t a, pyobj_t b ) {
+  list_t la, lb;
+
+  if ( a == b ) return 1;
+  if ( !a || !b || a->type != b->type ) return 0;
+
+  switch ( a->type ) {
+  case PYOBJ_INT:
+    return a->py._int == b->py._int;
+
+  case PYOBJ_INT64:
+    return a->py._int64 == b->py._int64;
+
+  case PYOBJ_FLOAT:
+    return 0 == memcmp( &a->py._float, &b->py._float, sizeof( a->py._float ) );
+
+  case PYOBJ_STRING:
+    return a->py._string.length == b->py._string.length &&
+      0 == memcmp( a->py._string.buffer, b->py._string.buffer, a->py._string.length );
+
+  case PYOBJ_LIST:
+  case PYOBJ_TUPLE:
+    for ( la = a->py._list, lb = b->py._list ;
+          !list_is_empty( la ) && !list_is_empty( lb ) ;
+          la = list_next( la ), lb = list_next( lb ) ) {
+      if ( !pyobj_equal( list_first( la ), list_first( lb ) ) ) return 0;
+    }
+    return list_is_empty( la ) && list_is_empty( lb );
+
+  case PYOBJ_CODE:
+    return 0;
+
+  default:
+    return 1;
+  }
+}
+
+/* can two LOAD_CONST of equal objects share one of them? */
+static int immutable( pyobj_t obj ) {
+  list_t l;
+
+  if ( !obj ) return 0;
+
+  switch ( obj->type ) {
+  case PYOBJ_NONE:
+  case PYOBJ_TRUE:
+  case PYOBJ_FALSE:
+  case PYOBJ_INT:
+  case PYOBJ_INT64:
+  case PYOBJ_FLOAT:
+  case PYOBJ_STRING:
+    return 1;
+
+  case PYOBJ_TUPLE:
+    for ( l = obj->py._list ; !list_is_empty( l ) ; l = list_next( l ) ) {
+      if ( !immutable( list_first( l ) ) ) return 0;
+    }
+    return 1;
+
+  default:
+    return 0;
+  }
+}
+
+static int names_opcode( int opcode ) {
+  switch ( opcode ) {
+  case 0x5a: /* STORE_NAME */
+  case 0x5b: /* DELETE_NAME */
+  case 0x5f: /* STORE_ATTR */
+  case 0x60: /* DELETE_ATTR */
+  case 0x61: /* STORE_GLOBAL */
+  case 0x62: /* DELETE_GLOBAL */
+  case 0x65: /* LOAD_NAME */
+  case 0x6a: /* LOAD_ATTR */
+  case 0x6c: /* IMPORT_NAME */
+  case 0x6d: /* IMPORT_FROM */
+  case 0x74: /* LOAD_GLOBAL */
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+/* does the operand of r index the table? */
+static int indexes( const insn_t *r, int table ) {
+  if ( INSN_OP != r->kind || INSN_ARG_VALUE != r->arg_kind ) return 0;
+
+  return CONSTPOOL_CONSTS == table ? OP_LOAD_CONST == r->opcode : names_opcode( r->opcode );
+}
+
+/*
+  Old index -> new index of the entries of *table, whose duplicates are
+  removed (NULL if there are none). The entries are found back through
+  an open addressing table of their indices, probed by hash.
+ */
+static int *merge_table( pyobj_t *table, int which, size_t *length ) {
+  pyobj_t *items;
+  int     *slots, *map;
+  size_t   n, i, capacity, mask, kept = 0;
+  list_t   l;
+  chain_t  merged;
+
+  if ( !*table ) return NULL;
+
+  n = list_length( (*table)->py._list );
+  if ( n < 2 ) return NULL;
+
+  items = malloc( n * sizeof( *items ) );
+  map   = malloc( n * sizeof( *map ) );
+  assert( items && map );
+  for ( i = 0, l = (*table)->py._list ; i < n ; i++, l = list_next( l ) ) items[ i ] = list_first( l );
+
+  for ( capacity = 16 ; capacity < 2 * n ; capacity *= 2 );
+  mask  = capacity - 1;
+  slots = malloc( capacity * sizeof( *slots ) );
+  assert( slots );
+  memset( slots, -1, capacity * sizeof( *slots ) );
+
+  for ( i = 0 ; i < n ; i++ ) {
+    size_t s;
+
+    if ( CONSTPOOL_CONSTS == which && !immutable( items[ i ] ) ) {
+      map[ i ] = (int)kept++;
+      continue;
+    }
+
+    for ( s = pyobj_hash( items[ i ] ) & mask ;
+          slots[ s ] >= 0 && !pyobj_equal( items[ slots[ s ] ], items[ i ] ) ;
+          s = ( s + 1 ) & mask );
+
+    if ( slots[ s ] >= 0 ) {
+      map[ i ] = map[ slots[ s ] ];
+    }
+    else {
+      slots[ s ] = (int)i;
+      map[ i ] = (int)kept++;
+    }
+  }
+  free( slots );
+
+  if ( kept == n ) {
+    free( items );
+    free( map );
+    return NULL;
+  }
+
+  /* the first of equal entries stays, in order */
+  merged = chain_new();
+  for ( i = 0 ; i < n ; i++ ) {
+    if ( map[ i ] == (int)chain_length( merged ) ) chain_add_last( merged, items[ i ] );
+    else pyobj_delete( items[ i ] );
+  }
+  list_delete( (*table)->py._list, NULL );
+  (*table)->py._list = chain_to_list( merged );
+
+  free( items );
+  *length = n;
+
+  return map;
+}
+
+int      constpool_merge( pyobj_t code, insn_list_t records, int flags ) {
+  static const int tables[] = { CONSTPOOL_CONSTS, CONSTPOOL_NAMES };
+  const insn_t    *r = insn_data( records );
+  size_t           count = insn_count( records );
+  int              removed = 0;
+  size_t           t, i;
+
+  assert( code && PYOBJ_CODE == code->type );
+
+  for ( t = 0 ; t < sizeof( tables ) / sizeof( *tables ) ; t++ ) {
+    int      which = tables[ t ];
+    pyobj_t *table = CONSTPOOL_CONSTS == which ?
+      &code->py._code.binary.content.consts : &code->py._code.binary.content.names;
+    size_t   length = 0;
+    int     *map;
+
+    if ( !( flags & which ) || !*table ) continue;
+
+    /* an operand past the end would index another entry afterwards */
+    length = list_length( (*table)->py._list );
+    for ( i = 0 ; i < count ; i++ ) {
+      if ( indexes( &r[ i ], which ) && ( r[ i ].arg < 0 || (size_t)r[ i ].arg >= length ) ) break;
+    }
+    if ( i < count ) continue;
+
+    map = merge_table( table, which, &length );
+    if ( !map ) continue;
+
+    for ( i = 0 ; i < count ; i++ ) {
+      if ( indexes( &r[ i ], which ) ) insn_set_arg( records, i, map[ r[ i ].arg ] );
+    }
+    removed += (int)( length - list_length( (*table)->py._list ) );
+    free( map );
+  }
+
+  return removed;
+}
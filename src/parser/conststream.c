@@ -0,0 +1,234 @@
+/**
+ * @file conststream.c
+ * @author Abdellah
+ * @brief Constant streams.
+ *
+ * .consts tables encoded as marshal bytes while they are parsed.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <parser/aside.h>
+#include <parser/conststream.h>
+
+struct conststream {
+  unsigned char *bytes;
+  size_t         size;
+  size_t         capacity;
+
+  size_t         count;   /* constants of the table */
+
+  struct {
+    size_t       at;      /* of its length */
+    int32_t      items;
+  }             *open;    /* collections not closed yet, innermost last */
+  size_t         depth;
+  size_t         open_capacity;
+
+  struct {
+    size_t       at;
+    pyobj_t      code;
+  }             *codes;   /* in order */
+  size_t         code_count;
+  size_t         code_capacity;
+};
+
+conststream_t conststream_new( void ) {
+  conststream_t s = calloc( 1, sizeof( *s ) );
+
+  assert( s );
+
+  return s;
+}
+
+void          conststream_delete( conststream_t s ) {
+  if ( !s ) return;
+
+  free( s->bytes );
+  free( s->open );
+  free( s->codes );
+  free( s );
+}
+
+/* room for n more bytes, doubling */
+static unsigned char *conststream_grow( conststream_t s, size_t n ) {
+  if ( s->size + n > s->capacity ) {
+    size_t capacity = s->capacity ? s->capacity : 256;
+
+    while ( capacity < s->size + n ) capacity *= 2;
+    s->bytes = realloc( s->bytes, capacity );
+    assert( s->bytes );
+    s->capacity = capacity;
+  }
+
+  s->size += n;
+  return s->bytes + s->size - n;
+}
+
+/* one more item, in the table or in the innermost collection */
+static void conststream_item( conststream_t s ) {
+  if ( s->depth ) s->open[ s->depth - 1 ].items++;
+  else s->count++;
+}
+
+/* little endian, as the serialiser writes numbers */
+static void put_le( unsigned char *p, uint64_t value, int n ) {
+  int i;
+
+  for ( i = 0 ; i < n ; i++ ) p[ i ] = (unsigned char)( value >> ( 8 * i ) );
+}
+
+static void conststream_tagged( conststream_t s, char tag, uint64_t value, int n ) {
+  unsigned char *p = conststream_grow( s, 1 + n );
+
+  conststream_item( s );
+  p[ 0 ] = (unsigned char)tag;
+  put_le( p + 1, value, n );
+}
+
+void          conststream_none( conststream_t s ) {
+  conststream_tagged( s, 'N', 0, 0 );
+}
+
+void          conststream_bool( conststream_t s, int value ) {
+  conststream_tagged( s, value ? 'T' : 'F', 0, 0 );
+}
+
+void          conststream_int( conststream_t s, int64_t value ) {
+  if ( value >= INT32_MIN && value <= INT32_MAX ) conststream_tagged( s, 'i', (uint64_t)value, 4 );
+  else conststream_tagged( s, 'I', (uint64_t)value, 8 );
+}
+
+void          conststream_long( conststream_t s, int negative, const uint16_t *digits, size_t count ) {
+  unsigned char *p;
+  size_t         i;
+
+  assert( count <= INT32_MAX );
+
+  conststream_tagged( s, 'l', negative ? -(uint64_t)count : count, 4 );
+  p = conststream_grow( s, 2 * count );
+  for ( i = 0 ; i < count ; i++ ) put_le( p + 2 * i, digits[ i ], 2 );
+}
+
+void          conststream_float( conststream_t s, double value ) {
+  uint64_t bits;
+
+  memcpy( &bits, &value, sizeof( bits ) );
+  conststream_tagged( s, 'g', bits, 8 );
+}
+
+void          conststream_string( conststream_t s, const char *bytes, size_t length ) {
+  conststream_tagged( s, 's', length, 4 );
+  memcpy( conststream_grow( s, length ), bytes, length );
+}
+
+/* the parser makes lists of ( ... ) too, written '[' */
+void          conststream_list_open( conststream_t s ) {
+  conststream_tagged( s, '[', 0, 4 );
+
+  if ( s->depth == s->open_capacity ) {
+    s->open_capacity = s->open_capacity ? 2 * s->open_capacity : 16;
+    s->open = realloc( s->open, s->open_capacity * sizeof( *s->open ) );
+    assert( s->open );
+  }
+  s->open[ s->depth ].at    = s->size - 4;
+  s->open[ s->depth ].items = 0;
+  s->depth++;
+}
+
+void          conststream_list_close( conststream_t s ) {
+  assert( s->depth );
+
+  s->depth--;
+  put_le( s->bytes + s->open[ s->depth ].at, (uint32_t)s->open[ s->depth ].items, 4 );
+}
+
+void          conststream_code( conststream_t s, pyobj_t code ) {
+  conststream_item( s );
+
+  if ( s->code_count == s->code_capacity ) {
+    s->code_capacity = s->code_capacity ? 2 * s->code_capacity : 4;
+    s->codes = realloc( s->codes, s->code_capacity * sizeof( *s->codes ) );
+    assert( s->codes );
+  }
+  s->codes[ s->code_count ].at   = s->size;
+  s->codes[ s->code_count ].code = code;
+  s->code_count++;
+}
+
+size_t        conststream_count( conststream_t s ) {
+  return s->count;
+}
+
+size_t        conststream_size( conststream_t s ) {
+  return s->size;
+}
+
+size_t        conststream_code_count( conststream_t s ) {
+  return s->code_count;
+}
+
+pyobj_t       conststream_code_at( conststream_t s, size_t i ) {
+  assert( i < s->code_count );
+
+  return s->codes[ i ].code;
+}
+
+int           conststream_write( conststream_t s, FILE *fp, int (*write_code)( FILE *, pyobj_t ) ) {
+  unsigned char header[ 5 ];
+  size_t        from = 0, i;
+
+  assert( 0 == s->depth );
+
+  header[ 0 ] = '(';
+  put_le( header + 1, s->count, 4 );
+  if ( fwrite( header, 1, sizeof( header ), fp ) != sizeof( header ) ) return -1;
+
+  for ( i = 0 ; i <= s->code_count ; i++ ) {
+    size_t to = i < s->code_count ? s->codes[ i ].at : s->size;
+
+    if ( to > from && fwrite( s->bytes + from, 1, to - from, fp ) != to - from ) return -1;
+    if ( i < s->code_count && write_code( fp, s->codes[ i ].code ) < 0 ) return -1;
+    from = to;
+  }
+
+  return 0;
+}
+
+
+
+/*
+  Streams kept aside, by code object (see aside.h):
+ */
+static int conststream_delete_cb( void *s ) {
+  conststream_delete( s );
+  return 0;
+}
+
+void          conststream_attach( pyobj_t code, conststream_t s ) {
+  assert( code && s );
+
+  aside_put( code, ASIDE_CONSTS, s, conststream_delete_cb );
+}
+
+conststream_t conststream_of( pyobj_t code ) {
+  return aside_get( code, ASIDE_CONSTS );
+}
+
+conststream_t conststream_detach( pyobj_t code ) {
+  return aside_take( code, ASIDE_CONSTS );
+}
+
+static int stream_consts = 0;
+
+void          conststream_enable( int on ) {
+  stream_consts = on;
+}
+
+int           conststream_enabled( void ) {
+  return stream_consts;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file insn.c
+ * @author Abdellah
+ * @brief Instruction records.
+ *
+ * Compact form of the .text section, made by the parser for pyasm.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <generic/hashmap.h>
+#include <generic/intern.h>
+#include <generic/vector.h>
+#include <lexer/lexem.h>
+#include <parser/aside.h>
+#include <parser/insn.h>
+
+struct insn_list {
+  insn_t    *records;
+  size_t     count;
+  size_t     capacity;
+
+  hashmap_t  label_ids;   /* interned name -> ID */
+  vector_t   label_names; /* ID -> interned name */
+};
+
+insn_list_t   insn_list_new( void ) {
+  insn_list_t l = calloc( 1, sizeof( *l ) );
+
+  assert( l );
+
+  l->label_ids   = hashmap_new_int();
+  l->label_names = vector_new();
+
+  return l;
+}
+
+void          insn_list_delete( insn_list_t l ) {
+  if ( !l ) return;
+
+  free( l->records );
+  hashmap_delete( l->label_ids, NULL );
+  vector_delete( l->label_names, NULL );
+  free( l );
+}
+
+size_t        insn_count( insn_list_t l ) {
+  return l->count;
+}
+
+const insn_t *insn_data( insn_list_t l ) {
+  return l->records;
+}
+
+void          insn_set_arg( insn_list_t l, size_t i, int32_t arg ) {
+  assert( i < l->count );
+  l->records[ i ].arg = arg;
+}
+
+void          insn_append( insn_list_t l, int kind, int opcode, int arg_kind, int32_t arg, int line ) {
+  insn_t *r;
+
+  if ( l->count == l->capacity ) {
+    l->capacity = l->capacity ? 2 * l->capacity : 256;
+    l->records  = realloc( l->records, l->capacity * sizeof( *l->records ) );
+    assert( l->records );
+  }
+
+  r = &l->records[ l->count++ ];
+  r->kind     = (uint8_t)kind;
+  r->opcode   = (uint8_t)opcode;
+  r->arg_kind = (uint8_t)arg_kind;
+  r->unused   = 0;
+  r->arg      = arg;
+  r->line     = line;
+}
+
+int           insn_label_id( insn_list_t l, const char *name, size_t length ) {
+  const char *canonical = intern_n( name, length );
+  void       *id;
+
+  if ( hashmap_find_int( l->label_ids, (uintptr_t)canonical, &id ) ) return (int)(intptr_t)id;
+
+  id = (void *)(intptr_t)vector_length( l->label_names );
+  hashmap_put_int( l->label_ids, (uintptr_t)canonical, id );
+  vector_append( l->label_names, (void *)canonical );
+
+  return (int)(intptr_t)id;
+}
+
+size_t        insn_label_count( insn_list_t l ) {
+  return vector_length( l->label_names );
+}
+
+const char   *insn_label_name( insn_list_t l, int id ) {
+  return vector_get_at( l->label_names, id );
+}
+
+int           insn_opcode_of_type( const char *type ) {
+  const char *hex = type ? strstr( type, "0x" ) : NULL;
+
+  return hex ? (int)strtol( hex, NULL, 16 ) : 0;
+}
+
+int32_t       insn_value_of( const char *value ) {
+  if ( !value ) return 0;
+
+  return strstr( value, "0x" ) ? (int32_t)strtol( value, NULL, 16 ) : atoi( value );
+}
+
+/*
+  Same reading of the lexems as the three passes of pyasm used to do: a
+  label is anything with "label" in its type or ':' in its value, an
+  instruction with an operand takes the next lexem, so does .line.
+ */
+insn_list_t   insn_lower( list_t lexems ) {
+  insn_list_t l = insn_list_new();
+
+  for ( ; !list_is_empty( lexems ) ; lexems = list_next( lexems ) ) {
+    lexem_t     lex   = list_first( lexems );
+    const char *type  = lexem_type( lex );
+    const char *value = lexem_value( lex );
+
+    if ( !type ) continue;
+
+    if ( strstr( type, "label" ) || ( value && strchr( value, ':' ) ) ) {
+      size_t length = value ? strlen( value ) : 0;
+      if ( length > 0 && ':' == value[ length - 1 ] ) length--;
+      insn_append( l, INSN_LABEL, 0, INSN_ARG_NONE, insn_label_id( l, value ? value : "", length ), lexem_line( lex ) );
+    }
+    else if ( strstr( type, "insn::0" ) ) {
+      insn_append( l, INSN_OP, insn_opcode_of_type( type ), INSN_ARG_NONE, 0, lexem_line( lex ) );
+    }
+    else if ( strstr( type, "insn::1" ) ) {
+      lexem_t     arg;
+      const char *arg_type, *arg_value;
+
+      lexems = list_next( lexems );
+      if ( list_is_empty( lexems ) ) {
+        fprintf( stderr, "Erreur: Argument manquant pour l'instruction %s\n", value );
+        insn_list_delete( l );
+        return NULL;
+      }
+
+      arg       = list_first( lexems );
+      arg_type  = lexem_type( arg );
+      arg_value = lexem_value( arg ) ? lexem_value( arg ) : "";
+
+      if ( ( arg_type && strstr( arg_type, "number" ) ) ||
+           ( arg_value[ 0 ] >= '0' && arg_value[ 0 ] <= '9' ) || '-' == arg_value[ 0 ] ) {
+        insn_append( l, INSN_OP, insn_opcode_of_type( type ), INSN_ARG_VALUE,
+                     insn_value_of( arg_value ), lexem_line( lex ) );
+      }
+      else {
+        int kind = arg_type && strstr( arg_type, "string" ) ? INSN_ARG_STRING : INSN_ARG_LABEL;
+        insn_append( l, INSN_OP, insn_opcode_of_type( type ), kind,
+                     insn_label_id( l, arg_value, strlen( arg_value ) ), lexem_line( lex ) );
+      }
+    }
+    else if ( strstr( type, "directive::line" ) ) {
+      lexems = list_next( lexems );
+      if ( list_is_empty( lexems ) ) break;
+      insn_append( l, INSN_LINE, 0, INSN_ARG_NONE, atoi( lexem_value( list_first( lexems ) ) ), lexem_line( lex ) );
+    }
+  }
+
+  return l;
+}
+
+
+/*
+  Records kept aside, by code object (see aside.h):
+ */
+static int insn_list_delete_cb( void *l ) {
+  insn_list_delete( l );
+  return 0;
+}
+
+void          insn_attach( pyobj_t code, insn_list_t l ) {
+  assert( code && l );
+
+  aside_put( code, ASIDE_INSN, l, insn_list_delete_cb );
+}
+
+insn_list_t   insn_detach( pyobj_t code ) {
+  return aside_take( code, ASIDE_INSN );
+}
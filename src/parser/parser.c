@@ -6,138 +6,541 @@
  */
 
 #include "generic/list.h"
+#include <generic/arena.h>
+#include <generic/chain.h>
+#include <generic/intern.h>
+#include <generic/vector.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <assert.h>
 
 #include <parser/parser.h>
 #include <parser/lexem_helpers.h>
 #include <parser/pyobj.h> 
+#include <parser/insn.h>
+#include <parser/conststream.h>
 #include <lexer/lexem.h> 
 #include <lexer/lexer.h>
+#include <lexer/numlit.h>
+#include <lexer/strlit.h>
+#include <lexer/tokpipe.h>
+
+pyobj_t pyobj_string_new_n(const char *bytes, size_t length, int interned);
+
+// The parser reads the token buffers made by the lexer (see tokbuf.h)
+// through a cursor: tokens are only looked at in order, one at a time.
+// They are numbered from 0 across buffers: token i is token
+// (i & mask) of buffer (i >> batch_shift). A whole token buffer is a
+// single batch, a pipe (see tokpipe.h) gives batches of TOKPIPE_BATCH
+// tokens, read when the cursor reaches them.
+// With the list interface the tokens are the caller's lexems instead:
+// links[i] is the link of token i in the caller's list.
+typedef struct cursor {
+    tokbuf_t  *batches;
+    size_t     batch_count;
+    unsigned   batch_shift;
+    size_t     mask;
+    size_t     count;     // tokens in the batches
+    size_t     pos;
+    tokpipe_t  pipe;      // NULL: all the tokens are in batches[0]
+    int        depth;     // of the code object being parsed (0: the module)
+    list_t    *links;     // NULL: the tokens are in batches
+    char      *moved;     // moved[i]: token i went to an instruction list
+} cursor_t;
+
+static void cursor_init(cursor_t *tokens, tokbuf_t *whole) {
+    memset(tokens, 0, sizeof(*tokens));
+    tokens->batches = whole;
+    tokens->batch_count = 1;
+    tokens->batch_shift = 8 * sizeof(size_t) - 1;
+    tokens->mask = ((size_t)1 << tokens->batch_shift) - 1;
+    tokens->count = tokbuf_count(*whole);
+}
 
-static pyobj_t parse_constant(list_t *lexems);
-static lexem_t lexem_clone(lexem_t lex) {
-    if (NULL == lex) return NULL;
-    return lexem_new((char *)lexem_type(lex), (char *)lexem_value(lex), lexem_line(lex), lexem_column(lex));
+static void cursor_init_list(cursor_t *tokens, list_t lexems) {
+    size_t capacity = 64;
+
+    memset(tokens, 0, sizeof(*tokens));
+    tokens->links = malloc(capacity * sizeof(*tokens->links));
+    assert(tokens->links);
+    for (; !list_is_empty(lexems); lexems = list_next(lexems)) {
+        if (tokens->count == capacity) {
+            capacity *= 2;
+            tokens->links = realloc(tokens->links, capacity * sizeof(*tokens->links));
+            assert(tokens->links);
+        }
+        tokens->links[tokens->count++] = lexems;
+    }
+    tokens->moved = calloc(tokens->count ? tokens->count : 1, 1);
+    assert(tokens->moved);
 }
 
-//a pys code may start with useless structure::blanks or random newlines
-static void skip_eol(list_t *lexems) {
-    while (next_lexem_is(lexems, "structure::newline") || next_lexem_is(lexems, "structure::blank") || next_lexem_is(lexems, "structure::comment")) {
-        lexem_advance(lexems);
+// waits for the next batch of the pipe, 0 at the end of the tokens
+static int token_fetch(cursor_t *tokens) {
+    if (NULL == tokens->pipe) return 0;
+
+    tokbuf_t batch = tokpipe_next(tokens->pipe);
+    if (NULL == batch) return 0;
+
+    tokens->batches = realloc(tokens->batches, (tokens->batch_count + 1) * sizeof(*tokens->batches));
+    assert(tokens->batches);
+    tokens->batches[tokens->batch_count++] = batch;
+    tokens->count += tokbuf_count(batch);
+    return 1;
+}
+
+static int token_left(cursor_t *tokens) {
+    return tokens->pos < tokens->count || token_fetch(tokens);
+}
+
+// index of the next token
+static size_t token_peek(cursor_t *tokens) {
+    return tokens->pos;
+}
+
+static void token_advance(cursor_t *tokens) {
+    if (token_left(tokens)) tokens->pos++;
+}
+
+// token i is one of the tokens already read by token_left()
+#define TOKEN_BATCH(tokens, i) ((tokens)->batches[(i) >> (tokens)->batch_shift])
+#define TOKEN_INDEX(tokens, i) ((i) & (tokens)->mask)
+#define TOKEN_LEXEM(tokens, i) ((lexem_t)list_first((tokens)->links[i]))
+
+static const char *token_type(cursor_t *tokens, size_t i) {
+    if (tokens->links) {
+        const char *type = lexem_type(TOKEN_LEXEM(tokens, i));
+        return type ? type : "";
     }
+    return tokbuf_type(TOKEN_BATCH(tokens, i), TOKEN_INDEX(tokens, i));
 }
 
+static const char *token_value(cursor_t *tokens, size_t i) {
+    if (tokens->links) {
+        const char *value = lexem_value(TOKEN_LEXEM(tokens, i));
+        return value ? value : "";
+    }
+    return tokbuf_value(TOKEN_BATCH(tokens, i), TOKEN_INDEX(tokens, i));
+}
 
+static size_t token_length(cursor_t *tokens, size_t i) {
+    if (tokens->links) return strlen(token_value(tokens, i));
+    return tokbuf_length(TOKEN_BATCH(tokens, i), TOKEN_INDEX(tokens, i));
+}
 
-static pyobj_t parse_collection(list_t *lexems, char *end_type, int is_list) {
-    // stock list/tuple elements
-    // CORRECTION: create_list -> list_new
-    pyobj_t collection = is_list ? pyobj_list_new() : pyobj_list_new(); 
-    
-    lexem_advance(lexems); 
+static int token_line(cursor_t *tokens, size_t i) {
+    if (tokens->links) return lexem_line(TOKEN_LEXEM(tokens, i));
+    return tokbuf_line(TOKEN_BATCH(tokens, i), TOKEN_INDEX(tokens, i));
+}
 
-    // the end_type is th ) or ]
-    while (!next_lexem_is(lexems, end_type)) {
-        
-        //ignore blanks between elements
-        if (next_lexem_is(lexems, "structure::blank") || next_lexem_is(lexems, "structure::newline")) {
-            lexem_advance(lexems);
-            continue;
-        }
+static int token_column(cursor_t *tokens, size_t i) {
+    if (tokens->links) return lexem_column(TOKEN_LEXEM(tokens, i));
+    return tokbuf_column(TOKEN_BATCH(tokens, i), TOKEN_INDEX(tokens, i));
+}
 
-        pyobj_t element = parse_constant(lexems);
-        if (!element) {
-            pyobj_delete(collection);
-            return NULL; 
-        }
+static int token_flags(cursor_t *tokens, size_t i) {
+    if (tokens->links) return lexem_flags(TOKEN_LEXEM(tokens, i));
+    return tokbuf_flags(TOKEN_BATCH(tokens, i), TOKEN_INDEX(tokens, i));
+}
 
-        // Once inserted, the list owns the element.
-        if (0 != pyobj_list_prepend(collection, element)) {
-            pyobj_delete(element);
-            pyobj_delete(collection);
-            return NULL;
-        }
+// token i goes to the instructions of the code object being parsed: the
+// lexem is borrowed from the buffer, or with the list interface moved
+// out of the caller's list, link and all (the code object owns it then)
+static void token_take(cursor_t *tokens, size_t i, chain_t instructions) {
+    if (!tokens->links) {
+        chain_add_last(instructions, tokbuf_view(TOKEN_BATCH(tokens, i), TOKEN_INDEX(tokens, i)));
+        return;
     }
 
-    // closing bracket
-    lexem_advance(lexems);
-	pyobj_list_reverse(collection);
-    return collection;
+    // the link before it in the caller's list: .text always comes first,
+    // so there is one
+    size_t before = i;
+    do {
+        assert(before > 0);
+        before--;
+    } while (tokens->moved[before]);
+
+    chain_move_next(instructions, tokens->links[before]);
+    tokens->moved[i] = 1;
 }
 
+// The serial tools never parse an input with a lexical error (or no
+// token at all), they report that instead. With a pipe the lexer may
+// still be running when a parse error is found: it is waited for, and
+// the parse error is only reported if the whole input lexed fine.
+static int parse_errors_reported(cursor_t *tokens) {
+    return NULL == tokens->pipe || 0 == tokpipe_finish(tokens->pipe);
+}
 
+// same as next_lexem_is(): "type::*" matches every type starting with "type::"
+static int next_token_is(cursor_t *tokens, char *type) {
+    if (!token_left(tokens)) return 0;
 
+    const char *lex_type = token_type(tokens, tokens->pos);
+    const char *star = strchr(type, '*');
+    if (NULL == star) return 0 == strcmp(lex_type, type);
+    return 0 == strncmp(lex_type, type, (size_t)(star - type));
+}
 
-static pyobj_t parse_constant(list_t *lexems) {
-    
-    lexem_t lex = lexem_peek(lexems);
-
-    if (next_lexem_is(lexems, "number::int")) {
-        lexem_advance(lexems);
-        return pyobj_int_new(atoi(lexem_value(lex)));
-    }
-    else if (next_lexem_is(lexems, "number::uint")) {
-        lexem_advance(lexems);
-        return pyobj_int_new((int32_t)strtol(lexem_value(lex), NULL, 10));
-    }
-    else if (next_lexem_is(lexems, "number::hex")) {
-        lexem_advance(lexems);
-        return pyobj_int_new((int)strtol(lexem_value(lex), NULL, 16));
-    }
-    else if (next_lexem_is(lexems, "number::oct")) {
-        lexem_advance(lexems);
-        const char *s = lexem_value(lex);
-        if (s && 0 == strncmp(s, "0o", 2)) s += 2;
-        return pyobj_int_new((int32_t)strtol(s ? s : "0", NULL, 8));
-    }
-    else if (next_lexem_is(lexems, "number::bin")) {
-        lexem_advance(lexems);
-        const char *s = lexem_value(lex);
-        if (s && 0 == strncmp(s, "0b", 2)) s += 2;
-        return pyobj_int_new((int32_t)strtol(s ? s : "0", NULL, 2));
-    }
-    else if (next_lexem_is(lexems, "number::float")) {
-        lexem_advance(lexems);
+static void print_token_error(char *msg, cursor_t *tokens) {
+    if (!parse_errors_reported(tokens)) return;
+    if (!token_left(tokens)) {
+        fprintf(stderr, "[PARSER] %s (EOF)\n", msg ? msg : "Erreur");
+        return;
+    }
+
+    size_t i = tokens->pos;
+    fprintf(stderr, "[PARSER] %s at %d:%d (type=%s, value=%s)\n",
+             msg ? msg : "Erreur",
+             token_line(tokens, i),
+             token_column(tokens, i),
+             token_type(tokens, i),
+             *token_value(tokens, i) ? token_value(tokens, i) : "<null>");
+}
+
+// decoded bytes of the next (string) token in *bytes, small if they fit
+// in it (small_size bytes), else malloc'ed: their length, or -1 after an
+// error message if it has a bad escape. The token is not consumed
+static long decode_string(cursor_t *tokens, char *small, size_t small_size, char **bytes) {
+    size_t i = token_peek(tokens);
+    size_t length = token_length(tokens, i);
+
+    // decoded strings are never longer than their literal
+    *bytes = length < small_size ? small : malloc(length + 1);
+    assert(*bytes);
+    long size = strlit_decode(token_value(tokens, i), length, *bytes);
+    if (size < 0) {
+        print_token_error("Invalid escape in string", tokens);
+        if (*bytes != small) free(*bytes);
+        return -1;
+    }
+    return size;
+}
+
+// string object holding the decoded bytes of the next (string) token,
+// NULL after an error message if it has a bad escape. The token is not consumed
+static pyobj_t parse_string(cursor_t *tokens) {
+    char small[256];
+    char *bytes;
+    long size = decode_string(tokens, small, sizeof(small), &bytes);
+    if (size < 0) return NULL;
+
+    // the string may hold '\0' bytes, and is interned: equal names and
+    // constants share their buffer
+    pyobj_t obj = pyobj_string_new_n(bytes, (size_t)size, 1);
+    if (bytes != small) free(bytes);
+    return obj;
+}
+
+// value of the next (integer) token, -1 after an error message if it
+// does not fit in 64 bits. The token is consumed
+static int decode_integer(cursor_t *tokens, int64_t *value) {
+    size_t i = token_peek(tokens);
+
+    int status = numlit_int(token_value(tokens, i), token_length(tokens, i), value);
+    if (NUMLIT_RANGE == status) {
+        print_token_error("Integer constant too large (longs need --stream-consts)", tokens);
+        return -1;
+    }
+    if (status < 0) {
+        print_token_error("Invalid integer constant", tokens);
+        return -1;
+    }
+    token_advance(tokens);
+    return 0;
+}
+
+// int object for the next (integer) token: an int if the value fits in
+// 32 bits, an int64 if not ('I' when written), NULL after an error
+// message beyond that (longs are only streamed, see stream_integer()).
+// The token is consumed
+static pyobj_t parse_integer(cursor_t *tokens) {
+    int64_t value;
+
+    if (decode_integer(tokens, &value) < 0) return NULL;
+    if (value < INT32_MIN || value > INT32_MAX) return pyobj_int64_new(value);
+    return pyobj_int_new((int32_t)value);
+}
+
+// value of the next (float) token, -1 after an error message. The token
+// is consumed
+static int decode_float(cursor_t *tokens, double *value) {
+    size_t i = token_peek(tokens);
+
+    if (numlit_float(token_value(tokens, i), token_length(tokens, i), value) < 0) {
+        print_token_error("Invalid float constant", tokens);
+        return -1;
+    }
+    token_advance(tokens);
+    return 0;
+}
+
+// float object for the next (float) token, NULL after an error message.
+// The token is consumed
+static pyobj_t parse_float(cursor_t *tokens) {
+    double value;
+
+    if (decode_float(tokens, &value) < 0) return NULL;
+    return pyobj_float_new(value);
+}
+
+// Trivia-free streams (LEX_SKIP_TRIVIA, see lexer.h) have no blank, newline
+// or comment lexems, the lexem after them carries LEXEM_AFTER_* flags instead.
+// These helpers accept both kinds of streams.
+static int trivia_flags(cursor_t *tokens) {
+    return token_left(tokens) ? token_flags(tokens, tokens->pos) : 0;
+}
+
+// only blanks before the next lexem
+static int next_is_blank(cursor_t *tokens) {
+    return next_token_is(tokens, "structure::blank") || LEXEM_AFTER_BLANK == trivia_flags(tokens);
+}
+
+// the next lexem is the end of the line
+static int next_is_newline(cursor_t *tokens) {
+    return next_token_is(tokens, "structure::newline") || (trivia_flags(tokens) & LEXEM_NEWLINE_FIRST);
+}
+
+// the next lexem is on another line
+static int next_is_after_newline(cursor_t *tokens) {
+    return next_token_is(tokens, "structure::newline") || (trivia_flags(tokens) & LEXEM_AFTER_NEWLINE);
+}
+
+static void skip_blank(cursor_t *tokens) {
+    if (next_token_is(tokens, "structure::blank")) token_advance(tokens);
+}
+
+//a pys code may start with useless structure::blanks or random newlines
+static void skip_eol(cursor_t *tokens) {
+    while (next_token_is(tokens, "structure::newline") || next_token_is(tokens, "structure::blank") || next_token_is(tokens, "structure::comment")) {
+        token_advance(tokens);
+    }
+}
+
+
+
+// the next element of a collection: 0 if there is one, 1 if it is its
+// end, -1 after an error message. Blanks and newlines are skipped.
+static int parse_collection_next(cursor_t *tokens, char *end_type) {
+    while (1) {
+
+        // a comment is not allowed between elements, nor before the end
+        if (trivia_flags(tokens) & LEXEM_AFTER_COMMENT) {
+            print_token_error("Expected constant", tokens);
+            return -1;
+        }
+        if (next_token_is(tokens, end_type)) return 1;
+        
+        //ignore blanks between elements
+        if (next_token_is(tokens, "structure::blank") || next_token_is(tokens, "structure::newline")) {
+            token_advance(tokens);
+            continue;
+        }
+        return 0;
+    }
+}
+
+// a constant that is not a collection
+static pyobj_t parse_scalar(cursor_t *tokens) {
     
-        return pyobj_float_new(atof(lexem_value(lex)));
+    if (next_token_is(tokens, "number::float") || next_token_is(tokens, "number::floatexp")) {
+        return parse_float(tokens);
     }
-    else if (next_lexem_is(lexems, "number::floatexp")) {
-        lexem_advance(lexems);
-        return pyobj_float_new(atof(lexem_value(lex)));
+    else if (next_token_is(tokens, "number::*")) {
+        // int, uint, hex, oct and bin: the prefix gives the base
+        return parse_integer(tokens);
     }
-    else if (next_lexem_is(lexems, "string::*") || next_lexem_is(lexems, "String")){
-        lexem_advance(lexems);
-        // PS we might need to remove the "" ?
-        return pyobj_string_new(lexem_value(lex)); 
+    else if (next_token_is(tokens, "string::*")){
+        pyobj_t string = parse_string(tokens);
+        if (string) token_advance(tokens);
+        return string;
     }
-    else if (next_lexem_is(lexems, "pycst::None")) {
-        lexem_advance(lexems);
+    else if (next_token_is(tokens, "pycst::None")) {
+        token_advance(tokens);
         
         return pyobj_none_new();
     }
-    else if (next_lexem_is(lexems, "pycst::True")) {
-        lexem_advance(lexems);
+    else if (next_token_is(tokens, "pycst::True")) {
+        token_advance(tokens);
         
         return pyobj_true_new();
     }
-    else if (next_lexem_is(lexems, "pycst::False")) {
-        lexem_advance(lexems);
+    else if (next_token_is(tokens, "pycst::False")) {
+        token_advance(tokens);
         
         return pyobj_false_new();
     }
-    
-    else if (next_lexem_is(lexems, "bracket::left")) {
-        return parse_collection(lexems, "bracket::right", 1); // 1 = Liste
+
+    print_token_error("Expected constant", tokens);
+    return NULL;
+}
+
+// the collections still open are deleted with what they hold so far
+static pyobj_t parse_constant_abort(vector_t open) {
+    while (open && !vector_is_empty(open)) {
+        vector_pop(open);
+        pyobj_delete(vector_pop(open));
+    }
+    vector_delete(open, NULL);
+    return NULL;
+}
+
+// Lists [ ... ] and tuples ( ... ) nest as deep as the input does, so
+// the collections being parsed are kept on a stack of their own rather
+// than on the C one: each one, then the type of the token closing it.
+// A collection goes in its parent once it is closed.
+static pyobj_t parse_constant(cursor_t *tokens) {
+    vector_t open = NULL;
+
+    for (;;) {
+        if (next_token_is(tokens, "bracket::left") || next_token_is(tokens, "paren::left")) {
+            char *end_type = next_token_is(tokens, "bracket::left") ? "bracket::right" : "paren::right";
+            token_advance(tokens);
+
+            if (!open) open = vector_new();
+            vector_append(open, pyobj_list_new());
+            vector_append(open, end_type);
+        } else {
+            pyobj_t element = parse_scalar(tokens);
+            if (!element) return parse_constant_abort(open);
+            if (!open) return element;
+
+            // Once inserted, the list owns the element.
+            pyobj_list_prepend(vector_get_at(open, vector_length(open) - 2), element);
+        }
+
+        // the innermost collections may end here
+        for (;;) {
+            int end = parse_collection_next(tokens, vector_last(open));
+            if (end < 0) return parse_constant_abort(open);
+            if (0 == end) break;
+
+            // closing bracket
+            token_advance(tokens);
+            vector_pop(open);
+            pyobj_t collection = vector_pop(open);
+            pyobj_list_reverse(collection);
+
+            if (vector_is_empty(open)) {
+                vector_delete(open, NULL);
+                return collection;
+            }
+            pyobj_list_prepend(vector_get_at(open, vector_length(open) - 2), collection);
+        }
     }
-    else if (next_lexem_is(lexems, "paren::left")) {
-        return parse_collection(lexems, "paren::right", 0); // 0 = Tuple
+}
+
+
+// Streamed .consts (see conststream.h): the constants go straight from
+// the tokens to their marshal bytes, no object is made for them.
+
+// the next (integer) token, a long ('l') past 64 bits: 0, or -1 after
+// an error message. The token is consumed
+static int stream_integer(cursor_t *tokens, conststream_t stream) {
+    size_t i = token_peek(tokens);
+    const char *literal = token_value(tokens, i);
+    size_t length = token_length(tokens, i);
+    int64_t value;
+
+    int status = numlit_int(literal, length, &value);
+    if (NUMLIT_RANGE == status) {
+        uint16_t small[32];
+        uint16_t *digits = NUMLIT_LONG_DIGITS(length) <= 32 ? small
+                         : malloc(NUMLIT_LONG_DIGITS(length) * sizeof(*digits));
+        assert(digits);
+        int negative;
+        int count = numlit_long(literal, length, digits, &negative);
+        if (count >= 0) conststream_long(stream, negative, digits, (size_t)count);
+        if (digits != small) free(digits);
+        status = count < 0 ? count : 0;
+    } else if (0 == status) {
+        conststream_int(stream, value);
+    }
+    if (status < 0) {
+        print_token_error("Invalid integer constant", tokens);
+        return -1;
     }
+    token_advance(tokens);
+    return 0;
+}
 
-    print_parse_error("Expected constant", lexems);
-    return NULL;
+// same as parse_scalar(), 0 or -1
+static int stream_scalar(cursor_t *tokens, conststream_t stream) {
+
+    if (next_token_is(tokens, "number::float") || next_token_is(tokens, "number::floatexp")) {
+        double value;
+        if (decode_float(tokens, &value) < 0) return -1;
+        conststream_float(stream, value);
+    }
+    else if (next_token_is(tokens, "number::*")) {
+        if (stream_integer(tokens, stream) < 0) return -1;
+    }
+    else if (next_token_is(tokens, "string::*")) {
+        char small[256];
+        char *bytes;
+        long size = decode_string(tokens, small, sizeof(small), &bytes);
+        if (size < 0) return -1;
+        conststream_string(stream, bytes, (size_t)size);
+        if (bytes != small) free(bytes);
+        token_advance(tokens);
+    }
+    else if (next_token_is(tokens, "pycst::None")) {
+        token_advance(tokens);
+        conststream_none(stream);
+    }
+    else if (next_token_is(tokens, "pycst::True")) {
+        token_advance(tokens);
+        conststream_bool(stream, 1);
+    }
+    else if (next_token_is(tokens, "pycst::False")) {
+        token_advance(tokens);
+        conststream_bool(stream, 0);
+    }
+    else {
+        print_token_error("Expected constant", tokens);
+        return -1;
+    }
+    return 0;
+}
+
+// same as parse_constant(), the stack only holds the closing token types
+static int stream_constant(cursor_t *tokens, conststream_t stream) {
+    vector_t open = NULL;
+    int status = 0;
+
+    for (;;) {
+        if (next_token_is(tokens, "bracket::left") || next_token_is(tokens, "paren::left")) {
+            char *end_type = next_token_is(tokens, "bracket::left") ? "bracket::right" : "paren::right";
+            token_advance(tokens);
+
+            if (!open) open = vector_new();
+            vector_append(open, end_type);
+            conststream_list_open(stream);
+        } else {
+            if (stream_scalar(tokens, stream) < 0) {
+                status = -1;
+                break;
+            }
+            if (!open) break;
+        }
+
+        // the innermost collections may end here
+        int end;
+        while (1 == (end = parse_collection_next(tokens, vector_last(open)))) {
+            // closing bracket
+            token_advance(tokens);
+            vector_pop(open);
+            conststream_list_close(stream);
+            if (vector_is_empty(open)) break;
+        }
+        if (end < 0) status = -1;
+        if (end != 0) break;
+    }
+
+    vector_delete(open, NULL);
+    return status;
 }
 
 
@@ -145,7 +548,7 @@ static pyobj_t parse_constant(list_t *lexems) {
 // structure parser for .set KEYWORD VALUE
 // Parse ALL consecutive .set directives and validate them (unknown keys, duplicates, missing keys).
 // Returns 0 on success, -1 on error.
-static int parse_set_directive(list_t *lexems, pyobj_t code) {
+static int parse_set_directive(cursor_t *tokens, pyobj_t code) {
     int seen_version_pyvm = 0;
     int seen_flags = 0;
     int seen_filename = 0;
@@ -153,132 +556,133 @@ static int parse_set_directive(list_t *lexems, pyobj_t code) {
     int seen_stack_size = 0;
     int seen_arg_count = 0;
 
-    while (next_lexem_is(lexems, "directive::set")) {
+    while (next_token_is(tokens, "directive::set")) {
         // Verify .set
-        lexem_advance(lexems);
+        token_advance(tokens);
 
-        if (!next_lexem_is(lexems, "structure::blank")) {
-            print_parse_error("Expected space after .set", lexems);
+        if (!next_is_blank(tokens)) {
+            print_token_error("Expected space after .set", tokens);
             return -1;
         }
-        lexem_advance(lexems);
+        skip_blank(tokens);
 
         // KEYWORD eg version_pyvm ..
-        if (!next_lexem_is(lexems, "identifier::symbol")) {
-            print_parse_error("Expected identifier after .set", lexems);
+        if (!next_token_is(tokens, "identifier::symbol")) {
+            print_token_error("Expected identifier after .set", tokens);
             return -1;
         }
-        lexem_t key_lex = lexem_peek(lexems);
-        const char *key = lexem_value(key_lex);
-        lexem_advance(lexems);
+        const char *key = token_value(tokens, token_peek(tokens));
+        token_advance(tokens);
 
-        if (!next_lexem_is(lexems, "structure::blank")) {
-            print_parse_error("Expected space before the value", lexems);
+        if (!next_is_blank(tokens)) {
+            print_token_error("Expected space before the value", tokens);
             return -1;
         }
-        lexem_advance(lexems);
+        skip_blank(tokens);
 
         // read the value
-        lexem_t val_lex = lexem_peek(lexems);
-        if (NULL == val_lex) {
-            print_parse_error("Expected value after .set", lexems);
+        if (!token_left(tokens)) {
+            print_token_error("Expected value after .set", tokens);
             return -1;
         }
     
         if (key && 0 == strcmp(key, "version_pyvm")) {
             if (seen_version_pyvm) {
-                print_parse_error("Duplicate .set directive", lexems);
+                print_token_error("Duplicate .set directive", tokens);
                 return -1;
             }
-            if (!next_lexem_is(lexems, "number::uint")) {
-                print_parse_error("Expected decimal integer", lexems);
+            if (!next_token_is(tokens, "number::uint")) {
+                print_token_error("Expected decimal integer", tokens);
                 return -1;
             }
-            code->py._code.binary.header.version_pyvm = (uint32_t)atoi(lexem_value(val_lex));
+            code->py._code.binary.header.version_pyvm = (uint32_t)atoi(token_value(tokens, token_peek(tokens)));
             seen_version_pyvm = 1;
         }
 
         else if (key && 0 == strcmp(key, "flags")) {
             if (seen_flags) {
-                print_parse_error("Duplicate .set directive", lexems);
+                print_token_error("Duplicate .set directive", tokens);
                 return -1;
             }
-            if (!next_lexem_is(lexems, "number::hex")) {
-                print_parse_error("Expected hexadecimal integer", lexems);
+            if (!next_token_is(tokens, "number::hex")) {
+                print_token_error("Expected hexadecimal integer", tokens);
                 return -1;
             }
-            code->py._code.header.flags = (uint32_t)strtol(lexem_value(val_lex), NULL, 16);
+            code->py._code.header.flags = (uint32_t)strtol(token_value(tokens, token_peek(tokens)), NULL, 16);
             seen_flags = 1;
         }
 
         else if (key && 0 == strcmp(key, "filename")) {
             if (seen_filename) {
-                print_parse_error("Duplicate .set directive", lexems);
+                print_token_error("Duplicate .set directive", tokens);
                 return -1;
             }
-            if (!next_lexem_is(lexems, "string::double")) {
-                print_parse_error("Expected string", lexems);
+            if (!next_token_is(tokens, "string::double")) {
+                print_token_error("Expected string", tokens);
                 return -1;
             }
-            code->py._code.binary.trailer.filename = pyobj_string_new(lexem_value(val_lex));
+            code->py._code.binary.trailer.filename = parse_string(tokens);
+            if (!code->py._code.binary.trailer.filename) return -1;
             seen_filename = 1;
         }
 
         else if (key && 0 == strcmp(key, "name")) {
             if (seen_name) {
-                print_parse_error("Duplicate .set directive", lexems);
+                print_token_error("Duplicate .set directive", tokens);
                 return -1;
             }
-            if (!next_lexem_is(lexems, "string::double")) {
-                print_parse_error("Expected string", lexems);
+            if (!next_token_is(tokens, "string::double")) {
+                print_token_error("Expected string", tokens);
                 return -1;
             }
-            code->py._code.binary.trailer.name = pyobj_string_new(lexem_value(val_lex));
+            code->py._code.binary.trailer.name = parse_string(tokens);
+            if (!code->py._code.binary.trailer.name) return -1;
             seen_name = 1;
         }
 
         else if (key && 0 == strcmp(key, "stack_size")) {
             if (seen_stack_size) {
-                print_parse_error("Duplicate .set directive", lexems);
+                print_token_error("Duplicate .set directive", tokens);
                 return -1;
             }
-            if (!next_lexem_is(lexems, "number::uint")) {
-                print_parse_error("Expected decimal integer", lexems);
+            if (!next_token_is(tokens, "number::uint")) {
+                print_token_error("Expected decimal integer", tokens);
                 return -1;
             }
-            code->py._code.header.stack_size = (uint32_t)atoi(lexem_value(val_lex));
+            code->py._code.header.stack_size = (uint32_t)atoi(token_value(tokens, token_peek(tokens)));
             seen_stack_size = 1;
         }
 
         else if (key && 0 == strcmp(key, "arg_count")) {
             if (seen_arg_count) {
-                print_parse_error("Duplicate .set directive", lexems);
+                print_token_error("Duplicate .set directive", tokens);
                 return -1;
             }
-            if (!next_lexem_is(lexems, "number::uint")) {
-                print_parse_error("Expected decimal integer", lexems);
+            if (!next_token_is(tokens, "number::uint")) {
+                print_token_error("Expected decimal integer", tokens);
                 return -1;
             }
-            code->py._code.header.arg_count = (uint32_t)atoi(lexem_value(val_lex));
+            code->py._code.header.arg_count = (uint32_t)atoi(token_value(tokens, token_peek(tokens)));
             seen_arg_count = 1;
         }
 
         else {
-            print_parse_error("Unknown .set key", lexems);
+            print_token_error("Unknown .set key", tokens);
             return -1;
         }
     ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-        lexem_advance(lexems);
+        token_advance(tokens);
         // consume until end-of-line (if there are trailing blanks/comments)
-        while (lexem_peek(lexems) != NULL && !next_lexem_is(lexems, "structure::newline")) {
-            lexem_advance(lexems);
+        while (token_left(tokens) && !next_is_after_newline(tokens)) {
+            token_advance(tokens);
         }
-        skip_eol(lexems);
+        skip_eol(tokens);
     }
 
     // Checking that all flags have been seen
     if (!seen_version_pyvm || !seen_flags || !seen_filename || !seen_name || !seen_stack_size || !seen_arg_count) {
+        if (!parse_errors_reported(tokens)) return -1;
         fprintf(stderr, "[PARSER] Missing .set directive: ");
         if (!seen_version_pyvm) fprintf(stderr, "version_pyvm ");
         if (!seen_flags) fprintf(stderr, "flags ");
@@ -297,85 +701,124 @@ static int parse_set_directive(list_t *lexems, pyobj_t code) {
 
 // .const or .names parser
 
-// mode : 0 for names  1 consts
+static pyobj_t parse_nested_code(cursor_t *tokens, pyobj_t parent);
+
+// the stream of a table not parsed to its end, with its code objects
+static void stream_abort(conststream_t stream) {
+    for (size_t i = 0; i < conststream_code_count(stream); i++) {
+        pyobj_delete(conststream_code_at(stream, i));
+    }
+    conststream_delete(stream);
+}
+
+// mode : 0 for names  1 consts (which may hold code objects, see below)
 //-1 fail 0 success
-static int parse_table(list_t *lexems, pyobj_t *target_list, char *directive, int mode) {
+static int parse_table(cursor_t *tokens, pyobj_t code, pyobj_t *target_list, char *directive, int mode) {
     
-    if (!next_lexem_is(lexems, directive)) return 0; 
-    lexem_advance(lexems);
+    if (!next_token_is(tokens, directive)) return 0; 
+    token_advance(tokens);
     
     // end of line verif
-    if (!next_lexem_is(lexems, "structure::newline")) {
-        print_parse_error("Expected newline after table directive", lexems);
+    if (!next_is_newline(tokens)) {
+        print_token_error("Expected newline after table directive", tokens);
         return -1;
     }
-    skip_eol(lexems);
+    skip_eol(tokens);
 
     *target_list = pyobj_list_new(); 
 
+    // streamed .consts: *target_list stays empty, the stream holds them
+    conststream_t stream = mode == 1 && conststream_enabled() ? conststream_new() : NULL;
+
     // loop till we hit a new directive
-    while (lexem_peek(lexems) != NULL && !next_lexem_is(lexems, "directive::*")) {
+    while (token_left(tokens) && (!next_token_is(tokens, "directive::*") ||
+                                  (mode == 1 && next_token_is(tokens, "directive::code_start")))) {
 
-        if (next_lexem_is(lexems, "structure::blank") ||
-            next_lexem_is(lexems, "structure::comment") ||
-            next_lexem_is(lexems, "structure::newline")) {
-            lexem_advance(lexems);
+        if (next_token_is(tokens, "structure::blank") ||
+            next_token_is(tokens, "structure::comment") ||
+            next_token_is(tokens, "structure::newline")) {
+            token_advance(tokens);
             continue;
         }
 
         pyobj_t item = NULL;
-        if (mode == 1) {
+        if (stream) {
+            int status = 0;
+            if (next_token_is(tokens, "directive::code_start")) {
+                item = parse_nested_code(tokens, code);
+                if (item) conststream_code(stream, item);
+                else status = -1;
+            } else {
+                status = stream_constant(tokens, stream);
+            }
+            if (status < 0) {
+                stream_abort(stream);
+                pyobj_delete(*target_list);
+                *target_list = NULL;
+                return -1;
+            }
+            skip_eol(tokens);
+            continue;
+        }
+
+        if (mode == 1 && next_token_is(tokens, "directive::code_start")) {
+            // function, class... body
+            item = parse_nested_code(tokens, code);
+        } else if (mode == 1) {
             // .consts)
-            item = parse_constant(lexems);
+            item = parse_constant(tokens);
         } else {
             // Mode .names, .varnames... just strings
-            if (next_lexem_is(lexems, "string::double")) { //lil question here is string enough or should i type string::double ..
+            if (next_token_is(tokens, "string::double")) { //lil question here is string enough or should i type string::double ..
                 
-                 item = pyobj_string_new(lexem_value(lexem_peek(lexems)));
-                lexem_advance(lexems);
+                 item = parse_string(tokens);
+                 if (item) token_advance(tokens);
             } else {
-                 print_parse_error("Expected chain in the table", lexems);
+                 print_token_error("Expected chain in the table", tokens);
                  return -1;
             }
         }
 
         if (!item) {
             pyobj_delete(*target_list);
+            *target_list = NULL; // the code object must not free it again
             return -1;
         }
         // Once inserted, the list owns the item.
         if (0 != pyobj_list_prepend(*target_list, item)) {
             pyobj_delete(item);
             pyobj_delete(*target_list);
+            *target_list = NULL; // the code object must not free it again
             return -1;
         }
 
-        skip_eol(lexems);
+        skip_eol(tokens);
     }
     
 	pyobj_list_reverse(*target_list);
+    if (stream) conststream_attach(code, stream);
     return 0;
 }
 
 // use the previous function in order
-static int parse_all_tables(list_t *lexems, pyobj_t code) {
+static int parse_all_tables(cursor_t *tokens, pyobj_t code) {
     
     
     // .interned (String simples)
-    if (parse_table(lexems, &code->py._code.binary.content.interned, "directive::interned", 0) == -1) return -1;
+    if (parse_table(tokens, code, &code->py._code.binary.content.interned, "directive::interned", 0) == -1) return -1;
     
     // .varnames (String simples)
-    if (parse_table(lexems, &code->py._code.binary.content.varnames, "directive::varnames", 0) == -1) return -1; //to add to .lex
+    if (parse_table(tokens, code, &code->py._code.binary.content.varnames, "directive::varnames", 0) == -1) return -1; //to add to .lex
     
     // .freevars & .cellvars (Optionnels, strings simples)
-    if (parse_table(lexems, &code->py._code.binary.content.freevars, "directive::freevars", 0) == -1) return -1;
-    if (parse_table(lexems, &code->py._code.binary.content.cellvars, "directive::cellvars", 0) == -1) return -1;
+    if (parse_table(tokens, code, &code->py._code.binary.content.freevars, "directive::freevars", 0) == -1) return -1;
+    if (parse_table(tokens, code, &code->py._code.binary.content.cellvars, "directive::cellvars", 0) == -1) return -1;
 
     // .consts (Constantes complexes !)
-    if (parse_table(lexems, &code->py._code.binary.content.consts, "directive::consts", 1) == -1) return -1;
+    if (parse_table(tokens, code, &code->py._code.binary.content.consts, "directive::consts", 1) == -1) return -1;
 
     // .names (String simples)
-    if (parse_table(lexems, &code->py._code.binary.content.names, "directive::names", 0) == -1) return -1;
+    if (parse_table(tokens, code, &code->py._code.binary.content.names, "directive::names", 0) == -1) return -1;
 
     return 0;
 }
@@ -421,56 +864,63 @@ static int parse_all_tables(list_t *lexems, pyobj_t code) {
 //parse_code_section v2 adapted for pyasm
 
 //----------------------------------------------------------------------------------------------------
-static int parse_code_section(list_t *lexems, pyobj_t code) {
-    if (!next_lexem_is(lexems, "directive::text")) {
-        print_parse_error("Section .text manquante", lexems);
+static int parse_code_section(cursor_t *tokens, pyobj_t code) {
+    if (!next_token_is(tokens, "directive::text")) {
+        print_token_error("Section .text manquante", tokens);
         return -1;
     }
-    lexem_advance(lexems);
-    skip_eol(lexems);
+    token_advance(tokens);
+    skip_eol(tokens);
 
-    code->py._code.instructions = list_new();
+    // appended at the tail in O(1), given to the code object at the end
+    chain_t instructions = chain_new();
 
-    list_t list_labels_defined = list_new();
-    list_t list_labels_used = list_new();
+    // the same instructions as records for pyasm (see insn.h)
+    insn_list_t records = insn_list_new();
 
-    while (lexem_peek(lexems) != NULL) {
+    while (token_left(tokens)) {
+
+        // the end of a nested code object (see parse_nested_code())
+        if (tokens->depth && next_token_is(tokens, "directive::code_end")) break;
         
         // skip nl blnks cmnts 
-        if (next_lexem_is(lexems, "structure::newline") || 
-            next_lexem_is(lexems, "structure::blank") || 
-            next_lexem_is(lexems, "structure::comment")) {
-            lexem_advance(lexems); 
+        if (next_token_is(tokens, "structure::newline") || 
+            next_token_is(tokens, "structure::blank") || 
+            next_token_is(tokens, "structure::comment")) {
+            token_advance(tokens); 
             continue;
         }
         
-        lexem_t lex = lexem_peek(lexems);
-        char *lex_type = (char*)lexem_type(lex);
+        size_t lex = token_peek(tokens);
+        const char *lex_type = token_type(tokens, lex);
 
 
         //we keep the line directives
-        if (next_lexem_is(lexems, "directive::line")) {
+        if (next_token_is(tokens, "directive::line")) {
             
-            code->py._code.instructions = list_add_last(lexem_clone(lex), code->py._code.instructions);
-            lexem_advance(lexems);
+            token_take(tokens, lex, instructions);
+            token_advance(tokens);
             
             
-            while(next_lexem_is(lexems, "structure::blank")) lexem_advance(lexems);
+            while(next_token_is(tokens, "structure::blank")) token_advance(tokens);
 
             // store line number
-            if (next_lexem_is(lexems, "number::*")) {
-                lexem_t num_lex = lexem_peek(lexems);
-                code->py._code.instructions = list_add_last(lexem_clone(num_lex), code->py._code.instructions);
-                lexem_advance(lexems);
+            if (next_token_is(tokens, "number::*") && !next_is_after_newline(tokens) &&
+                !(trivia_flags(tokens) & LEXEM_AFTER_COMMENT)) {
+                size_t number = token_peek(tokens);
+                token_take(tokens, number, instructions);
+                insn_append(records, INSN_LINE, 0, INSN_ARG_NONE, atoi(token_value(tokens, number)),
+                            token_line(tokens, lex));
+                token_advance(tokens);
             }
             continue;
         }
 
         // identifier symbols
-        if (next_lexem_is(lexems, "identifier::symbol")) {
-            code->py._code.instructions = list_add_last(lexem_clone(lex), code->py._code.instructions);
+        if (next_token_is(tokens, "identifier::symbol")) {
+            token_take(tokens, lex, instructions);
 
-            lexem_advance(lexems);
+            token_advance(tokens);
             continue;
         }
 
@@ -480,118 +930,120 @@ static int parse_code_section(list_t *lexems, pyobj_t code) {
 
         if (strstr(lex_type, "insn::")) {
             // we add the opcode
-            code->py._code.instructions = list_add_last(lexem_clone(lex), code->py._code.instructions);
-            lexem_advance(lexems);
+            token_take(tokens, lex, instructions);
+            int opcode = insn_opcode_of_type(lex_type);
+            int line = token_line(tokens, lex);
+            token_advance(tokens);
 
             // if insn::1, we look for argument
             if (strstr(lex_type, "insn::1")) {
-                while(next_lexem_is(lexems, "structure::blank")) lexem_advance(lexems);
+                while(next_token_is(tokens, "structure::blank")) token_advance(tokens);
                 
-                lexem_t arg = lexem_peek(lexems);
-                if(next_lexem_is(lexems, "identifier::symbol")){
-                    code->py._code.instructions = list_add_last(lexem_clone(arg), code->py._code.instructions);
-                    
-                    if (strstr(lexem_value(arg), "label")) {
-                        list_labels_used = list_add_first(lexem_clone(arg), list_labels_used);
-                    }
-                    lexem_advance(lexems);
-                } else if (arg && (next_lexem_is(lexems, "number::*") || 
-                            next_lexem_is(lexems, "string::*"))) {
-                    code->py._code.instructions = list_add_last(lexem_clone(arg), code->py._code.instructions);
-                    lexem_advance(lexems);
+                size_t arg = token_peek(tokens);
+                // the argument must be on the same line
+                int has_arg = token_left(tokens) &&
+                    !(trivia_flags(tokens) & (LEXEM_AFTER_NEWLINE | LEXEM_AFTER_COMMENT));
+                if(has_arg && next_token_is(tokens, "identifier::symbol")){
+                    token_take(tokens, arg, instructions);
+                    int id = insn_label_id(records, token_value(tokens, arg), token_length(tokens, arg));
+                    insn_append(records, INSN_OP, opcode, INSN_ARG_LABEL, id, line);
+                    token_advance(tokens);
+                } else if (has_arg && next_token_is(tokens, "number::*")) {
+                    token_take(tokens, arg, instructions);
+                    insn_append(records, INSN_OP, opcode, INSN_ARG_VALUE, insn_value_of(token_value(tokens, arg)), line);
+                    token_advance(tokens);
+                } else if (has_arg && next_token_is(tokens, "string::*")) {
+                    // pyasm looks strings up as labels, and never finds them
+                    token_take(tokens, arg, instructions);
+                    int id = insn_label_id(records, token_value(tokens, arg), token_length(tokens, arg));
+                    insn_append(records, INSN_OP, opcode, INSN_ARG_STRING, id, line);
+                    token_advance(tokens);
                 } else {
-                    print_parse_error("Missing argument for instruction", lexems);
-                    list_delete(list_labels_defined, lexem_delete);
-                    list_delete(list_labels_used, lexem_delete);
+                    print_token_error("Missing argument for instruction", tokens);
+                    code->py._code.instructions = chain_to_list(instructions);
+                    insn_list_delete(records);
                     return -1;
                 }
+            } else {
+                insn_append(records, INSN_OP, opcode, INSN_ARG_NONE, 0, line);
             }
             continue;
         }
 
         //Labels management
-        if (next_lexem_is(lexems, "identifier::label")) {
-            lexem_t label_lex = lexem_new("identifier::label", (char*)lexem_value(lex), 
-                                          lexem_line(lex), lexem_column(lex));
-            code->py._code.instructions = list_add_last(label_lex, code->py._code.instructions);
-            list_labels_defined = list_add_first(lexem_clone(label_lex), list_labels_defined);
-            lexem_advance(lexems);
+        if (next_token_is(tokens, "identifier::label")) {
+            token_take(tokens, lex, instructions);
+            const char *d = token_value(tokens, lex);
+            size_t dlen = token_length(tokens, lex);
+            if (dlen > 0 && d[dlen - 1] == ':') dlen--;
+            insn_append(records, INSN_LABEL, 0, INSN_ARG_NONE, insn_label_id(records, d, dlen),
+                        token_line(tokens, lex));
+            token_advance(tokens);
             continue;
         }
 
         // error if we find sth else
-        print_parse_error("Unexpected token in .text", lexems);
-        list_delete(list_labels_defined, lexem_delete);
-        list_delete(list_labels_used, lexem_delete);
+        print_token_error("Unexpected token in .text", tokens);
+        code->py._code.instructions = chain_to_list(instructions);
+        insn_list_delete(records);
         return -1;
     }
 
-    //Check labels used vs defined
-    list_t tmp = list_labels_used;
-    while (tmp != NULL) {
-        lexem_t used = (lexem_t)(list_first(tmp));
-        int found = 0;
-        list_t tmp2 = list_labels_defined;
-        while (tmp2 != NULL) {
-            lexem_t defined = (lexem_t)(list_first(tmp2));
-            const char *u = lexem_value(used);
-            const char *d = lexem_value(defined);
-            if (u && d) {
-            size_t dlen = strlen(d);
-            if (dlen > 0 && d[dlen - 1] == ':') {
-                if (strlen(u) == dlen - 1 && 0 == strncmp(u, d, dlen - 1)) {
-                found = 1;
-                break;
-                }
-            } else {
-                if (0 == strcmp(u, d)) {
-                found = 1;
-                break;
-                }
-            }
-            }
-            tmp2 = list_next(tmp2);
+    code->py._code.instructions = chain_to_list(instructions);
+
+    //Check labels used vs defined: the symbols given to instructions
+    //with "label" in their name, the last undefined one is reported
+    size_t label_count = insn_label_count(records);
+    char *defined = calloc(label_count ? label_count : 1, 1);
+    assert(defined);
+    const insn_t *r = insn_data(records);
+    const insn_t *undefined = NULL;
+    for (size_t i = 0; i < insn_count(records); i++) {
+        if (INSN_LABEL == r[i].kind) defined[r[i].arg] = 1;
+    }
+    for (size_t i = 0; i < insn_count(records); i++) {
+        if (INSN_OP == r[i].kind && INSN_ARG_LABEL == r[i].arg_kind && !defined[r[i].arg] &&
+            strstr(insn_label_name(records, r[i].arg), "label")) {
+            undefined = &r[i];
         }
-        if (!found) {
-            fprintf(stderr, "[PARSER] Label never defined but used: %s (row %d)\n", lexem_value(used), lexem_line(used));
+    }
+    free(defined);
 
-            //Free lists
-            list_delete(list_labels_defined, lexem_delete);
-            list_delete(list_labels_used, lexem_delete);
-            return -1;
-        }
-        tmp = list_next(tmp);
+    if (undefined) {
+        if (parse_errors_reported(tokens))
+            fprintf(stderr, "[PARSER] Label never defined but used: %s (row %d)\n",
+                    insn_label_name(records, undefined->arg), undefined->line);
+        insn_list_delete(records);
+        return -1;
     }
-    //cleanup
-        list_delete(list_labels_defined, lexem_delete);
-        list_delete(list_labels_used, lexem_delete);
 
+    insn_attach(code, records);
     return 0;
 }
 // // // // // // // /*--/-*-*-**-*/-----**-*--/-*--*-*/-//--*//*--*-*-*---*-*-*
 
-pyobj_t parse_program(list_t *lexems) {
+static pyobj_t parse_cursor(cursor_t *tokens) {
     //new empty object
     pyobj_t code = pyobj_code_new();
     if (!code) return NULL;
 
     //skip line in begining
-    skip_eol(lexems);
+    skip_eol(tokens);
 
     //Directives .set
-    if (parse_set_directive(lexems, code) == -1) {
+    if (parse_set_directive(tokens, code) == -1) {
         pyobj_delete(code); 
         return NULL;
     }
 
     //Tables
-    if (parse_all_tables(lexems, code) == -1) {
+    if (parse_all_tables(tokens, code) == -1) {
          pyobj_delete(code);
         return NULL;
     }
 
     //Code section
-    if (parse_code_section(lexems, code) == -1) {
+    if (parse_code_section(tokens, code) == -1) {
         pyobj_delete(code);
         return NULL;
     }
@@ -600,6 +1052,86 @@ pyobj_t parse_program(list_t *lexems) {
     return code;
 }
 
+// A code object in .consts is written in place, between .code_start and
+// .code_end, each on a line of its own:
+//
+//   .consts
+//     None
+//     .code_start
+//       .set ...        (a whole code object, like the module)
+//       .text
+//       ...
+//     .code_end
+//
+// and may hold code objects itself.
+static pyobj_t parse_nested_code(cursor_t *tokens, pyobj_t parent) {
+    token_advance(tokens);
+    if (!next_is_newline(tokens)) {
+        print_token_error("Expected newline after .code_start", tokens);
+        return NULL;
+    }
+
+    tokens->depth++;
+    pyobj_t code = parse_cursor(tokens);
+    tokens->depth--;
+    if (!code) return NULL;
+
+    if (!next_token_is(tokens, "directive::code_end")) {
+        print_token_error("Expected .code_end", tokens);
+        pyobj_delete(code);
+        return NULL;
+    }
+    token_advance(tokens);
+
+    code->py._code.parent = parent;
+    return code;
+}
+
+// Parses a whole token buffer, as returned by lex_tokens().
+// The instructions of the code object are lexems borrowed from the buffer
+// (see tokbuf_view()): it must be deleted after the code object.
+pyobj_t parse_tokens(tokbuf_t tokens) {
+    cursor_t cursor;
+    cursor_init(&cursor, &tokens);
+    return parse_cursor(&cursor);
+}
+
+// Parses the tokens of a pipe while they are lexed (see tokpipe.h), with
+// the same result and messages as parse_tokens(lex_tokens(...)). NULL on
+// a lexical error too, tokpipe_finish() tells which one it was. The
+// instructions are borrowed from the pipe's buffers, like above.
+pyobj_t parse_pipe(tokpipe_t pipe) {
+    cursor_t cursor = { NULL, 0, TOKPIPE_BATCH_SHIFT, TOKPIPE_BATCH - 1, 0, 0, pipe, 0, NULL, NULL };
+    pyobj_t code = parse_cursor(&cursor);
+    free(cursor.batches);
+
+    if (code && tokpipe_finish(pipe) < 0) {
+        pyobj_delete(code);
+        return NULL;
+    }
+    return code;
+}
+
+// List interface: the tokens are read from the lexems themselves, and
+// *lexems is moved past the consumed ones like the list cursor did.
+// The lexems of the instructions are moved, with their links, out of the
+// caller's list into the instruction lists of the code objects, which
+// own them from then on (a code object given up on a syntax error takes
+// its lexems with it): the caller still deletes its list as before.
+pyobj_t parse_program(list_t *lexems) {
+    cursor_t cursor;
+    cursor_init_list(&cursor, *lexems);
+    pyobj_t code = parse_cursor(&cursor);
+
+    size_t pos = cursor.pos;
+    while (pos < cursor.count && cursor.moved[pos]) pos++;
+    *lexems = pos < cursor.count ? cursor.links[pos] : NULL;
+
+    free(cursor.links);
+    free(cursor.moved);
+    return code;
+}
+
 /* Backward-compatible alias (not in public header). */
 pyobj_t parse_pys(list_t *lexems) {
     return parse_program(lexems);
@@ -10,14 +10,21 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <generic/arena.h>
+#include <generic/chain.h>
+#include <generic/intern.h>
+#include <generic/vector.h>
 #include <lexer/lexem.h>
+#include <lexer/numlit.h>
 
 #include <parser/pyobj.h>
+#include <parser/insn.h>
+#include <parser/conststream.h>
 
 
 static pyobj_t pyobj_alloc(pyobj_type type) {
 	// Allocation + init (calloc met tout à 0)
-	pyobj_t obj = calloc(1, sizeof(*obj));
+	pyobj_t obj = unit_calloc(1, sizeof(*obj));
 	assert(obj);
 	obj->refcount = 1;
 	obj->type = type;
@@ -45,26 +52,29 @@ pyobj_t pyobj_float_new(double value) {
 	return obj;
 }
 
+pyobj_t pyobj_string_new_n(const char *bytes, size_t length, int interned) {
+	// the length is given: the bytes may hold '\0'
+	pyobj_t obj = pyobj_alloc(PYOBJ_STRING);
+	obj->py._string.length = (int)length;
+
+	if (interned) {
+		// the buffer is interned (see intern.h): never modified nor freed,
+		// equal names and constants share it
+		obj->py._string.buffer = (char *)intern_n(bytes, length);
+	} else {
+		// a buffer of its own, for bytes seen once (bytecode, lnotab)
+		obj->py._string.buffer = unit_malloc(length ? length : 1);
+		assert(obj->py._string.buffer);
+		memcpy(obj->py._string.buffer, bytes, length);
+	}
+	return obj;
+}
+
 pyobj_t pyobj_string_new(const char *s) {
 	// Create string
 	//modif now a string is no longer pointer to char it's a new struct with len included (to solve problems with serialiser)
-	pyobj_t obj = pyobj_alloc(PYOBJ_STRING);
-    
-    if (s) {
-        size_t len = strlen(s);
-        // On remplit les champs de la nouvelle structure
-        obj->py._string.length = (int)len;
-        obj->py._string.buffer = malloc(len + 1); // +1 pour le \0 de sécurité
-        assert(obj->py._string.buffer);
-        memcpy(obj->py._string.buffer, s, len + 1);
-    } else {
-        obj->py._string.length = 0;
-        obj->py._string.buffer = malloc(1);
-        assert(obj->py._string.buffer);
-        obj->py._string.buffer[0] = '\0';
-    }
-    
-    return obj;
+	s = s ? s : "";
+	return pyobj_string_new_n(s, strlen(s), 1);
 }
 
 pyobj_t pyobj_none_new(void) {
@@ -96,13 +106,12 @@ pyobj_t pyobj_tuple_new_from_list(list_t elements) {
 		return obj;
 	}
 
-	list_t clone = list_new();
+	chain_t clone = chain_new();
 	for ( ; !list_is_empty(elements); elements = list_next(elements) ) {
-		void *el = list_first(elements);
-		clone = list_add_last(el, clone);
+		chain_add_last(clone, list_first(elements));
 	}
 
-	obj->py._list = clone;
+	obj->py._list = chain_to_list(clone);
 	return obj;
 }
 
@@ -125,22 +134,13 @@ pyobj_t pyobj_code_new(void) {
 }
 
 
-static int pyobj_print_list_like(list_t l, const char *open, const char *close) {
-	// Helper to print list/tuple
-	int nchars = 0;
-	nchars += printf("%s", open);
-
-	for (; !list_is_empty(l); l = list_next(l)) {
-		pyobj_t item = (pyobj_t)list_first(l);
-		nchars += pyobj_print(item);
-		if (!list_is_empty(list_next(l))) nchars += printf(", ");
-	}
-
-	nchars += printf("%s", close);
-	return nchars;
+static int pyobj_print_float(double value) {
+	// shortest digits that read back the same, as repr() (%g keeps 6)
+	char digits[NUMLIT_FLOAT_SIZE];
+	numlit_float_format(value, digits);
+	return printf("%s", digits);
 }
 
-
 void pyobj_list_reverse(pyobj_t list) {
 	// Reverse a list/tuple
 	if (NULL == list) return;
@@ -159,10 +159,8 @@ int pyobj_list_prepend(pyobj_t list, pyobj_t item) {
 }
 
 
-int pyobj_print(void *_obj) {
-	// Print a Python object (debug output)
-	pyobj_t obj = (pyobj_t)_obj;
-
+// anything but a list or tuple (see pyobj_print_nested())
+static int pyobj_print_scalar(pyobj_t obj) {
 	if (NULL == obj) return printf("<null>");
 
 	switch (obj->type) {
@@ -177,13 +175,9 @@ int pyobj_print(void *_obj) {
 	case PYOBJ_INT64:
 		return printf("%'" PRId64, obj->py._int64);
 	case PYOBJ_FLOAT:
-		return printf("%g", obj->py._float);
+		return pyobj_print_float(obj->py._float);
 	case PYOBJ_STRING:
 		return printf("%s", obj->py._string.buffer ? obj->py._string.buffer : ""); //modified aftr string we show the buffer of _string
-	case PYOBJ_LIST:
-		return pyobj_print_list_like(obj->py._list, "[", "]");
-	case PYOBJ_TUPLE:
-		return pyobj_print_list_like(obj->py._list, "(", ")");
 	case PYOBJ_CODE:
 		return printf("<code object>");
 	case PYOBJ_NULL:
@@ -192,163 +186,198 @@ int pyobj_print(void *_obj) {
 	}
 }
 
-int pyobj_print_all_recursif(pyobj_t obj){
-
-	if (NULL == obj) {
-		return printf("<null>");
+// same as pyobj_print_scalar(), with the details of code objects
+static int pyobj_print_details(pyobj_t obj) {
+	if (NULL == obj || PYOBJ_CODE != obj->type) return pyobj_print_scalar(obj);
+
+	//Write the code object details
+	printf("Code Object:\n");
+	printf(" |- Arg Count: %u\n", obj->py._code.header.arg_count);
+	printf(" |- Local Count: %u\n", obj->py._code.header.local_count);
+	printf(" |- Stack Size: %u\n", obj->py._code.header.stack_size);
+	printf(" |- Flags: %u\n", obj->py._code.header.flags);
+
+	//parent (not recursively: it holds this code object)
+	printf(" |- Parent: ");
+	if (obj->py._code.parent) pyobj_print(obj->py._code.parent);
+	else pyobj_print_all_recursif(NULL);
+	printf("\n");
+
+	//Header
+	printf(" |- Binary Header:\n");
+	printf(" |    |- Version PyVM: %u\n", obj->py._code.binary.header.version_pyvm);
+	printf(" |    |- Magic: %u\n", obj->py._code.binary.header.magic);
+	printf(" |    |- Source Size: %u\n", obj->py._code.binary.header.source_size);
+
+	//in py._code.binary.content print all the content
+	printf(" |- Binary Content:\n");
+	printf(" |    |- Interned: ");
+	pyobj_print_all_recursif(obj->py._code.binary.content.interned);
+	printf("\n |    |- Bytecode: ");
+	pyobj_print_all_recursif(obj->py._code.binary.content.bytecode);
+	printf("\n |    |- Consts: ");
+	conststream_t stream = conststream_of(obj);
+	if (stream) printf("<%zu constants, %zu bytes>", conststream_count(stream), conststream_size(stream));
+	else pyobj_print_all_recursif(obj->py._code.binary.content.consts);
+
+	printf("\n |    |- Names: ");
+	pyobj_print_all_recursif(obj->py._code.binary.content.names);
+	printf("\n |    |- Varnames: ");
+	pyobj_print_all_recursif(obj->py._code.binary.content.varnames);
+	printf("\n |    |- Freevars: ");
+	pyobj_print_all_recursif(obj->py._code.binary.content.freevars);
+	printf("\n |    |- Cellvars: ");
+	pyobj_print_all_recursif(obj->py._code.binary.content.cellvars);
+	printf("\n");
+
+	//Print trailer
+	printf(" |- Trailer:\n");
+	printf(" |    |- Filename: ");
+	pyobj_print_all_recursif(obj->py._code.binary.trailer.filename);
+	printf("\n |    |- Name: ");
+	pyobj_print_all_recursif(obj->py._code.binary.trailer.name);
+	printf("\n |    |- First Line No: %u\n", obj->py._code.binary.trailer.firstlineno);
+	printf(" |    |- Lnotab: ");
+	pyobj_print_all_recursif(obj->py._code.binary.trailer.lnotab);
+	printf("\n");
+
+	//Print instructions
+	printf(" |- Instructions:\n");
+	for (list_t l = obj->py._code.instructions; !list_is_empty(l); l = list_next(l)) {
+		lexem_t instr = (lexem_t)list_first(l);
+		printf(" |    |- ");lexem_print(instr);
+		printf("\n");
 	}
 
-	switch (obj->type) {
-		case PYOBJ_NONE:
-			return printf("None");
-		case PYOBJ_TRUE:
-			return printf("True");
-		case PYOBJ_FALSE:
-			return printf("False");
-		case PYOBJ_INT:
-			return printf("%'" PRId32, obj->py._int);
-		case PYOBJ_INT64:
-			return printf("%'" PRId64, obj->py._int64);
-		case PYOBJ_FLOAT:
-			return printf("%g", obj->py._float);
-		case PYOBJ_STRING:
-			return printf("%s", obj->py._string.buffer ? obj->py._string.buffer : "");
-		case PYOBJ_LIST: {
-			int nchars = printf("[");
-			for (list_t l = obj->py._list; !list_is_empty(l); l = list_next(l)) {
-				pyobj_t item = (pyobj_t)list_first(l);
-				nchars += pyobj_print_all_recursif(item);
-				if (!list_is_empty(list_next(l))) {
-					nchars += printf(", ");
-				}
-			}
-			nchars += printf("]");
-			return nchars;
+	return 0;
+}
+
+// Lists and tuples print as deep as they nest: the rest of each one
+// being printed is kept on a stack of their own (the collection, then
+// the rest of its items), not on the C stack. print_item prints the
+// other objects.
+static int pyobj_print_nested(pyobj_t obj, int (*print_item)(pyobj_t)) {
+	vector_t open = NULL;
+	int nchars = 0;
+
+	for (;;) {
+		if (obj && (PYOBJ_LIST == obj->type || PYOBJ_TUPLE == obj->type)) {
+			nchars += printf(PYOBJ_LIST == obj->type ? "[" : "(");
+			if (!open) open = vector_new();
+			vector_append(open, obj);
+			vector_append(open, obj->py._list);
+		} else {
+			nchars += print_item(obj);
 		}
-		case PYOBJ_TUPLE: {
-			int nchars = printf("(");
-			for (list_t l = obj->py._list; !list_is_empty(l); l = list_next(l)) {
-				pyobj_t item = (pyobj_t)list_first(l);
-				nchars += pyobj_print_all_recursif(item);
-				if (!list_is_empty(list_next(l))) {
-					nchars += printf(", ");
-				}
+
+		// next item of the innermost collection, closing those done
+		int more = 0;
+		while (!more && open && !vector_is_empty(open)) {
+			list_t rest = vector_pop(open);
+			pyobj_t collection = vector_last(open);
+
+			if (list_is_empty(rest)) {
+				vector_pop(open);
+				nchars += printf(PYOBJ_LIST == collection->type ? "]" : ")");
+				continue;
 			}
-			nchars += printf(")");
-			return nchars;
+			if (rest != collection->py._list) nchars += printf(", ");
+			obj = list_first(rest);
+			vector_append(open, list_next(rest));
+			more = 1;
 		}
-		case PYOBJ_CODE:
-			//Write the code object details
-			printf("Code Object:\n");
-			printf(" |- Arg Count: %u\n", obj->py._code.header.arg_count);
-			printf(" |- Local Count: %u\n", obj->py._code.header.local_count);
-			printf(" |- Stack Size: %u\n", obj->py._code.header.stack_size);
-			printf(" |- Flags: %u\n", obj->py._code.header.flags);
-
-			//parent
-			printf(" |- Parent: ");
-			pyobj_print_all_recursif(obj->py._code.parent);
-			printf("\n");
-
-			//Header
-			printf(" |- Binary Header:\n");
-			printf(" |    |- Version PyVM: %u\n", obj->py._code.binary.header.version_pyvm);
-			printf(" |    |- Magic: %u\n", obj->py._code.binary.header.magic);
-			printf(" |    |- Source Size: %u\n", obj->py._code.binary.header.source_size);
-
-			//in py._code.binary.content print all the content
-			printf(" |- Binary Content:\n");
-			printf(" |    |- Interned: ");
-			pyobj_print_all_recursif(obj->py._code.binary.content.interned);
-			printf("\n |    |- Bytecode: ");
-			pyobj_print_all_recursif(obj->py._code.binary.content.bytecode);
-			printf("\n |    |- Consts: ");
-			pyobj_print_all_recursif(obj->py._code.binary.content.consts);
-
-			printf("\n |    |- Names: ");
-			pyobj_print_all_recursif(obj->py._code.binary.content.names);
-			printf("\n |    |- Varnames: ");
-			pyobj_print_all_recursif(obj->py._code.binary.content.varnames);
-			printf("\n |    |- Freevars: ");
-			pyobj_print_all_recursif(obj->py._code.binary.content.freevars);
-			printf("\n |    |- Cellvars: ");
-			pyobj_print_all_recursif(obj->py._code.binary.content.cellvars);
-			printf("\n");
-
-			//Print trailer
-			printf(" |- Trailer:\n");
-			printf(" |    |- Filename: ");
-			pyobj_print_all_recursif(obj->py._code.binary.trailer.filename);
-			printf("\n |    |- Name: ");
-			pyobj_print_all_recursif(obj->py._code.binary.trailer.name);
-			printf("\n |    |- First Line No: %u\n", obj->py._code.binary.trailer.firstlineno);
-			printf(" |    |- Lnotab: ");
-			pyobj_print_all_recursif(obj->py._code.binary.trailer.lnotab);
-			printf("\n");
-
-			//Print instructions
-			printf(" |- Instructions:\n");
-			for (list_t l = obj->py._code.instructions; !list_is_empty(l); l = list_next(l)) {
-				lexem_t instr = (lexem_t)list_first(l);
-				printf(" |    |- ");lexem_print(instr);
-				printf("\n");
-			}
+		if (!more) break;
+	}
 
-			return 0;
+	vector_delete(open, NULL);
+	return nchars;
+}
 
-		case PYOBJ_NULL:
-		default:
-			return printf("<pyobj:%d>", obj->type);
-	}
+int pyobj_print(void *obj) {
+	// Print a Python object (debug output)
+	return pyobj_print_nested(obj, pyobj_print_scalar);
 }
 
-int pyobj_delete(void *_obj) {
-	// memory cleaning (récursif pour list/tuple/code)
-	pyobj_t obj = (pyobj_t)_obj;
-	if (NULL == obj) return 0;
+int pyobj_print_all_recursif(pyobj_t obj) {
+	return pyobj_print_nested(obj, pyobj_print_details);
+}
+
+// frees obj if it holds no other object, else leaves it to pyobj_delete()
+static void pyobj_delete_later(pyobj_t obj, vector_t *pending) {
+	if (NULL == obj) return;
 
 	switch (obj->type) {
+	case PYOBJ_LIST:
+	case PYOBJ_TUPLE:
+	case PYOBJ_CODE:
+		if (!*pending) *pending = vector_new();
+		vector_append(*pending, obj);
+		return;
+
 	case PYOBJ_STRING:
-		if (obj->py._string.buffer) {
-            free(obj->py._string.buffer);
+		// interned buffers are shared
+		if (obj->py._string.buffer && !intern_owns(obj->py._string.buffer)) {
+            unit_free(obj->py._string.buffer);
         }
         break;
 
-	case PYOBJ_LIST:
-		list_delete(obj->py._list, pyobj_delete);
-		break;
-		
-	case PYOBJ_TUPLE:
-		list_delete(obj->py._list, pyobj_delete);
+	default:
 		break;
+	}
+	unit_free(obj);
+}
 
-	case PYOBJ_CODE:
-		pyobj_delete(obj->py._code.binary.content.interned);
-		pyobj_delete(obj->py._code.binary.content.bytecode);
-		pyobj_delete(obj->py._code.binary.content.consts);
-		pyobj_delete(obj->py._code.binary.content.names);
-		pyobj_delete(obj->py._code.binary.content.varnames);
-		pyobj_delete(obj->py._code.binary.content.freevars);
-		pyobj_delete(obj->py._code.binary.content.cellvars);
-
-		pyobj_delete(obj->py._code.binary.trailer.filename);
-		pyobj_delete(obj->py._code.binary.trailer.name);
-		pyobj_delete(obj->py._code.binary.trailer.lnotab);
-
-		list_delete(obj->py._code.instructions, lexem_delete);
-		break;
+int pyobj_delete(void *_obj) {
+	// memory cleaning: the lists, tuples and code objects held are kept on
+	// a stack of their own until they are freed, not on the C stack
+	vector_t pending = NULL;
+	pyobj_delete_later((pyobj_t)_obj, &pending);
 
-	case PYOBJ_NONE:
-	case PYOBJ_TRUE:
-	case PYOBJ_FALSE:
-	case PYOBJ_INT:
-	case PYOBJ_INT64:
-	case PYOBJ_FLOAT:
-	case PYOBJ_NULL:
-	default:
-		break;
+	while (pending && !vector_is_empty(pending)) {
+		pyobj_t obj = vector_pop(pending);
+
+		switch (obj->type) {
+		case PYOBJ_LIST:
+		case PYOBJ_TUPLE:
+			for (list_t l = obj->py._list; !list_is_empty(l); l = list_next(l)) {
+				pyobj_delete_later(list_first(l), &pending);
+			}
+			list_delete(obj->py._list, NULL);
+			break;
+
+		case PYOBJ_CODE: {
+			// streamed consts: the code objects are all the stream holds
+			conststream_t stream = conststream_detach(obj);
+			if (stream) {
+				for (size_t i = 0; i < conststream_code_count(stream); i++) {
+					pyobj_delete_later(conststream_code_at(stream, i), &pending);
+				}
+				conststream_delete(stream);
+			}
+
+			pyobj_delete_later(obj->py._code.binary.content.interned, &pending);
+			pyobj_delete_later(obj->py._code.binary.content.bytecode, &pending);
+			pyobj_delete_later(obj->py._code.binary.content.consts, &pending);
+			pyobj_delete_later(obj->py._code.binary.content.names, &pending);
+			pyobj_delete_later(obj->py._code.binary.content.varnames, &pending);
+			pyobj_delete_later(obj->py._code.binary.content.freevars, &pending);
+			pyobj_delete_later(obj->py._code.binary.content.cellvars, &pending);
+
+			pyobj_delete_later(obj->py._code.binary.trailer.filename, &pending);
+			pyobj_delete_later(obj->py._code.binary.trailer.name, &pending);
+			pyobj_delete_later(obj->py._code.binary.trailer.lnotab, &pending);
+
+			insn_list_delete(insn_detach(obj));
+			list_delete(obj->py._code.instructions, lexem_delete);
+			break;
+		}
+
+		default:
+			break;
+		}
+		unit_free(obj);
 	}
 
-	free(obj);
+	vector_delete(pending, NULL);
 	return 0;
 }
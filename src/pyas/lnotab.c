@@ -8,15 +8,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <generic/list.h>
+#include <generic/arena.h>
 #include <pyas/lnotab.h>
 
 lnotab_t* create_lnotab(int line){  
-    lnotab_t *lnotab = malloc(sizeof(lnotab_t)); 
+    lnotab_t *lnotab = unit_malloc(sizeof(lnotab_t)); 
     if (!lnotab) return NULL;
 
     lnotab->buffer_size = 255; // as everything is a byte, there is (hopefully) no reason for anything to be bigger than 256
     lnotab->lnotab_size = 0;
-    lnotab->buffer = malloc(lnotab->buffer_size);
+    lnotab->buffer = unit_malloc(lnotab->buffer_size);
     lnotab->byte_offset = 0;
     lnotab->last_line = line;
     return lnotab;
@@ -64,7 +65,7 @@ lnotab_t* lnotab_append (lnotab_t* lnotab, int line_number, int bytecode_address
 }
 void free_lnotab(lnotab_t *lnotab) {
     if (lnotab) {
-        free(lnotab->buffer);
-        free(lnotab);
+        unit_free(lnotab->buffer);
+        unit_free(lnotab);
     }
 }
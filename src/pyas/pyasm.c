@@ -9,104 +9,48 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <generic/arena.h>
+#include <generic/threadpool.h>
+#include <generic/vector.h>
 #include <pyas/lnotab.h>
 #include <parser/pyobj.h>
-#include <lexer/lexem.h>
-
-//labels 
-// i create a structure to store labels name+adress (octet)
-typedef struct label_s {
-    char *name;         
-    int addr;           
-    struct label_s *next; //pointer to the next (very useful parlasuite)
-} label_t;
-
-
-static void label_add(label_t **table, char *name, int addr) {
-    label_t *new = malloc(sizeof(label_t));
-    assert(new != NULL);
-
-    new->name = strdup(name);
-    
-//removz the : 
-    size_t len = strlen(new->name);
-    if (len > 0 && new->name[len-1] == ':') {
-        new->name[len-1] = '\0';
-    }
-
-    new->addr = addr;
-    new->next = *table;
-    *table = new;
-}
-
-// find label address with name returns -1 if fail=
-static int label_get_addr(label_t *table, char *name) {
-    label_t *curr = table;
-    while (curr) {
-        if (strcmp(curr->name, name) == 0) {
-            return curr->addr;
-        }
-        curr = curr->next;
-    }
-    return -1; // unknown labl
-}
+#include <parser/insn.h>
+#include <parser/constpool.h>
+#include <parser/conststream.h>
 
+pyobj_t pyobj_string_new_n(const char *bytes, size_t length, int interned);
 
-static void label_free(label_t *table) {
-    label_t *curr = table;
-    while (curr) {
-        label_t *next = curr->next;
-        free(curr->name);
-        free(curr);
-        curr = next;
-    }
-}
+//labels 
+// labels are numbered by the parser (see insn.h): label ID -> adress (octet),
+// -1 while the label is not defined
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 //Adress calc
 //this will be the first passage 1 : it should return the total size of the bytecode
 
-static int pyasm_pass1(pyobj_t code_obj, label_t **label_table) {
+static int pyasm_pass1(insn_list_t records, int *label_addr) {
     int current_offset = 0;
-    
-    //the code section parsed we put it in list lexem
-    list_t lexems = code_obj->py._code.instructions;
-    
-    //traveling through lexems ...... ^-^
-    list_t cursor = lexems; 
-
-    while ( !list_is_empty(cursor) ) {
-        lexem_t lex = list_first(cursor); // capture the current lexem
-        const char *type = lexem_type(lex);
-        
-        //  case 1 : Labels
-        if (strstr(type, "label") != NULL || strchr(lexem_value(lex), ':')) {
-            
-            label_add(label_table, (char*)lexem_value(lex), current_offset);
-        }
-        
-        // case 2 : Iinsn::0 no argument (1 octet)
-
-        else if (strstr(type, "insn::0") != NULL) {
-            current_offset += 1;
-        }
-        
-        // case 3 : insn::1 with args(3 octets)
-        // Opcode (1 octet) + Argument (2 octets) = 3 octets
-        else if (strstr(type, "insn::1") != NULL) {
-            current_offset += 3;
-            // consume the argument
-            cursor = list_next(cursor); 
-        }
-
-        // case 4 : skip directive line and the num  that follows
-        else if (strstr(type, "directive::line") != NULL) {
-             cursor = list_next(cursor); // skip line numbr
+    const insn_t *r = insn_data(records);
+    size_t count = insn_count(records);
+
+    for (size_t i = 0; i < count; i++) {
+        switch (r[i].kind) {
+        //  case 1 : Labels (a label defined twice: the last definition wins)
+        case INSN_LABEL:
+            label_addr[r[i].arg] = current_offset;
+            break;
+
+        // case 2 : insn::0 no argument (1 octet)
+        // case 3 : insn::1 Opcode (1 octet) + Argument (2 octets) = 3 octets
+        case INSN_OP:
+            current_offset += INSN_ARG_NONE == r[i].arg_kind ? 1 : 3;
+            break;
+
+        // case 4 : directive line (0 octet)
+        default:
+            break;
         }
-        
-        // case 5 : Directives n Commentaires (0 octet)
-        
-        cursor = list_next(cursor);
     }
     
     return current_offset;
@@ -114,17 +58,6 @@ static int pyasm_pass1(pyobj_t code_obj, label_t **label_table) {
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
-//extract the opcode
-static int get_opcode_from_type(const char *type) {
-    // look for "0x"
-    char *hex_str = strstr(type, "0x");
-    if (hex_str) {
-        return (int)strtol(hex_str, NULL, 16);
-    }
-    
-    return 0; 
-}
-
 //if it's a jump
 static int is_relative_jump(int opcode) {
     
@@ -143,214 +76,281 @@ static int is_relative_jump(int opcode) {
 ///////////////////////////////////////////////////////////////////////////////////////////
 //this will be 2 passage should generate the bytecode
 
-static void pyasm_pass2(pyobj_t code_obj, label_t *labels, unsigned char *bytecode) {
+// returns the first jump to an undefined label (NULL if there is none)
+static const insn_t *pyasm_pass2(insn_list_t records, const int *label_addr, unsigned char *bytecode) {
     int offset = 0;
-    list_t cursor = code_obj->py._code.instructions;
+    const insn_t *r = insn_data(records);
+    size_t count = insn_count(records);
 
-    while ( !list_is_empty(cursor) ) {
-        lexem_t lex = list_first(cursor);
-        const char *type = lexem_type(lex);
-        char *val = (char*)lexem_value(lex);
+    for (size_t i = 0; i < count; i++) {
+        // labels and lines: nothing to write
+        if (INSN_OP != r[i].kind) continue;
 
-        //  case 1 : Label cintinue already dealt with in pass1
-        if (strstr(type, "label") || strchr(val, ':')) {
-            cursor = list_next(cursor);
-            continue;
-        }
+        int opcode = r[i].opcode;
+        bytecode[offset] = (unsigned char)opcode;
+        offset += 1;
 
-        // Ignore directives line here too!
-        
-        if (strstr(type, "directive::line")) {
-            cursor = list_next(cursor); // skip the number token
-            cursor = list_next(cursor); 
-            continue; 
-            // cursor is at .line. list_next moves to number. 
-            // Loop bottom does list_next -> moves to next instr. Correct.
-        }
+        if (INSN_ARG_NONE == r[i].arg_kind) continue;
 
-        // case 2
-        if (strstr(type, "insn::0")) {
-            int opcode = get_opcode_from_type(type);
-            bytecode[offset] = (unsigned char)opcode;
-            offset += 1;
-        }
-        
-        // case 3
-        else if (strstr(type, "insn::1")) {
-            // write opcode
-            int opcode = get_opcode_from_type(type);
-            bytecode[offset] = (unsigned char)opcode;
-            offset += 1;
-
-            // then the argument
-            cursor = list_next(cursor); 
-            // verify if there is an argument
-            if (list_is_empty(cursor)) {
-                fprintf(stderr, "Erreur: Argument manquant pour l'instruction %s\n", val);
-                exit(EXIT_FAILURE);
-            }
-            
-            lexem_t arg_lex = list_first(cursor);
-            char *arg_val = (char*)lexem_value(arg_lex);
-            const char *arg_type = lexem_type(arg_lex);
-            
-            int arg_value = 0;
-
-            // analyse arg (Entier, Hex or another Label ?)
-            
-            // if number dec or hex
-            if (strstr(arg_type, "number") || (arg_val[0] >= '0' && arg_val[0] <= '9') || arg_val[0] == '-') {
-                
-                if (strstr(arg_val, "0x")) {
-                    arg_value = (int)strtol(arg_val, NULL, 16);
-                } else {
-                    arg_value = atoi(arg_val);
-                }
-            }
-            // Si c'est un symbole -> C'est un Label (Saut)
-            else {
-                int target_addr = label_get_addr(labels, arg_val);
-                
-                if (target_addr == -1) {
-                    fprintf(stderr, "Erreur: Label indéfini '%s' (utilisé ligne %d)\n", 
-                            arg_val, lexem_line(lex));
-                    exit(EXIT_FAILURE);
-                }
-
-                // calculate the jump
-                if (is_relative_jump(opcode)) {
-                    // relative jump : Cible - (Instruction_Courante + 3)
-                    // offset pointe actuellement sur l'argument (opcode déjà passé +1), 
-                    // donc l'instruction complète finit à offset + 2.
-                    arg_value = target_addr - (offset + 2);
-                } else {
-                    // saut absolute
-                    arg_value = target_addr;
-                }
-            }
+        int arg_value = r[i].arg;
+
+        // a symbol -> it's a label (jump)
+        if (INSN_ARG_VALUE != r[i].arg_kind) {
+            int target_addr = label_addr[r[i].arg];
 
-            // lil endian writing
-            bytecode[offset] = arg_value & 0xFF;        // LSB
-            bytecode[offset+1] = (arg_value >> 8) & 0xFF; // MSB
-            
-            offset += 2;
+            if (target_addr == -1) return &r[i];
+
+            // calculate the jump
+            if (is_relative_jump(opcode)) {
+                // relative jump : Cible - (Instruction_Courante + 3)
+                // offset pointe actuellement sur l'argument (opcode déjà passé +1), 
+                // donc l'instruction complète finit à offset + 2.
+                arg_value = target_addr - (offset + 2);
+            } else {
+                // saut absolute
+                arg_value = target_addr;
+            }
         }
 
-        // P ext lexem
-        cursor = list_next(cursor);
+        // lil endian writing
+        bytecode[offset] = arg_value & 0xFF;        // LSB
+        bytecode[offset+1] = (arg_value >> 8) & 0xFF; // MSB
+        
+        offset += 2;
     }
+    return NULL;
 }
 
 //
 ////////////////////////////////////////////////////////////////////////////
+// One code object to assemble. The jobs may run on several threads at
+// once (see pyasm() below), so they only use their own records and
+// malloc(): the python objects are made afterwards, on the caller's
+// thread, from what they leave here.
+struct pyasm_job {
+    pyobj_t        code;
+    insn_list_t    records;
+
+    unsigned char *bytecode;
+    int            bytecode_size;
+    unsigned char *lnotab;
+    int            lnotab_size;  // -1 if it could not be made
+    const insn_t  *undefined;    // jump to an undefined label
+};
+
 //implementing lnotable
 
-static int pyasm_generate_lnotab(pyobj_t code) {
+static void pyasm_generate_lnotab(struct pyasm_job *job) {
     // take the number of first line
-    int first_line = code->py._code.binary.trailer.firstlineno;
+    int first_line = job->code->py._code.binary.trailer.firstlineno;
     if (first_line == 0) first_line = 1;
 
+    job->lnotab_size = -1;
     lnotab_t *table = create_lnotab(first_line);
-    if (!table) return -1;
+    if (!table) return;
 
     int current_offset = 0;
-    int current_line = first_line;
-
-    list_t cursor = code->py._code.instructions;
-    while (!list_is_empty(cursor)) {
-        lexem_t lex = list_first(cursor);
-        const char *type = lexem_type(lex);
+    const insn_t *r = insn_data(job->records);
+    size_t count = insn_count(job->records);
 
+    for (size_t i = 0; i < count; i++) {
         // when we find a line we need to store the offset (byte) and that line number
-        if (strstr(type, "directive::line")) {
-            cursor = list_next(cursor); 
-            if (!list_is_empty(cursor)) {
-                lexem_t num_lex = list_first(cursor);
-                int new_line = atoi(lexem_value(num_lex));
-                
-                lnotab_append(table, new_line, current_offset);
-                current_line = new_line;
-            }
+        if (INSN_LINE == r[i].kind) {
+            lnotab_append(table, r[i].arg, current_offset);
         }
-        
         // we continue incrementing the counter
-        else if (strstr(type, "insn::0")) {
-            current_offset += 1;
-        }
-        else if (strstr(type, "insn::1")) {
-            current_offset += 3;
-            cursor = list_next(cursor); 
+        else if (INSN_OP == r[i].kind) {
+            current_offset += INSN_ARG_NONE == r[i].arg_kind ? 1 : 3;
         }
-
-        cursor = list_next(cursor);
     }
 
-    //we have a buffer with the lnotab i prefer to put it in the struct of pyobjstring
-    pyobj_t lnotab_obj = malloc(sizeof(struct pyobj));
-    lnotab_obj->refcount = 1;
-    lnotab_obj->type = PYOBJ_STRING;
-    
-    lnotab_obj->py._string.length = table->lnotab_size;
-    lnotab_obj->py._string.buffer = malloc(table->lnotab_size);
-    memcpy(lnotab_obj->py._string.buffer, table->buffer, table->lnotab_size);
-
-    //attach to our code
-    code->py._code.binary.trailer.lnotab = lnotab_obj;
+    job->lnotab = malloc(table->lnotab_size ? table->lnotab_size : 1);
+    assert(job->lnotab);
+    memcpy(job->lnotab, table->buffer, table->lnotab_size);
+    job->lnotab_size = table->lnotab_size;
 
     free_lnotab(table);
-    return 0;
 }
 
-////////////////////////////////////////////////////////////////
+// task: both passes and the lnotab of one code object
+static int pyasm_job_run(void *arg) {
+    struct pyasm_job *job = arg;
 
-int pyasm(pyobj_t code) {
-    label_t *labels = NULL;
+    int *labels = malloc((insn_label_count(job->records) + 1) * sizeof(*labels));
+    assert(labels);
+    for (size_t i = 0; i < insn_label_count(job->records); i++) labels[i] = -1;
 
     // first passage label marking and total size
-    // printf("[PYASM] -- Passe 1 : Analyse des labels --\n");
-    
-    int bytecode_size = pyasm_pass1(code, &labels);
-    
-    if (bytecode_size < 0) {
-        return -1; 
-    }
+    job->bytecode_size = pyasm_pass1(job->records, labels);
 
-    unsigned char *buffer = calloc(bytecode_size, sizeof(unsigned char));
-    if (!buffer && bytecode_size > 0) {
-        perror("Erreur allocation bytecode");
-        return -1;
-    }
-    // printf("[PYASM] -- Passe 2 : Géneration du Bytecode--\n");
     // second passage bytecode and jumps
-    pyasm_pass2(code, labels, buffer);
+    job->bytecode = calloc(job->bytecode_size ? job->bytecode_size : 1, 1);
+    assert(job->bytecode);
+    job->undefined = pyasm_pass2(job->records, labels, job->bytecode);
+    free(labels);
+    if (job->undefined) return -1;
 
-    //we create a pyobj string type and we allocate manually size (problem liked to 0x00 STOP_code)
+    pyasm_generate_lnotab(job);
+    return 0;
+}
 
-    pyobj_t bytecode_pystr = malloc(sizeof(struct pyobj));
-    if (!bytecode_pystr) return -1;
+// the code object and the ones in its consts, at any depth, parents
+// first and in the order of the consts (a depth-first walk, on a stack
+// of its own rather than the C stack)
+static void pyasm_collect(pyobj_t code, vector_t codes) {
+    vector_t pending = vector_new();
+    vector_append(pending, code);
+
+    while (!vector_is_empty(pending)) {
+        code = vector_pop(pending);
+        vector_append(codes, code);
+        size_t first = vector_length(pending);
+
+        // streamed consts only keep their code objects aside (see conststream.h)
+        conststream_t stream = conststream_of(code);
+        pyobj_t consts = code->py._code.binary.content.consts;
+        if (stream) {
+            for (size_t i = 0; i < conststream_code_count(stream); i++) {
+                vector_append(pending, conststream_code_at(stream, i));
+            }
+        } else if (consts) {
+            for (list_t l = consts->py._list; !list_is_empty(l); l = list_next(l)) {
+                pyobj_t item = list_first(l);
+                if (item && PYOBJ_CODE == item->type) vector_append(pending, item);
+            }
+        }
 
-    bytecode_pystr->refcount = 1;
-    bytecode_pystr->type = PYOBJ_STRING;
-    
-    bytecode_pystr->py._string.length = bytecode_size; 
-    bytecode_pystr->py._string.buffer = malloc(bytecode_size);
+        // reversed, so that the first one is popped first
+        void **children = vector_data(pending);
+        for (size_t i = first, j = vector_length(pending); i + 1 < j; i++, j--) {
+            void *child = children[i];
+            children[i] = children[j - 1];
+            children[j - 1] = child;
+        }
+    }
+    vector_delete(pending, NULL);
+}
 
-    memcpy(bytecode_pystr->py._string.buffer, buffer, bytecode_size);
+#define OP_LOAD_CONST 0x64
 
-    
-    //we write the bytecode
-    code->py._code.binary.content.bytecode = bytecode_pystr;
+// the first LOAD_CONST whose operand is not in .consts, NULL if none
+static const insn_t *pyasm_check_consts(pyobj_t code, insn_list_t records) {
+    conststream_t stream = conststream_of(code);
+    pyobj_t consts = code->py._code.binary.content.consts;
+    size_t length = stream ? conststream_count(stream) : consts ? list_length(consts->py._list) : 0;
 
-    //generate the lnotab 
-    if (pyasm_generate_lnotab(code) < 0) {
-        fprintf(stderr, "[PYASM] Attention: Echec generation lnotab (non fatal)\n");
-        
+    const insn_t *r = insn_data(records);
+    size_t count = insn_count(records);
+    for (size_t i = 0; i < count; i++) {
+        if (INSN_OP == r[i].kind && OP_LOAD_CONST == r[i].opcode && INSN_ARG_VALUE == r[i].arg_kind &&
+            (r[i].arg < 0 || (size_t)r[i].arg >= length)) return &r[i];
     }
+    return NULL;
+}
 
+////////////////////////////////////////////////////////////////
 
-    free(buffer);
-    label_free(labels);
+// below that many instructions in all, the code objects are assembled
+// one after the other: handing them to the workers would take longer
+#define PYASM_PARALLEL_MIN 4096
+
+// The workers are started the first time they are needed and kept for
+// the next calls (a file per call for the applications): starting and
+// joining them each time would cost more than small files take to
+// assemble. Their tasks belong to the group of each call, so calls from
+// several threads share them.
+static threadpool_t   pyasm_workers = NULL;
+static pthread_once_t pyasm_workers_once = PTHREAD_ONCE_INIT;
+
+static void pyasm_pool_at_exit(void) {
+    threadpool_delete(pyasm_workers);
+    pyasm_workers = NULL;
+}
+
+static void pyasm_pool_init(void) {
+    pyasm_workers = threadpool_new(0, 0);
+    atexit(pyasm_pool_at_exit);
+}
+
+static threadpool_t pyasm_pool(void) {
+    pthread_once(&pyasm_workers_once, pyasm_pool_init);
+    return pyasm_workers;
+}
+
+int pyasm(pyobj_t code) {
+    vector_t codes = vector_new();
+    pyasm_collect(code, codes);
+    size_t count = vector_length(codes);
+
+    // records made by the parser, or read from the lexems
+    struct pyasm_job *jobs = calloc(count, sizeof(*jobs));
+    assert(jobs);
+    size_t instructions = 0;
+    int status = 0;
+    int merge = constpool_enabled();
+    for (size_t i = 0; i < count; i++) {
+        jobs[i].code = vector_get_at(codes, i);
+        jobs[i].records = insn_detach(jobs[i].code);
+        if (!jobs[i].records) jobs[i].records = insn_lower(jobs[i].code->py._code.instructions);
+        if (!jobs[i].records) {
+            status = -1;
+            continue;
+        }
+        instructions += insn_count(jobs[i].records);
+        const insn_t *bad = pyasm_check_consts(jobs[i].code, jobs[i].records);
+        if (bad) {
+            fprintf(stderr, "Erreur: LOAD_CONST %d hors de .consts (utilisé ligne %d)\n", bad->arg, bad->line);
+            status = -1;
+            continue;
+        }
+        // before any operand is encoded (see constpool.h)
+        if (merge) constpool_merge(jobs[i].code, jobs[i].records, merge);
+    }
+    vector_delete(codes, NULL);
+
+    // the code objects do not depend on each other
+    if (0 == status && count > 1 && instructions >= PYASM_PARALLEL_MIN) {
+        taskgroup_t group = taskgroup_new(pyasm_pool());
+        for (size_t i = 0; i < count; i++) taskgroup_spawn(group, pyasm_job_run, &jobs[i]);
+        taskgroup_wait(group);
+        taskgroup_delete(group);
+    } else if (0 == status) {
+        for (size_t i = 0; i < count; i++) {
+            if (pyasm_job_run(&jobs[i]) < 0) break;
+        }
+    }
+
+    // in order, like a serial assembly would have stopped
+    for (size_t i = 0; i < count && 0 == status; i++) {
+        struct pyasm_job *job = &jobs[i];
+
+        if (job->undefined) {
+            fprintf(stderr, "Erreur: Label indéfini '%s' (utilisé ligne %d)\n", 
+                    insn_label_name(job->records, job->undefined->arg), job->undefined->line);
+            status = -1;
+            break;
+        }
+
+        //we write the bytecode (given its length: it holds 0x00, STOP_CODE),
+        //in a buffer of its own, not interned
+        job->code->py._code.binary.content.bytecode = pyobj_string_new_n((const char *)job->bytecode, job->bytecode_size, 0);
+
+        //generate the lnotab 
+        if (job->lnotab_size < 0) {
+            fprintf(stderr, "[PYASM] Attention: Echec generation lnotab (non fatal)\n");
+        } else {
+            job->code->py._code.binary.trailer.lnotab = pyobj_string_new_n((const char *)job->lnotab, job->lnotab_size, 0);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        free(jobs[i].bytecode);
+        free(jobs[i].lnotab);
+        insn_list_delete(jobs[i].records);
+    }
+    free(jobs);
+    if (status < 0) return -1;
     
     printf("[PYASM] Assemblage termine avec succes.\n");
     return 0;
-}
\ No newline at end of file
+}
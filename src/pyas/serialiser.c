@@ -11,8 +11,10 @@
 #include <assert.h>
 
 #include <parser/pyobj.h>
+#include <parser/conststream.h>
 #include <lexer/lexem.h> 
 #include <generic/list.h> 
+#include <generic/vector.h>
 
 
 
@@ -37,6 +39,17 @@ static int write_int64(FILE *fp, int64_t val) {
     return 0;
 }
 
+// binary float ('g'): the 8 bytes of the double, little endian like the
+// other numbers, in a single write
+static int write_float(FILE *fp, double val) {
+    uint64_t bits;
+    unsigned char bytes[8];
+    memcpy(&bits, &val, sizeof(bits));
+    for (int i = 0; i < 8; i++) bytes[i] = (unsigned char)(bits >> (8 * i));
+    if (fwrite(bytes, 1, sizeof(bytes), fp) != sizeof(bytes)) return -1;
+    return 0;
+}
+
 static int write_bytes_string(FILE *fp, char *str, int size) {
     if (write_int32(fp, size) < 0) return -1;
     if (size > 0 && str != NULL) {
@@ -95,9 +108,16 @@ static int write_as_tuple(FILE *fp, pyobj_t obj) {
 }
 
 
+// .consts of a code object, already marshal bytes if it was streamed
+// (see conststream.h)
+static int write_consts(FILE *fp, pyobj_t code) {
+    conststream_t stream = conststream_of(code);
+    if (stream) return conststream_write(stream, fp, pyobj_write);
+    return write_as_tuple(fp, code->py._code.binary.content.consts);
+}
 
-int pyobj_write(FILE *fp, pyobj_t obj) {
-    if (!fp) return -1;
+// anything but a list or tuple (see pyobj_write())
+static int write_object(FILE *fp, pyobj_t obj) {
     if (!obj) return write_byte(fp, 'N');
 
     switch (obj->type) {
@@ -117,30 +137,12 @@ int pyobj_write(FILE *fp, pyobj_t obj) {
 
         case PYOBJ_FLOAT:
             if (write_byte(fp, 'g') < 0) return -1;
-            if (fwrite(&(obj->py._float), sizeof(double), 1, fp) != 1) return -1;
-            break;
+            return write_float(fp, obj->py._float);
 
         case PYOBJ_STRING:
             if (write_byte(fp, 's') < 0) return -1;
             return write_bytes_string(fp, obj->py._string.buffer, obj->py._string.length);
 
-        case PYOBJ_LIST:
-        case PYOBJ_TUPLE: {
-            char marker = (obj->type == PYOBJ_LIST) ? '[' : '(';
-            if (write_byte(fp, marker) < 0) return -1;
-            
-            list_t l = obj->py._list;
-            int size = list_length(l);
-            if (write_int32(fp, size) < 0) return -1;
-
-            list_t cursor = l;
-            while ( !list_is_empty(cursor) ) {
-                if (pyobj_write(fp, list_first(cursor)) < 0) return -1;
-                cursor = list_next(cursor);
-            }
-            break;
-        }
-
         case PYOBJ_CODE:
             if (write_byte(fp, 'c') < 0) return -1;
 
@@ -155,7 +157,7 @@ int pyobj_write(FILE *fp, pyobj_t obj) {
             if (write_string_or_empty(fp, obj->py._code.binary.content.bytecode) < 0) return -1;
             
             // Tables -> Tuples
-            if (write_as_tuple(fp, obj->py._code.binary.content.consts) < 0) return -1;
+            if (write_consts(fp, obj) < 0) return -1;
             if (write_as_tuple(fp, obj->py._code.binary.content.names) < 0) return -1;
             if (write_as_tuple(fp, obj->py._code.binary.content.varnames) < 0) return -1;
             if (write_as_tuple(fp, obj->py._code.binary.content.freevars) < 0) return -1;
@@ -176,4 +178,43 @@ int pyobj_write(FILE *fp, pyobj_t obj) {
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+
+// Lists and tuples are written as deep as they nest: the rest of each
+// one being written is kept on a stack of its own, not on the C stack
+int pyobj_write(FILE *fp, pyobj_t obj) {
+    if (!fp) return -1;
+
+    vector_t open = NULL;
+    int status = 0;
+    for (;;) {
+        if (obj && (obj->type == PYOBJ_LIST || obj->type == PYOBJ_TUPLE)) {
+            char marker = (obj->type == PYOBJ_LIST) ? '[' : '(';
+            if (write_byte(fp, marker) < 0 ||
+                write_int32(fp, list_length(obj->py._list)) < 0) {
+                status = -1;
+                break;
+            }
+            if (!open) open = vector_new();
+            vector_append(open, obj->py._list);
+        } else if (write_object(fp, obj) < 0) {
+            status = -1;
+            break;
+        }
+
+        // next item of the innermost collection not done yet
+        int more = 0;
+        while (!more && open && !vector_is_empty(open)) {
+            list_t rest = vector_pop(open);
+            if (list_is_empty(rest)) continue;
+            obj = list_first(rest);
+            vector_append(open, list_next(rest));
+            more = 1;
+        }
+        if (!more) break;
+    }
+
+    vector_delete(open, NULL);
+    return status;
+}
@@ -9,11 +9,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <generic/arena.h>
 #include <regexp/chargroup.h>
 
 
 chargroup_t chargroup_new() {
-    chargroup_t cg = malloc(sizeof(struct chargroup));
+    chargroup_t cg = unit_malloc(sizeof(struct chargroup));
     if (cg == NULL)
         return NULL;
 
@@ -35,7 +36,7 @@ void chargroup_delete(chargroup_t cg) {
     if (cg == NULL)
         return;
 
-    free(cg);
+    unit_free(cg);
 }
 //T3.2 On ajoute une fontion dÃ©diÃ©e seulement Ã  l'affichage des Ã©lÃ©ments echappÃ©s
 
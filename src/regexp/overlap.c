@@ -0,0 +1,223 @@
+/**
+ * @file overlap.c
+ * @author Abdellah
+ * @brief Regexp overlap analysis
+ *
+ * Each regexp is turned into a small NFA whose states are the positions
+ * in its chargroup list, then both NFAs are run side by side on every
+ * possible character (product automaton) until one of them accepts
+ * while the other one is still alive. re_goes_on() runs one of them
+ * alone on a given text.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <generic/list.h>
+#include <regexp/regexp.h>
+#include <regexp/chargroup.h>
+#include <regexp/overlap.h>
+
+// state sets are bitsets, so a regexp may have at most 63 positions
+#define NFA_MAX_STATES 63
+
+// re_match() stops on '\0'. Chargroups only hold chars 1..127, but a
+// negated one stands for every other byte, those past 127 included
+#define NFA_FIRST_CHAR 1
+#define NFA_LAST_CHAR  255
+
+typedef uint64_t stateset_t;
+
+struct nfa {
+    int         size;                     // number of positions, state `size` accepts
+    chargroup_t groups[NFA_MAX_STATES];
+    int         loops[NFA_MAX_STATES];    // 1 if position i may repeat ('*')
+    int         optional[NFA_MAX_STATES]; // 1 if position i may be skipped ('*' or '?')
+    stateset_t  live;                     // states from which acceptance is reachable
+};
+
+// whether c is in the group: bytes past 127 only are in negated groups
+// (re_match() turns them down for now, counting them is only cautious)
+static int nfa_has_char(chargroup_t cg, int c) {
+    if (c > 127) return chargroup_is_negated(cg);
+    return chargroup_has_char(cg, (char)c);
+}
+
+// a '+' is expanded into the chargroup followed by the same chargroup with a '*'
+static int nfa_build(struct nfa *nfa, list_t regexp) {
+    nfa->size = 0;
+
+    for (list_t l = regexp; !list_is_empty(l); l = list_next(l)) {
+        chargroup_t cg = list_first(l);
+        int plus = chargroup_has_operator_plus(cg);
+        int star = chargroup_has_operator_star(cg);
+
+        if (nfa->size + 1 + plus > NFA_MAX_STATES) return -1;
+
+        nfa->groups[nfa->size] = cg;
+        nfa->loops[nfa->size] = star;
+        nfa->optional[nfa->size] = star || chargroup_has_operator_qmark(cg);
+        nfa->size++;
+
+        if (plus) {
+            nfa->groups[nfa->size] = cg;
+            nfa->loops[nfa->size] = 1;
+            nfa->optional[nfa->size] = 1;
+            nfa->size++;
+        }
+    }
+
+    // acceptance is reachable if every mandatory position left can match something
+    nfa->live = (stateset_t)1 << nfa->size;
+    for (int i = nfa->size - 1; i >= 0; i--) {
+        int can_match = 0;
+        for (int c = NFA_FIRST_CHAR; c <= NFA_LAST_CHAR && !can_match; c++) {
+            can_match = nfa_has_char(nfa->groups[i], c);
+        }
+
+        int next_live = (nfa->live >> (i + 1)) & 1;
+        if ((nfa->optional[i] && next_live) || (can_match && next_live)) {
+            nfa->live |= (stateset_t)1 << i;
+        }
+    }
+    return 0;
+}
+
+static stateset_t nfa_closure(struct nfa *nfa, stateset_t set) {
+    // optional positions can be skipped, and skipping only goes forward
+    for (int i = 0; i < nfa->size; i++) {
+        if (((set >> i) & 1) && nfa->optional[i]) set |= (stateset_t)1 << (i + 1);
+    }
+    return set & nfa->live;
+}
+
+static stateset_t nfa_step(struct nfa *nfa, stateset_t set, int c) {
+    stateset_t next = 0;
+
+    for (int i = 0; i < nfa->size; i++) {
+        if (((set >> i) & 1) && nfa_has_char(nfa->groups[i], c)) {
+            next |= (stateset_t)1 << (nfa->loops[i] ? i : i + 1);
+        }
+    }
+    return nfa_closure(nfa, next);
+}
+
+static int nfa_accepts(struct nfa *nfa, stateset_t set) {
+    return (set >> nfa->size) & 1;
+}
+
+struct stateset_pair {
+    stateset_t a;
+    stateset_t b;
+};
+
+static int product_overlap(struct nfa *a, struct nfa *b) {
+    size_t capacity = 64;
+    size_t count = 0;
+    size_t next = 0;
+    struct stateset_pair *seen = malloc(capacity * sizeof(*seen));
+    if (!seen) return -1;
+
+    seen[count].a = nfa_closure(a, 1);
+    seen[count].b = nfa_closure(b, 1);
+    count++;
+
+    // breadth-first over the reachable pairs, `seen` doubles as the work queue
+    while (next < count) {
+        struct stateset_pair pair = seen[next++];
+
+        for (int c = NFA_FIRST_CHAR; c <= NFA_LAST_CHAR; c++) {
+            stateset_t sa = nfa_step(a, pair.a, c);
+            stateset_t sb = nfa_step(b, pair.b, c);
+
+            if (!sa || !sb) continue;
+
+            // one regexp matched a non-empty text the other one can extend
+            if (nfa_accepts(a, sa) || nfa_accepts(b, sb)) {
+                free(seen);
+                return 1;
+            }
+
+            size_t i;
+            for (i = 0; i < count; i++) {
+                if (seen[i].a == sa && seen[i].b == sb) break;
+            }
+            if (i < count) continue;
+
+            if (count == capacity) {
+                capacity *= 2;
+                struct stateset_pair *grown = realloc(seen, capacity * sizeof(*seen));
+                if (!grown) {
+                    free(seen);
+                    return -1;
+                }
+                seen = grown;
+            }
+            seen[count].a = sa;
+            seen[count].b = sb;
+            count++;
+        }
+    }
+
+    free(seen);
+    return 0;
+}
+
+int re_overlap(char *regexp1, char *regexp2) {
+    list_t r1 = re_read(regexp1);
+    list_t r2 = re_read(regexp2);
+    struct nfa a, b;
+    int res = -1;
+
+    if (r1 && r2 && 0 == nfa_build(&a, r1) && 0 == nfa_build(&b, r2)) {
+        res = product_overlap(&a, &b);
+    }
+
+    list_delete(r1, chargroup_delete_cb);
+    list_delete(r2, chargroup_delete_cb);
+    return res;
+}
+
+int re_first_bytes(char *regexp, char first[256]) {
+    list_t r = re_read(regexp);
+    struct nfa a;
+
+    memset(first, 0, 256);
+    if (!r) return 0;
+
+    if (0 != nfa_build(&a, r)) {
+        memset(first + 1, 1, 255);
+        list_delete(r, chargroup_delete_cb);
+        return -1;
+    }
+
+    stateset_t start = nfa_closure(&a, 1);
+    for (int c = NFA_FIRST_CHAR; c <= NFA_LAST_CHAR; c++) {
+        first[c] = 0 != nfa_step(&a, start, c);
+    }
+
+    list_delete(r, chargroup_delete_cb);
+    return 0;
+}
+
+int re_goes_on(char *regexp, char *text, char *limit) {
+    list_t r = re_read(regexp);
+    struct nfa a;
+    int res = -1;
+
+    // re_match() never matches a regexp it cannot read
+    if (!r) return 0;
+
+    if (0 == nfa_build(&a, r)) {
+        stateset_t set = nfa_closure(&a, 1);
+
+        for (char *p = text; p < limit && set; p++) {
+            set = '\0' == *p ? 0 : nfa_step(&a, set, (unsigned char)*p);
+        }
+        res = 0 != set;
+    }
+
+    list_delete(r, chargroup_delete_cb);
+    return res;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file 0b-queue.c
+ * @author Abdellah
+ * @brief Tests of queues.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <unitest/unitest.h>
+#include <generic/list.h>
+#include <generic/queue.h>
+
+static double now( void ) {
+  struct timespec t;
+
+  clock_gettime( CLOCK_MONOTONIC, &t );
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+#define ITEM( i ) ( (void*)(intptr_t)( ( i ) + 1 ) )
+
+/* 1, 2, ... n in order? */
+static int in_order( list_t l, size_t n ) {
+  size_t i;
+
+  for ( i = 0 ; i < n ; i++, l = list_next( l ) ) {
+    if ( list_is_empty( l ) || ITEM( i ) != list_first( l ) ) return 0;
+  }
+
+  return list_is_empty( l );
+}
+
+static void queue_basic( void ) {
+  queue_t q = queue_new();
+  list_t  l;
+  size_t  i;
+
+  test_suite( "Queues: enqueue and queue_to_list" );
+
+  test_assert( queue_empty( q ), "A new queue is empty" );
+  test_assert( list_is_empty( queue_to_list( q ) ), "An empty queue gives an empty list" );
+
+  q = enqueue( q, ITEM( 0 ) );
+  test_assert( !queue_empty( q ), "A queue with one object is not empty" );
+  l = queue_to_list( q );
+  test_assert( in_order( l, 1 ), "One object: a list of one object" );
+  list_delete( l, NULL );
+
+  q = queue_new();
+  for ( i = 0 ; i < 10 ; i++ ) q = enqueue( q, ITEM( i ) );
+  l = queue_to_list( q );
+  test_assert( 10 == list_length( l ), "Ten objects: a list of ten objects" );
+  test_assert( in_order( l, 10 ), "The list is in the order of enqueueing" );
+  list_delete( l, NULL );
+}
+
+/* seconds to enqueue n objects and turn them into a list, which is checked */
+static double build( size_t n, int *ok ) {
+  double  start = now();
+  queue_t q     = queue_new();
+  list_t  l;
+  size_t  i;
+
+  for ( i = 0 ; i < n ; i++ ) q = enqueue( q, ITEM( i ) );
+  l     = queue_to_list( q );
+  start = now() - start;
+
+  *ok = in_order( l, n );
+  list_delete( l, NULL );
+
+  return start;
+}
+
+/* make check runs the tests under valgrind (see CHECK_MEM in the
+   Makefile): times mean nothing there, one 10^6 build is enough */
+static int memory_checked( void ) {
+  char *check = getenv( "CHECK_MEM" );
+
+  return check && *check;
+}
+
+static void queue_scaling( void ) {
+  double small = 1e9, large = 1e9;
+  int    ok_small, ok_large, i;
+
+  test_suite( "Queues: 10^6 objects in linear time" );
+
+  if ( memory_checked() ) {
+    build( 1000000, &ok_large );
+    test_assert( ok_large, "10^6 objects: the list is in order" );
+    return;
+  }
+
+  /* the best of a few runs, against noise (and the first run of each
+     size getting its links from the system) */
+  for ( i = 0 ; i < 3 ; i++ ) {
+    double t = build( 100000, &ok_small );
+
+    if ( t < small ) small = t;
+  }
+  for ( i = 0 ; i < 3 ; i++ ) {
+    double t = build( 1000000, &ok_large );
+
+    if ( t < large ) large = t;
+  }
+
+  test_assert( ok_small, "10^5 objects: the list is in order" );
+  test_assert( ok_large, "10^6 objects: the list is in order" );
+  /* 10 times the objects: about 10 times the time, 100 if it were quadratic */
+  test_assert( large < 30 * small + 0.01, "10 times the objects take less than 30 times longer (%.4fs vs %.4fs)", large, small );
+}
+
+int main( int argc, char *argv[] ) {
+
+  unit_test( argc, argv );
+
+  queue_basic();
+  queue_scaling();
+
+  exit( EXIT_SUCCESS );
+}
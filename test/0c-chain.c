@@ -0,0 +1,156 @@
+/**
+ * @file 0c-chain.c
+ * @author Abdellah
+ * @brief Tests of chains.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <unitest/unitest.h>
+#include <generic/list.h>
+#include <generic/chain.h>
+
+static double now( void ) {
+  struct timespec t;
+
+  clock_gettime( CLOCK_MONOTONIC, &t );
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+#define ITEM( i ) ( (void*)(intptr_t)( ( i ) + 1 ) )
+
+/* 1, 2, ... n in order? */
+static int in_order( list_t l, size_t n ) {
+  size_t i;
+
+  for ( i = 0 ; i < n ; i++, l = list_next( l ) ) {
+    if ( list_is_empty( l ) || ITEM( i ) != list_first( l ) ) return 0;
+  }
+
+  return list_is_empty( l );
+}
+
+static void chain_basic( void ) {
+  chain_t c = chain_new();
+  list_t  l;
+  size_t  i;
+
+  test_suite( "Chains: both ends, length, lists" );
+
+  test_assert( chain_is_empty( c ), "A new chain is empty" );
+  test_assert( 0 == chain_length( c ), "A new chain has length 0" );
+  test_assert( list_is_empty( chain_list( c ) ), "An empty chain gives an empty list" );
+
+  chain_add_last( c, ITEM( 1 ) );
+  chain_add_first( c, ITEM( 0 ) );
+  chain_add_last( c, ITEM( 2 ) );
+  test_assert( 3 == chain_length( c ), "Three objects: length 3" );
+  test_assert( ITEM( 0 ) == chain_first( c ), "chain_add_first() adds the first object" );
+  test_assert( ITEM( 2 ) == chain_last( c ), "chain_add_last() adds the last object" );
+  test_assert( in_order( chain_list( c ), 3 ), "chain_list() walks the objects in order" );
+  chain_delete( c, NULL );
+
+  /* the last link of a chain added to by its front only */
+  c = chain_new();
+  chain_add_first( c, ITEM( 0 ) );
+  test_assert( ITEM( 0 ) == chain_last( c ), "The first object added first is also the last one" );
+  chain_add_last( c, ITEM( 1 ) );
+  test_assert( in_order( chain_list( c ), 2 ), "Then adding at the end keeps the order" );
+  chain_delete( c, NULL );
+
+  l = list_new();
+  for ( i = 10 ; i > 0 ; i-- ) l = list_add_first( ITEM( i - 1 ), l );
+  c = chain_from_list( l );
+  test_assert( 10 == chain_length( c ), "chain_from_list() counts the links" );
+  test_assert( ITEM( 9 ) == chain_last( c ), "chain_from_list() finds the last link" );
+  chain_add_last( c, ITEM( 10 ) );
+  l = chain_to_list( c );
+  test_assert( 11 == list_length( l ), "chain_to_list() gives all the links" );
+  test_assert( in_order( l, 11 ), "chain_to_list() keeps the order" );
+  list_delete( l, NULL );
+
+  /* links moved out of a list: 0 1 2 3 4 gives 0 3 4 and 1 2 */
+  l = list_new();
+  for ( i = 5 ; i > 0 ; i-- ) l = list_add_first( ITEM( i - 1 ), l );
+  c = chain_new();
+  chain_move_next( c, l );
+  chain_move_next( c, l );
+  test_assert( 2 == chain_length( c ) && ITEM( 1 ) == chain_first( c ) && ITEM( 2 ) == chain_last( c ), "chain_move_next() moves the links in order" );
+  test_assert( 3 == list_length( l ) && ITEM( 3 ) == list_first( list_next( l ) ), "They are gone from their list" );
+  chain_delete( c, NULL );
+  list_delete( l, NULL );
+}
+
+/* seconds to add n objects at the end and turn them into a list, which
+   is checked */
+static double build( size_t n, int *length_ok, int *last_ok, int *order_ok ) {
+  double  start = now();
+  chain_t c     = chain_new();
+  list_t  l;
+  size_t  i;
+
+  for ( i = 0 ; i < n ; i++ ) chain_add_last( c, ITEM( i ) );
+  *length_ok = n == chain_length( c );
+  *last_ok   = ITEM( n - 1 ) == chain_last( c );
+  l          = chain_to_list( c );
+  start      = now() - start;
+
+  *order_ok = in_order( l, n );
+  list_delete( l, NULL );
+
+  return start;
+}
+
+/* under valgrind (CHECK_MEM, exported by the Makefile), a single 10^6
+   build and no timing */
+static int memory_checked( void ) {
+  char *check = getenv( "CHECK_MEM" );
+
+  return check && *check;
+}
+
+static void chain_scaling( void ) {
+  double small = 1e9, large = 1e9;
+  int    length_ok, last_ok, order_ok, i;
+
+  test_suite( "Chains: 10^6 objects in linear time" );
+
+  if ( memory_checked() ) {
+    build( 1000000, &length_ok, &last_ok, &order_ok );
+    test_assert( length_ok && last_ok && order_ok, "10^6 objects: length, last object and order" );
+    return;
+  }
+
+  /* the best of a few runs, against noise (and the first run of each
+     size getting its links from the system) */
+  for ( i = 0 ; i < 3 ; i++ ) {
+    double t = build( 100000, &length_ok, &last_ok, &order_ok );
+
+    if ( t < small ) small = t;
+  }
+  test_assert( length_ok && last_ok && order_ok, "10^5 objects: length, last object and order" );
+
+  for ( i = 0 ; i < 3 ; i++ ) {
+    double t = build( 1000000, &length_ok, &last_ok, &order_ok );
+
+    if ( t < large ) large = t;
+  }
+  test_assert( length_ok, "10^6 objects: length 10^6" );
+  test_assert( last_ok, "10^6 objects: the last object is the last one added" );
+  test_assert( order_ok, "10^6 objects: chain_to_list() gives them in order" );
+
+  /* 10 times the objects: about 10 times the time, 100 if it were quadratic */
+  test_assert( large < 30 * small + 0.01, "10 times the objects take less than 30 times longer (%.4fs vs %.4fs)", large, small );
+}
+
+int main( int argc, char *argv[] ) {
+
+  unit_test( argc, argv );
+
+  chain_basic();
+  chain_scaling();
+
+  exit( EXIT_SUCCESS );
+}
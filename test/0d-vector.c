@@ -0,0 +1,137 @@
+/**
+ * @file 0d-vector.c
+ * @author Abdellah
+ * @brief Tests of vectors.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <unitest/unitest.h>
+#include <generic/list.h>
+#include <generic/vector.h>
+
+#define ITEM( i ) ( (void*)(intptr_t)( ( i ) + 1 ) )
+
+/* counts its calls, and how many objects were deleted out of order */
+static size_t deleted, deleted_wrong;
+
+static int delete_item( void *object ) {
+  if ( ITEM( deleted ) != object ) deleted_wrong++;
+  deleted++;
+  return 0;
+}
+
+static size_t visited;
+
+static int visit_until_5( void *object ) {
+  visited++;
+  return ITEM( 5 ) == object ? 42 : 0;
+}
+
+static void vector_access( void ) {
+  vector_t v = vector_new();
+  size_t   i;
+  int      ok;
+
+  test_suite( "Vectors: append, get, set, pop" );
+
+  test_assert( vector_is_empty( v ), "A new vector is empty" );
+  test_assert( 0 == vector_length( v ) && 0 == vector_capacity( v ), "A new vector has no room yet" );
+
+  for ( i = 0 ; i < 1000 ; i++ ) vector_append( v, ITEM( i ) );
+  test_assert( 1000 == vector_length( v ), "1000 objects appended: length 1000" );
+  test_assert( vector_capacity( v ) >= 1000 && vector_capacity( v ) < 2000, "The capacity doubles: less than twice the length" );
+
+  for ( ok = 1, i = 0 ; i < 1000 ; i++ ) ok = ok && ITEM( i ) == vector_get_at( v, i );
+  test_assert( ok, "vector_get_at() gets each object at its index" );
+  for ( ok = 1, i = 0 ; i < 1000 ; i++ ) ok = ok && ITEM( i ) == vector_data( v )[ i ];
+  test_assert( ok, "vector_data() holds the objects in order" );
+  test_assert( ITEM( 999 ) == vector_last( v ), "vector_last() gets the last object" );
+
+  vector_set_at( v, 10, ITEM( 2000 ) );
+  test_assert( ITEM( 2000 ) == vector_get_at( v, 10 ), "vector_set_at() replaces an object" );
+  vector_set_at( v, 10, ITEM( 10 ) );
+
+  test_assert( ITEM( 999 ) == vector_pop( v ), "vector_pop() returns the last object" );
+  test_assert( 999 == vector_length( v ) && ITEM( 998 ) == vector_last( v ), "vector_pop() removes it" );
+
+  visited = 0;
+  test_assert( 42 == vector_foreach( v, visit_until_5 ), "vector_foreach() returns the first non-zero value" );
+  test_assert( 6 == visited, "vector_foreach() stops there" );
+
+  vector_delete( v, NULL );
+}
+
+static void vector_room( void ) {
+  vector_t v = vector_new();
+  size_t   i, capacity;
+
+  test_suite( "Vectors: reserve, shrink, clear, delete" );
+
+  vector_reserve( v, 100 );
+  test_assert( 100 <= vector_capacity( v ) && vector_is_empty( v ), "vector_reserve() makes room, adds no object" );
+  for ( i = 0 ; i < 100 ; i++ ) vector_append( v, ITEM( i ) );
+  capacity = vector_capacity( v );
+  vector_reserve( v, 10 );
+  test_assert( capacity == vector_capacity( v ), "vector_reserve() never takes room away" );
+
+  vector_pop( v );
+  vector_shrink( v );
+  test_assert( 99 == vector_capacity( v ), "vector_shrink() leaves room for the objects only" );
+  test_assert( ITEM( 98 ) == vector_last( v ), "vector_shrink() keeps the objects" );
+  vector_append( v, ITEM( 99 ) );
+  test_assert( 100 == vector_length( v ) && ITEM( 99 ) == vector_last( v ), "A shrunk vector still grows" );
+
+  deleted = deleted_wrong = 0;
+  vector_clear( v, delete_item );
+  test_assert( 100 == deleted && 0 == deleted_wrong, "vector_clear() deletes every object, in order" );
+  test_assert( vector_is_empty( v ) && vector_capacity( v ) >= 100, "vector_clear() keeps the capacity" );
+
+  vector_shrink( v );
+  test_assert( 0 == vector_capacity( v ), "An empty vector shrinks to no room" );
+
+  for ( i = 0 ; i < 10 ; i++ ) vector_append( v, ITEM( i ) );
+  deleted = deleted_wrong = 0;
+  vector_delete( v, delete_item );
+  test_assert( 10 == deleted && 0 == deleted_wrong, "vector_delete() deletes every object, in order" );
+
+  deleted = 0;
+  vector_delete( vector_new(), delete_item );
+  vector_delete( NULL, delete_item );
+  test_assert( 0 == deleted, "Deleting an empty or NULL vector calls no callback" );
+}
+
+static void vector_lists( void ) {
+  list_t   l = list_new(), k;
+  vector_t v;
+  size_t   i;
+  int      ok;
+
+  test_suite( "Vectors: from and to lists" );
+
+  for ( i = 10 ; i > 0 ; i-- ) l = list_add_first( ITEM( i - 1 ), l );
+  v = vector_from_list( l );
+  test_assert( 10 == vector_length( v ) && 10 == list_length( l ), "vector_from_list() copies the list, left untouched" );
+  for ( ok = 1, i = 0 ; i < 10 ; i++ ) ok = ok && ITEM( i ) == vector_get_at( v, i );
+  test_assert( ok, "vector_from_list() keeps the order" );
+  list_delete( l, NULL );
+
+  l = vector_to_list( v );
+  for ( ok = 1, i = 0, k = l ; i < 10 ; i++, k = list_next( k ) ) ok = ok && ITEM( i ) == list_first( k );
+  test_assert( ok && list_is_empty( k ), "vector_to_list() keeps the order" );
+  test_assert( 10 == vector_length( v ), "vector_to_list() leaves the vector untouched" );
+  list_delete( l, NULL );
+  vector_delete( v, NULL );
+}
+
+int main( int argc, char *argv[] ) {
+
+  unit_test( argc, argv );
+
+  vector_access();
+  vector_room();
+  vector_lists();
+
+  exit( EXIT_SUCCESS );
+}
@@ -0,0 +1,260 @@
+/**
+ * @file 0e-ring.c
+ * @author Abdellah
+ * @brief Tests of ring buffers and concurrent queues.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <unitest/unitest.h>
+#include <generic/ring.h>
+#include <generic/mpmc.h>
+
+#define ITEM( i ) ( (void*)(uintptr_t)( ( i ) + 1 ) )
+#define INDEX( o ) ( (size_t)(uintptr_t)( o ) - 1 )
+
+static void ring_basic( void ) {
+  ring_t r = ring_new( 5 );
+  void  *batch[ 8 ], *o;
+  size_t i, n;
+  int    ok;
+
+  test_suite( "Rings: one thread" );
+
+  test_assert( 8 == ring_capacity( r ), "The capacity is rounded up to a power of two" );
+  test_assert( ring_empty( r ), "A new ring is empty" );
+  test_assert( !ring_pop( r, &o ), "Popping from an empty ring fails" );
+
+  for ( i = 0 ; i < 8 ; i++ ) ring_push( r, ITEM( i ) );
+  test_assert( !ring_push( r, ITEM( 8 ) ), "Pushing to a full ring fails" );
+  for ( ok = 1, i = 0 ; i < 8 ; i++ ) ok = ok && ring_pop( r, &o ) && ITEM( i ) == o;
+  test_assert( ok && ring_empty( r ), "The objects are popped in order" );
+
+  for ( i = 0 ; i < 8 ; i++ ) batch[ i ] = ITEM( i );
+  n = ring_push_batch( r, batch, 3 );
+  n += ring_push_batch( r, batch + 3, 8 );
+  test_assert( 8 == n, "Batches are pushed as far as there is room" );
+  n = ring_pop_batch( r, batch, 5 );
+  test_assert( 5 == n && ITEM( 0 ) == batch[ 0 ] && ITEM( 4 ) == batch[ 4 ], "A batch pops the first objects" );
+  n = ring_pop_batch( r, batch, 8 );
+  test_assert( 3 == n && ITEM( 5 ) == batch[ 0 ] && ITEM( 7 ) == batch[ 2 ], "A batch pops at most what is there" );
+
+  /* around the end of the buffer */
+  for ( ok = 1, i = 0 ; i < 100 ; i++ ) {
+    ok = ok && ring_push( r, ITEM( i ) ) && ring_push( r, ITEM( i + 1 ) );
+    ok = ok && ring_pop( r, &o ) && ITEM( i ) == o && ring_pop( r, &o ) && ITEM( i + 1 ) == o;
+  }
+  test_assert( ok, "Pushing and popping around the end of the buffer" );
+
+  ring_push( r, ITEM( 0 ) );
+  ring_close( r );
+  test_assert( ring_closed( r ), "A closed ring is closed" );
+  test_assert( ring_pop( r, &o ) && ITEM( 0 ) == o, "What was pushed before closing is still popped" );
+
+  ring_delete( r, NULL );
+}
+
+/*
+  One producer, one consumer: every object arrives once and in order,
+  then the consumer stops once the ring is closed and empty.
+ */
+#define SPSC_OBJECTS 200000
+
+struct spsc {
+  ring_t r;
+  size_t popped;
+  int    in_order;
+};
+
+static void *spsc_producer( void *arg ) {
+  struct spsc *s = arg;
+  void        *batch[ 16 ];
+  size_t       i = 0, j;
+
+  while ( i < SPSC_OBJECTS ) {
+    /* single objects and batches, in turns */
+    if ( i % 1000 < 500 ) {
+      if ( ring_push( s->r, ITEM( i ) ) ) i++;
+      else sched_yield();
+      continue;
+    }
+    for ( j = 0 ; j < 16 && i + j < SPSC_OBJECTS ; j++ ) batch[ j ] = ITEM( i + j );
+    j = ring_push_batch( s->r, batch, j );
+    if ( !j ) sched_yield();
+    i += j;
+  }
+  ring_close( s->r );
+
+  return NULL;
+}
+
+static void *spsc_consumer( void *arg ) {
+  struct spsc *s = arg;
+  void        *batch[ 7 ];
+
+  for ( ;; ) {
+    /* read before popping: a pop failing after a close is final */
+    int    closed = ring_closed( s->r );
+    size_t n      = ring_pop_batch( s->r, batch, 7 ), j;
+
+    for ( j = 0 ; j < n ; j++, s->popped++ ) {
+      if ( INDEX( batch[ j ] ) != s->popped ) s->in_order = 0;
+    }
+    if ( n ) continue;
+    if ( closed ) break;
+    sched_yield();
+  }
+
+  return NULL;
+}
+
+static void ring_threads( void ) {
+  struct spsc s = { ring_new( 64 ), 0, 1 };
+  pthread_t   producer, consumer;
+
+  test_suite( "Rings: one producer, one consumer" );
+
+  pthread_create( &consumer, NULL, spsc_consumer, &s );
+  pthread_create( &producer, NULL, spsc_producer, &s );
+  pthread_join( producer, NULL );
+  pthread_join( consumer, NULL );
+
+  test_assert( SPSC_OBJECTS == s.popped, "Every object is popped once the ring is closed (%zu)", s.popped );
+  test_assert( s.in_order, "The objects are popped in the order they were pushed" );
+  test_assert( ring_empty( s.r ), "Nothing is left in the ring" );
+
+  ring_delete( s.r, NULL );
+}
+
+static void mpmc_basic( void ) {
+  mpmc_t q = mpmc_new( 3 );
+  void  *batch[ 4 ] = { ITEM( 0 ), ITEM( 1 ), ITEM( 2 ), ITEM( 3 ) }, *o;
+  int    ok;
+
+  test_suite( "Concurrent queues: one thread" );
+
+  test_assert( 4 == mpmc_capacity( q ), "The capacity is rounded up to a power of two" );
+  test_assert( !mpmc_pop( q, &o ), "Popping from an empty queue fails" );
+  test_assert( 4 == mpmc_push_batch( q, batch, 4 ), "A batch fills the queue" );
+  test_assert( !mpmc_push( q, ITEM( 4 ) ), "Pushing to a full queue fails" );
+  ok = mpmc_pop( q, &o ) && ITEM( 0 ) == o;
+  ok = ok && 3 == mpmc_pop_batch( q, batch, 4 ) && ITEM( 1 ) == batch[ 0 ] && ITEM( 3 ) == batch[ 2 ];
+  test_assert( ok, "The objects are popped in order" );
+
+  mpmc_push( q, ITEM( 0 ) );
+  mpmc_close( q );
+  test_assert( mpmc_closed( q ), "A closed queue is closed" );
+  test_assert( mpmc_pop( q, &o ) && ITEM( 0 ) == o, "What was pushed before closing is still popped" );
+
+  mpmc_delete( q, NULL );
+}
+
+/*
+  Several producers and consumers: every object arrives exactly once,
+  and a consumer gets the objects of a given producer in the order they
+  were pushed.
+ */
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define PER_PRODUCER 100000
+
+struct mpmc_run {
+  mpmc_t      q;
+  atomic_int  producing;
+  atomic_char seen[ PRODUCERS * PER_PRODUCER ];
+  atomic_int  out_of_order;
+};
+
+struct producer {
+  struct mpmc_run *run;
+  size_t           id;
+};
+
+static void *mpmc_producer( void *arg ) {
+  struct producer *p = arg;
+  size_t           i;
+
+  for ( i = 0 ; i < PER_PRODUCER ; i++ ) {
+    while ( !mpmc_push( p->run->q, ITEM( p->id * PER_PRODUCER + i ) ) ) sched_yield();
+  }
+  /* the last producer to end closes the queue */
+  if ( 1 == atomic_fetch_sub( &p->run->producing, 1 ) ) mpmc_close( p->run->q );
+
+  return NULL;
+}
+
+static void *mpmc_consumer( void *arg ) {
+  struct mpmc_run *run = arg;
+  size_t           last[ PRODUCERS ], i;
+  void            *batch[ 5 ];
+
+  for ( i = 0 ; i < PRODUCERS ; i++ ) last[ i ] = 0;
+
+  for ( ;; ) {
+    int    closed = mpmc_closed( run->q );
+    size_t n      = mpmc_pop_batch( run->q, batch, 5 );
+
+    for ( i = 0 ; i < n ; i++ ) {
+      size_t index    = INDEX( batch[ i ] );
+      size_t producer = index / PER_PRODUCER;
+
+      atomic_fetch_add( &run->seen[ index ], 1 );
+      /* last[] holds 1 + the last index seen from each producer */
+      if ( index + 1 <= last[ producer ] ) atomic_fetch_add( &run->out_of_order, 1 );
+      last[ producer ] = index + 1;
+    }
+    if ( n ) continue;
+    if ( closed ) break;
+    sched_yield();
+  }
+
+  return NULL;
+}
+
+static void mpmc_threads( void ) {
+  struct mpmc_run *run = calloc( 1, sizeof( *run ) );
+  struct producer  producers[ PRODUCERS ];
+  pthread_t        threads[ PRODUCERS + CONSUMERS ];
+  size_t           i, missing = 0, twice = 0;
+
+  test_suite( "Concurrent queues: several producers and consumers" );
+
+  run->q = mpmc_new( 256 );
+  atomic_init( &run->producing, PRODUCERS );
+  atomic_init( &run->out_of_order, 0 );
+
+  for ( i = 0 ; i < CONSUMERS ; i++ ) pthread_create( &threads[ PRODUCERS + i ], NULL, mpmc_consumer, run );
+  for ( i = 0 ; i < PRODUCERS ; i++ ) {
+    producers[ i ].run = run;
+    producers[ i ].id  = i;
+    pthread_create( &threads[ i ], NULL, mpmc_producer, &producers[ i ] );
+  }
+  for ( i = 0 ; i < PRODUCERS + CONSUMERS ; i++ ) pthread_join( threads[ i ], NULL );
+
+  for ( i = 0 ; i < PRODUCERS * PER_PRODUCER ; i++ ) {
+    if ( 0 == atomic_load( &run->seen[ i ] ) ) missing++;
+    if ( 1 < atomic_load( &run->seen[ i ] ) ) twice++;
+  }
+  test_assert( 0 == missing, "No object is lost (%zu missing)", missing );
+  test_assert( 0 == twice, "No object is popped twice (%zu twice)", twice );
+  test_assert( 0 == atomic_load( &run->out_of_order ), "Each consumer gets the objects of a producer in order" );
+
+  mpmc_delete( run->q, NULL );
+  free( run );
+}
+
+int main( int argc, char *argv[] ) {
+
+  unit_test( argc, argv );
+
+  ring_basic();
+  ring_threads();
+  mpmc_basic();
+  mpmc_threads();
+
+  exit( EXIT_SUCCESS );
+}
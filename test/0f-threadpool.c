@@ -0,0 +1,335 @@
+/**
+ * @file 0f-threadpool.c
+ * @author Abdellah
+ * @brief Tests of thread pools and task groups.
+ */
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <unitest/unitest.h>
+#include <generic/threadpool.h>
+
+static void sleep_ms( long ms ) {
+  struct timespec t = { ms / 1000, ( ms % 1000 ) * 1000000L };
+
+  nanosleep( &t, NULL );
+}
+
+static atomic_int ended;
+
+static int fast_task( void *arg ) {
+  (void)arg;
+  atomic_fetch_add( &ended, 1 );
+  return 0;
+}
+
+static int slow_task( void *arg ) {
+  sleep_ms( (long)(intptr_t)arg );
+  atomic_fetch_add( &ended, 1 );
+  return 0;
+}
+
+/*
+  The group goes back to no running task between two spawns: the first
+  task ends before the second one is spawned. The wait must still last
+  until the second one ended.
+ */
+static void group_empty_between_spawns( void ) {
+  threadpool_t pool  = threadpool_new( 2, 0 );
+  taskgroup_t  group = taskgroup_new( pool );
+  int          round, late = 0;
+
+  test_suite( "Task groups: wait after the group went empty between two spawns" );
+
+  for ( round = 0 ; round < 5 ; round++ ) {
+    atomic_store( &ended, 0 );
+
+    taskgroup_spawn( group, fast_task, NULL );
+    sleep_ms( 20 );                       /* the fast task ends meanwhile */
+    taskgroup_spawn( group, slow_task, (void*)(intptr_t)100 );
+    taskgroup_wait( group );
+
+    if ( 2 != atomic_load( &ended ) ) late++;
+  }
+
+  test_assert( 0 == late, "taskgroup_wait() returns only once the slow task has ended" );
+
+  /* deleting right after the wait must not race with the last task */
+  for ( round = 0 ; round < 200 ; round++ ) {
+    taskgroup_t g = taskgroup_new( pool );
+
+    taskgroup_spawn( g, fast_task, NULL );
+    taskgroup_wait( g );
+    taskgroup_delete( g );
+  }
+  test_assert( 1, "Groups deleted right after their wait" );
+
+  taskgroup_delete( group );
+  threadpool_delete( pool );
+}
+
+static int count_task( void *arg ) {
+  atomic_fetch_add( (atomic_int*)arg, 1 );
+  return 0;
+}
+
+static int fail_task( void *arg ) {
+  return (int)(intptr_t)arg;
+}
+
+static void groups( void ) {
+  threadpool_t pool  = threadpool_new( 4, 0 );
+  taskgroup_t  group = taskgroup_new( pool );
+  atomic_int   count;
+  int          i, result;
+
+  test_suite( "Task groups: spawn, wait, results" );
+
+  test_assert( 4 == threadpool_workers( pool ), "Four workers" );
+  test_assert( -1 == threadpool_worker_id( pool ), "The main thread is not a worker" );
+  test_assert( 0 == taskgroup_wait( group ), "Waiting on a group with no task returns 0" );
+
+  atomic_init( &count, 0 );
+  for ( i = 0 ; i < 10000 ; i++ ) taskgroup_spawn( group, count_task, &count );
+  result = taskgroup_wait( group );
+  test_assert( 0 == result, "10000 tasks returning 0: the wait returns 0" );
+  test_assert( 10000 == atomic_load( &count ), "10000 tasks: all run once" );
+
+  taskgroup_spawn( group, count_task, &count );
+  taskgroup_spawn( group, fail_task, (void*)(intptr_t)7 );
+  taskgroup_spawn( group, count_task, &count );
+  test_assert( 7 == taskgroup_wait( group ), "The wait returns the result of the failing task" );
+  test_assert( 10002 == atomic_load( &count ), "The other tasks of the group still run" );
+
+  taskgroup_spawn( group, count_task, &count );
+  test_assert( 0 == taskgroup_wait( group ), "The result is reset by the wait" );
+
+  taskgroup_delete( group );
+  threadpool_delete( pool );
+}
+
+/* fib( n ) in a task, fib( n - 1 ) and fib( n - 2 ) in subtasks of a
+   group of its own, waited on by the worker that runs it */
+struct fib {
+  threadpool_t pool;
+  int          n;
+  long         result;
+};
+
+static int fib_task( void *arg ) {
+  struct fib *f = arg;
+
+  if ( f->n < 2 ) {
+    f->result = f->n;
+  }
+  else {
+    struct fib  a = { f->pool, f->n - 1, 0 }, b = { f->pool, f->n - 2, 0 };
+    taskgroup_t group = taskgroup_new( f->pool );
+
+    taskgroup_spawn( group, fib_task, &a );
+    taskgroup_spawn( group, fib_task, &b );
+    taskgroup_wait( group );
+    taskgroup_delete( group );
+    f->result = a.result + b.result;
+  }
+
+  return 0;
+}
+
+static void nested_groups( void ) {
+  threadpool_t pool  = threadpool_new( 3, 0 );
+  taskgroup_t  group = taskgroup_new( pool );
+  struct fib   f     = { pool, 18, 0 };
+
+  test_suite( "Task groups: workers waiting on subtasks" );
+
+  taskgroup_spawn( group, fib_task, &f );
+  taskgroup_wait( group );
+  test_assert( 2584 == f.result, "fib( 18 ) by nested task groups, without deadlock" );
+
+  taskgroup_delete( group );
+  threadpool_delete( pool );
+}
+
+/*
+  A task spawns subtasks, which go to its own deque, then sleeps
+  before waiting on them: meanwhile only the other workers may run
+  them, by stealing them.
+ */
+#define STEAL_TASKS 64
+
+struct steal {
+  threadpool_t pool;
+  int          spawner;
+  int          ran_by[ STEAL_TASKS ]; /* -2 until it ran */
+  atomic_int   done;
+};
+
+struct steal_item {
+  struct steal *s;
+  int           i;
+};
+
+static int stolen_task( void *arg ) {
+  struct steal_item *item = arg;
+
+  item->s->ran_by[ item->i ] = threadpool_worker_id( item->s->pool );
+  return 0;
+}
+
+static int spawner_task( void *arg ) {
+  struct steal      *s     = arg;
+  struct steal_item  items[ STEAL_TASKS ];
+  taskgroup_t        group = taskgroup_new( s->pool );
+  int                i;
+
+  s->spawner = threadpool_worker_id( s->pool );
+  for ( i = 0 ; i < STEAL_TASKS ; i++ ) {
+    items[ i ].s = s;
+    items[ i ].i = i;
+    taskgroup_spawn( group, stolen_task, &items[ i ] );
+  }
+  sleep_ms( 100 );
+  taskgroup_wait( group );
+  taskgroup_delete( group );
+  atomic_store( &s->done, 1 );
+
+  return 0;
+}
+
+static void stealing( void ) {
+  threadpool_t pool  = threadpool_new( 4, 0 );
+  taskgroup_t  group = taskgroup_new( pool );
+  struct steal s;
+  int          i, ran = 0, stolen = 0;
+
+  test_suite( "Work stealing" );
+
+  s.pool = pool;
+  atomic_init( &s.done, 0 );
+  for ( i = 0 ; i < STEAL_TASKS ; i++ ) s.ran_by[ i ] = -2;
+
+  /* waiting would have this thread run tasks too: it only polls */
+  taskgroup_spawn( group, spawner_task, &s );
+  while ( !atomic_load( &s.done ) ) sleep_ms( 5 );
+  taskgroup_wait( group );
+
+  for ( i = 0 ; i < STEAL_TASKS ; i++ ) {
+    if ( s.ran_by[ i ] >= 0 ) ran++;
+    if ( s.ran_by[ i ] >= 0 && s.ran_by[ i ] != s.spawner ) stolen++;
+  }
+  test_assert( s.spawner >= 0, "The spawning task runs on a worker" );
+  test_assert( STEAL_TASKS == ran, "All the subtasks ran on workers" );
+  test_assert( STEAL_TASKS == stolen, "All the subtasks were stolen while their spawner slept" );
+
+  taskgroup_delete( group );
+  threadpool_delete( pool );
+}
+
+/*
+  A worker waits on a subtask another worker stole, which takes a while:
+  it must sleep meanwhile, not spin.
+ */
+struct sleeper {
+  threadpool_t pool;
+  int          waiter;
+  atomic_int   ran_by;
+  long         cpu_us; /* of the waiter while it waited */
+  atomic_int   done;
+};
+
+static int stolen_slow_task( void *arg ) {
+  struct sleeper *s = arg;
+
+  atomic_store( &s->ran_by, threadpool_worker_id( s->pool ) );
+  sleep_ms( 300 );
+  return 0;
+}
+
+static int waiting_task( void *arg ) {
+  struct sleeper *s     = arg;
+  taskgroup_t     group = taskgroup_new( s->pool );
+  struct timespec start, end;
+  int             polls;
+
+  s->waiter = threadpool_worker_id( s->pool );
+  taskgroup_spawn( group, stolen_slow_task, s );
+  for ( polls = 0 ; polls < 400 && atomic_load( &s->ran_by ) < 0 ; polls++ ) sleep_ms( 5 );
+
+  clock_gettime( CLOCK_THREAD_CPUTIME_ID, &start );
+  taskgroup_wait( group );
+  clock_gettime( CLOCK_THREAD_CPUTIME_ID, &end );
+  s->cpu_us = ( end.tv_sec - start.tv_sec ) * 1000000L + ( end.tv_nsec - start.tv_nsec ) / 1000;
+
+  taskgroup_delete( group );
+  atomic_store( &s->done, 1 );
+  return 0;
+}
+
+static void sleeping_waiters( void ) {
+  threadpool_t   pool  = threadpool_new( 2, 0 );
+  taskgroup_t    group = taskgroup_new( pool );
+  struct sleeper s;
+
+  test_suite( "Task groups: waiting workers sleep" );
+
+  s.pool   = pool;
+  s.waiter = -1;
+  s.cpu_us = 0;
+  atomic_init( &s.ran_by, -1 );
+  atomic_init( &s.done, 0 );
+
+  /* as above, this thread only polls: the waiter is a worker */
+  taskgroup_spawn( group, waiting_task, &s );
+  while ( !atomic_load( &s.done ) ) sleep_ms( 5 );
+  taskgroup_wait( group );
+
+  test_assert( s.waiter >= 0 && atomic_load( &s.ran_by ) >= 0 && s.waiter != atomic_load( &s.ran_by ), "The subtask was stolen" );
+  test_assert( s.cpu_us < 50000, "Its waiter slept meanwhile (%ld us of CPU)", s.cpu_us );
+
+  taskgroup_delete( group );
+  threadpool_delete( pool );
+}
+
+static void pools( void ) {
+  threadpool_t pool;
+  taskgroup_t  group;
+  atomic_int   count;
+  int          i;
+
+  test_suite( "Thread pools" );
+
+  pool = threadpool_new( 0, 0 );
+  test_assert( threadpool_workers( pool ) >= 1, "0 workers: one per CPU" );
+  threadpool_delete( pool );
+
+  pool  = threadpool_new( 2, THREADPOOL_PIN );
+  group = taskgroup_new( pool );
+  atomic_init( &count, 0 );
+  for ( i = 0 ; i < 100 ; i++ ) taskgroup_spawn( group, count_task, &count );
+  taskgroup_wait( group );
+  test_assert( 100 == atomic_load( &count ), "Pinned workers run the tasks" );
+
+  /* spawned, not waited on: the pool runs them before it stops */
+  for ( i = 0 ; i < 100 ; i++ ) taskgroup_spawn( group, count_task, &count );
+  threadpool_delete( pool );
+  test_assert( 200 == atomic_load( &count ), "threadpool_delete() runs the tasks already spawned" );
+  taskgroup_delete( group );
+}
+
+int main( int argc, char *argv[] ) {
+
+  unit_test( argc, argv );
+
+  group_empty_between_spawns();
+  groups();
+  nested_groups();
+  stealing();
+  sleeping_waiters();
+  pools();
+
+  exit( EXIT_SUCCESS );
+}
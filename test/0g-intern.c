@@ -0,0 +1,126 @@
+/**
+ * @file 0g-intern.c
+ * @author Abdellah
+ * @brief Tests of string interning.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unitest/unitest.h>
+#include <generic/intern.h>
+
+static void interning( void ) {
+  char        buffer[] = "hello";
+  const char *a, *b, *c, *big;
+  char       *large, *other = malloc( 16 );
+  size_t      i;
+  int         ok;
+
+  test_suite( "Interning: canonical strings" );
+
+  a = intern( "hello" );
+  b = intern( buffer );
+  c = intern_n( "hello world", 5 );
+  test_assert( a == b && b == c, "Equal strings have the same canonical copy" );
+  test_assert( a != intern( "hell" ), "Different strings do not" );
+  test_assert( 5 == intern_length_of( a ) && 0 == strcmp( a, "hello" ), "The canonical copy is the string" );
+  test_assert( intern_string( intern_id_of( a ) ) == a, "The string of its ID is the canonical copy" );
+  test_assert( intern_id( "hello", 5 ) == intern_id_of( a ), "intern_id() gives the ID of a string" );
+  test_assert( NULL == intern_string( -1 ) && NULL == intern_string( (int)intern_count() ), "No string for an unknown ID" );
+
+  a = intern_n( "a\0b", 3 );
+  test_assert( 3 == intern_length_of( a ) && a != intern( "a" ), "Strings holding '\\0' bytes" );
+
+  test_assert( intern_owns( a ) && intern_owns( a + 2 ), "intern_owns() on canonical strings" );
+  test_assert( !intern_owns( buffer ) && !intern_owns( other ) && !intern_owns( NULL ), "intern_owns() on other strings" );
+
+  /* more than a chunk in one string, then many strings */
+  large = malloc( 3 * 1024 * 1024 );
+  memset( large, 'x', 3 * 1024 * 1024 );
+  big = intern_n( large, 3 * 1024 * 1024 );
+  test_assert( intern_owns( big ) && intern_owns( big + 3 * 1024 * 1024 - 1 ), "A string larger than a chunk" );
+  test_assert( big == intern_n( large, 3 * 1024 * 1024 ), "A string larger than a chunk is interned once" );
+  free( large );
+
+  for ( ok = 1, i = 0 ; i < 100000 ; i++ ) {
+    char s[ 32 ];
+
+    snprintf( s, sizeof( s ), "s%zu", i );
+    a = intern( s );
+    ok = ok && intern_owns( a ) && intern_string( intern_id_of( a ) ) == a;
+  }
+  test_assert( ok, "100000 strings: each owned and found by its ID" );
+
+  free( other );
+}
+
+/*
+  Threads interning the same strings in different orders get the same
+  canonical copies.
+ */
+#define THREADS 4
+#define STRINGS 20000
+
+static const char *seen[ THREADS ][ STRINGS ];
+
+static void *intern_all( void *arg ) {
+  size_t t = (size_t)arg, i, k;
+  char   s[ 32 ];
+
+  for ( k = 0 ; k < 3 ; k++ ) {
+    for ( i = 0 ; i < STRINGS ; i++ ) {
+      size_t j = ( i * 7 + t * 4999 ) % STRINGS;
+
+      snprintf( s, sizeof( s ), "thread string %zu", j );
+      seen[ t ][ j ] = intern( s );
+    }
+  }
+
+  return NULL;
+}
+
+static void threads( void ) {
+  pthread_t thread[ THREADS ];
+  size_t    t, i, differ = 0;
+
+  test_suite( "Interning: several threads" );
+
+  for ( t = 0 ; t < THREADS ; t++ ) pthread_create( &thread[ t ], NULL, intern_all, (void*)t );
+  for ( t = 0 ; t < THREADS ; t++ ) pthread_join( thread[ t ], NULL );
+
+  for ( i = 0 ; i < STRINGS ; i++ ) {
+    for ( t = 1 ; t < THREADS ; t++ ) if ( seen[ t ][ i ] != seen[ 0 ][ i ] ) differ++;
+  }
+  test_assert( 0 == differ, "Every thread gets the same canonical copies" );
+  test_assert( intern_owns( seen[ 0 ][ 0 ] ) && 0 == strcmp( seen[ 1 ][ 42 ], "thread string 42" ), "They are canonical strings" );
+}
+
+static void release( void ) {
+  const char *a;
+
+  test_suite( "Interning: release" );
+
+  intern( "before" );
+  intern_release();
+  test_assert( 0 == intern_count() && 0 == intern_bytes(), "A released table is empty" );
+
+  /* the cache of this thread must not give the old copy */
+  a = intern( "before" );
+  test_assert( 0 == intern_id_of( a ) && 1 == intern_count(), "Interning starts over after a release" );
+  test_assert( intern_owns( a ) && 0 == strcmp( a, "before" ), "The new copies are canonical strings" );
+  test_assert( a == intern( "before" ), "And they are interned once" );
+}
+
+int main( int argc, char *argv[] ) {
+
+  unit_test( argc, argv );
+
+  interning();
+  threads();
+  release();
+
+  exit( EXIT_SUCCESS );
+}
@@ -0,0 +1,162 @@
+/**
+ * @file 0h-linkpool.c
+ * @author Abdellah
+ * @brief Tests of the pool of list links.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <unitest/unitest.h>
+#include <generic/arena.h>
+#include <generic/linkpool.h>
+
+struct link_t {
+  void          *contents;
+  struct link_t *next;
+};
+
+static void recycling( void ) {
+  struct link_t *a, *b;
+
+  test_suite( "Link pool: recycling" );
+
+  a = link_alloc();
+  link_free( a );
+  test_assert( a == link_alloc(), "A freed link is handed out again" );
+
+  a->next = b = link_alloc();
+  b->next = NULL;
+  link_free_chain( a );
+  test_assert( a == link_alloc() && b == link_alloc(), "So are the links of a freed chain" );
+
+  link_free( b );
+  link_free( a );
+}
+
+/* where a link comes from, whatever the arena current when it is freed */
+static void origins( void ) {
+  arena_t        unit = arena_new( 0 );
+  struct link_t *pooled, *unit_link, *next;
+
+  test_suite( "Link pool: links of an arena" );
+
+  pooled = link_alloc();
+
+  arena_set_current( unit );
+  unit_link = link_alloc();
+  test_assert( arena_owns( unit, unit_link ), "Links come from the current arena" );
+  link_free( pooled );
+  arena_set_current( NULL );
+
+  test_assert( pooled == link_alloc(), "A link of the pool freed under an arena goes back to the pool" );
+
+  unit_link->next = NULL;
+  link_free( unit_link );
+  next = link_alloc();
+  test_assert( next != unit_link && !arena_owns( unit, next ), "A link of an arena is not taken by the pool" );
+
+  arena_delete( unit );
+  link_free( next );
+  link_free( pooled );
+}
+
+#define LENGTH 10000
+
+/* a chain made by a thread that then ends */
+static void *make_chain( void *arg ) {
+  struct link_t **chain = arg;
+  size_t          i;
+
+  /* more than a block */
+  for ( *chain = NULL, i = 0 ; i < LENGTH ; i++ ) {
+    struct link_t *l = link_alloc();
+
+    l->contents = (void *)i;
+    l->next     = *chain;
+    *chain      = l;
+  }
+
+  return NULL;
+}
+
+static void *take_link( void *arg ) {
+  *(struct link_t **)arg = link_alloc();
+  return NULL;
+}
+
+static int in_chain( struct link_t *chain, struct link_t *link ) {
+  for ( ; chain ; chain = chain->next ) if ( chain == link ) return 1;
+  return 0;
+}
+
+static void threads( void ) {
+  struct link_t *chain, *l, *mine, *taken;
+  pthread_t      thread;
+  size_t         i;
+  int            ok;
+
+  test_suite( "Link pool: threads" );
+
+  pthread_create( &thread, NULL, make_chain, &chain );
+  pthread_join( thread, NULL );
+
+  for ( ok = 1, l = chain, i = LENGTH ; l ; l = l->next ) ok = ok && l->contents == (void *)--i;
+  test_assert( ok && 0 == i, "A chain outlives the thread which made it" );
+
+  /* back to the pool of the ended thread, not to ours */
+  link_free_chain( chain );
+  mine = link_alloc();
+  test_assert( !in_chain( chain, mine ), "Links of another thread go back to their own pool" );
+
+  /* the next thread takes that pool over */
+  pthread_create( &thread, NULL, take_link, &taken );
+  pthread_join( thread, NULL );
+  test_assert( taken == chain, "The pool of an ended thread is taken over, with the links given back" );
+
+  link_free( mine );
+}
+
+/* a chain of links of this thread, another thread and an arena */
+static void mixed( void ) {
+  arena_t        unit = arena_new( 0 );
+  struct link_t *a, *b, *c, *d, *next;
+  pthread_t      thread;
+
+  test_suite( "Link pool: mixed chains" );
+
+  a = link_alloc();
+  pthread_create( &thread, NULL, take_link, &b );
+  pthread_join( thread, NULL );
+  arena_set_current( unit );
+  c = link_alloc();
+  arena_set_current( NULL );
+  d = link_alloc();
+
+  a->next = b;
+  b->next = c;
+  c->next = d;
+  d->next = NULL;
+  link_free_chain( a );
+
+  next = link_alloc();
+  test_assert( next == d || next == a, "The links of this thread are recycled" );
+  next = link_alloc();
+  test_assert( next == d || next == a, "Both of them" );
+  next = link_alloc();
+  test_assert( next != b && next != c, "Neither the link of another thread nor the one of an arena" );
+
+  arena_delete( unit );
+}
+
+int main( int argc, char *argv[] ) {
+
+  unit_test( argc, argv );
+
+  recycling();
+  origins();
+  threads();
+  mixed();
+
+  exit( EXIT_SUCCESS );
+}
@@ -0,0 +1,125 @@
+/**
+ * @file 0i-arena.c
+ * @author Abdellah
+ * @brief Tests of unit memory released on other threads.
+ *
+ * unit_free() must tell memory of an arena from malloc()'s by where it
+ * comes from, not by the arena current on the thread releasing it.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unitest/unitest.h>
+#include <generic/arena.h>
+
+#define COUNT 20000
+#define SIZE  40
+
+struct batch {
+  char   *from_arena[ COUNT ];
+  char   *from_malloc[ COUNT ];
+  arena_t current;   /* while releasing them, NULL for none */
+};
+
+static void *release( void *arg ) {
+  struct batch *b = arg;
+  size_t        i;
+
+  arena_set_current( b->current );
+  for ( i = 0 ; i < COUNT ; i++ ) {
+    unit_free( b->from_arena[ i ] );
+    unit_free( b->from_malloc[ i ] );
+  }
+  arena_set_current( NULL );
+
+  return NULL;
+}
+
+/* the arena memory is still there, with what was written in it */
+static int intact( struct batch *b ) {
+  size_t i;
+
+  for ( i = 0 ; i < COUNT ; i++ ) {
+    if ( b->from_arena[ i ][ 0 ] != (char)i || b->from_arena[ i ][ SIZE - 1 ] != (char)i ) return 0;
+  }
+
+  return 1;
+}
+
+static void fill( struct batch *b, arena_t unit ) {
+  size_t i;
+
+  for ( i = 0 ; i < COUNT ; i++ ) {
+    arena_set_current( unit );
+    b->from_arena[ i ] = unit_malloc( i % 100 ? SIZE : 100000 );
+    memset( b->from_arena[ i ], (char)i, SIZE );
+    arena_set_current( NULL );
+    b->from_malloc[ i ] = unit_malloc( SIZE );
+  }
+}
+
+static void threads( void ) {
+  arena_t       unit  = arena_new( 0 );
+  arena_t       other = arena_new( 0 );
+  struct batch *b     = calloc( 1, sizeof( *b ) );
+  pthread_t     thread;
+
+  test_suite( "Unit memory released on other threads" );
+
+  /* more than a chunk, and allocations larger than one */
+  fill( b, unit );
+  test_assert( arena_owns( unit, b->from_arena[ COUNT - 1 ] ) && !arena_owns( unit, b->from_malloc[ 0 ] ), "Both kinds of memory are made" );
+
+  b->current = NULL;
+  pthread_create( &thread, NULL, release, b );
+  pthread_join( thread, NULL );
+  test_assert( intact( b ), "Released on a thread without arena, arena memory is left to its arena" );
+  arena_reset( unit );
+
+  fill( b, unit );
+  b->current = other;
+  pthread_create( &thread, NULL, release, b );
+  pthread_join( thread, NULL );
+  test_assert( intact( b ), "Released on a thread with another arena, arena memory is left to its arena" );
+
+  /* and the memory from malloc() released under an arena is freed
+     (a leak otherwise, for the leak checker) */
+  arena_reset( unit );
+  fill( b, unit );
+  b->current = unit;
+  release( b );
+  test_assert( intact( b ), "Released under its own arena, too" );
+
+  arena_delete( unit );
+  arena_delete( other );
+  free( b );
+}
+
+static void chunk_sizes( void ) {
+  arena_t small = arena_new( 100 );
+  char   *p, *q;
+
+  test_suite( "Chunks of any size" );
+
+  p = arena_alloc( small, 1000 );
+  q = arena_alloc( small, 3 * 64 * 1024 );
+  test_assert( arena_owns( small, p ) && arena_owns( small, q + 3 * 64 * 1024 - 1 ), "Small chunk size and large allocations" );
+
+  unit_free( p );
+  unit_free( q + 2 * 64 * 1024 );
+  test_assert( arena_owns( small, q ), "Released, they stay in the arena" );
+
+  arena_delete( small );
+}
+
+int main( int argc, char *argv[] ) {
+
+  unit_test( argc, argv );
+
+  threads();
+  chunk_sizes();
+
+  exit( EXIT_SUCCESS );
+}
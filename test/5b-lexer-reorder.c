@@ -0,0 +1,239 @@
+/**
+ * @file 5b-lexer-reorder.c
+ * @author Abdellah
+ * @brief Differential test of the reordered lexer rules.
+ *
+ * The rules are profiled on a corpus, reordered by lex_rules_reorder(),
+ * then every file of the corpus is lexed with both rule files: the
+ * lexems must be exactly the same, with and without the native
+ * scanners and the trivia. The corpus is a few generated sources, plus
+ * the .pys files of TEST_DATA "files-pys/" when there are some.
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <unitest/unitest.h>
+#include <generic/list.h>
+#include <lexer/lexem.h>
+#include <lexer/lexer.h>
+#include <lexer/reorder.h>
+#include <regexp/overlap.h>
+
+#define RULES  "include/lexer/regexp_file.lex"
+#define CORPUS TEST_DATA "files-pys/"
+#define FILES  64
+
+static const char *sources[] = {
+  /* every kind of lexem */
+  "# a comment\n"
+  ".set version_pyvm 62211\n"
+  ".set flags 0x00000040\n"
+  ".set filename \"all.py\"\n"
+  ".set name '<module>'\n"
+  ".set stack_size 4\n"
+  ".set arg_count 0\n"
+  "\n"
+  ".interned\n  \"x\"\n  'y'\n"
+  ".consts\n"
+  "  None\n  True\n  False\n"
+  "  0 -1 42 -0 007\n"
+  "  0x1F 0xdeadBEEF 0b1011 0o777\n"
+  "  1.5 2. 0.25 1e10 1.5e-3 2E7 3.e2\n"
+  "  \"\" '' \"it's\" 'say \"hi\"' \"# not a comment\"\n"
+  "  ( ) [ ] { } :\n"
+  ".names\n  \"x\"\n"
+  ".varnames\n"
+  ".text\n"
+  ".line 1\n"
+  "  LOAD_CONST 0    # trailing comment\n"
+  "  STORE_NAME 0\n"
+  "loop:\n"
+  "  LOAD_NAME 0\n"
+  "  POP_JUMP_IF_FALSE end\n"
+  "  JUMP_ABSOLUTE loop\n"
+  "end:\n"
+  "  LOAD_CONST 0\n"
+  "  RETURN_VALUE\n",
+
+  /* nested code objects */
+  ".set version_pyvm 62211\n"
+  ".set flags 0x00000040\n"
+  ".set filename \"nested.py\"\n"
+  ".set name \"<module>\"\n"
+  ".set stack_size 1\n"
+  ".set arg_count 0\n"
+  ".consts\n"
+  "  None\n"
+  "  .code_start\n"
+  "    .set version_pyvm 62211\n"
+  "    .set flags 0x00000043\n"
+  "    .set filename \"nested.py\"\n"
+  "    .set name \"f\"\n"
+  "    .set stack_size 2\n"
+  "    .set arg_count 1\n"
+  "    .consts\n      None\n      3.14\n"
+  "    .varnames\n      \"a\"\n"
+  "    .text\n"
+  "    .line 2\n"
+  "      LOAD_FAST 0\n"
+  "      LOAD_CONST 1\n"
+  "      BINARY_ADD\n"
+  "      RETURN_VALUE\n"
+  "  .code_end\n"
+  ".text\n"
+  ".line 1\n"
+  "  LOAD_CONST 1\n"
+  "  MAKE_FUNCTION 0\n"
+  "  POP_TOP\n"
+  "  LOAD_CONST 0\n"
+  "  RETURN_VALUE\n",
+
+  /* blanks and lexems side by side */
+  "\t.set\tname\t\"t\"\n\n\n.consts\n\t-12\t0x0\t1e1\n\n#\n#only comments\n"
+  ".text\n.line 7\nNOP\nLOAD_CONST 0 RETURN_VALUE\n"
+};
+
+static char *temp_file( const char *prefix ) {
+  char *name = malloc( 64 );
+
+  snprintf( name, 64, "/tmp/%s-XXXXXX", prefix );
+  close( mkstemp( name ) );
+
+  return name;
+}
+
+static char *source_file( const char *source ) {
+  char *name = temp_file( "5b-lexer-reorder" );
+  FILE *fp   = fopen( name, "w" );
+
+  fputs( source, fp );
+  fclose( fp );
+
+  return name;
+}
+
+/* the generated sources, then the files of the corpus directory */
+static int corpus( char *files[], int *generated ) {
+  DIR           *dir = opendir( CORPUS );
+  struct dirent *entry;
+  int            n   = 0;
+  size_t         i;
+
+  for ( i = 0 ; i < sizeof( sources ) / sizeof( *sources ) ; i++ ) files[ n++ ] = source_file( sources[ i ] );
+  *generated = n;
+
+  while ( dir && n < FILES && ( entry = readdir( dir ) ) ) {
+    size_t length = strlen( entry->d_name );
+
+    if ( length < 5 || strcmp( entry->d_name + length - 4, ".pys" ) ) continue;
+    files[ n ] = malloc( strlen( CORPUS ) + length + 1 );
+    strcpy( files[ n ], CORPUS );
+    strcat( files[ n ], entry->d_name );
+    n++;
+  }
+  if ( dir ) closedir( dir );
+
+  return n;
+}
+
+static int same_lexems( list_t l1, list_t l2 ) {
+  for ( ; !list_is_empty( l1 ) && !list_is_empty( l2 ) ; l1 = list_next( l1 ), l2 = list_next( l2 ) ) {
+    if ( !lexem_is_egal( list_first( l1 ), list_first( l2 ) ) ) return 0;
+  }
+
+  return list_is_empty( l1 ) && list_is_empty( l2 );
+}
+
+/* the types of the rules of a file, in order, in one string */
+static char *rule_types( char *lex_defs ) {
+  list_t rules = lex_rules_load( lex_defs ), l;
+  size_t size  = 1;
+  char  *types;
+
+  for ( l = rules ; !list_is_empty( l ) ; l = list_next( l ) ) size += strlen( lex_rule_type( list_first( l ) ) ) + 1;
+  types = calloc( 1, size );
+  for ( l = rules ; !list_is_empty( l ) ; l = list_next( l ) ) {
+    strcat( types, lex_rule_type( list_first( l ) ) );
+    strcat( types, " " );
+  }
+  list_delete( rules, lex_rule_delete );
+
+  return types;
+}
+
+static void first_bytes( void ) {
+  char first[ 256 ];
+  int  c, digits = 1;
+
+  test_suite( "Reordered rules: the bytes lexems start with" );
+
+  test_assert( 0 == re_first_bytes( "-?[0-9]+", first ), "A regexp is analysed" );
+  for ( c = 0 ; c < 256 ; c++ ) digits = digits && first[ c ] == ( '-' == c || ( c >= '0' && c <= '9' ) );
+  test_assert( digits, "A sign or a digit" );
+
+  re_first_bytes( "^[\"]*\"", first );
+  test_assert( first[ 'a' ] && first[ '"' ] && first[ 200 ] && !first[ 0 ], "A negated group starts with bytes past 127 too" );
+}
+
+int main( int argc, char *argv[] ) {
+  static const int options[] = { 0, LEX_SKIP_TRIVIA, LEX_NO_SCANNERS, LEX_SKIP_TRIVIA | LEX_NO_SCANNERS };
+  char            *files[ FILES ], *reordered, *before, *after;
+  int              n, generated, i, o, lexed = 0, differ = 0, failed = 0;
+
+  unit_test( argc, argv );
+
+  first_bytes();
+
+  n = corpus( files, &generated );
+
+  test_suite( "Reordered rules: the rules" );
+
+  /* the hit counts the reordering is based on */
+  lex_profile_enable();
+  for ( i = 0 ; i < n ; i++ ) list_delete( lex( RULES, files[ i ] ), lexem_delete );
+
+  reordered = temp_file( "5b-lexer-reorder-rules" );
+  test_assert( 0 == lex_rules_reorder( RULES, reordered ), "The reordered rules are written" );
+
+  before = rule_types( RULES );
+  after  = rule_types( reordered );
+  test_assert( strlen( before ) == strlen( after ), "The reordered file has the same rules" );
+  test_assert( strcmp( before, after ), "Some rules are moved" );
+  /* only the rules whose lexems can start like numbers hold it back */
+  test_assert( strstr( after, "number::* " ) - after < strstr( before, "number::* " ) - before, "The @number scanner is moved too" );
+  free( before );
+  free( after );
+
+  test_suite( "Reordered rules: the same lexems on every file" );
+
+  for ( i = 0 ; i < n ; i++ ) {
+    for ( o = 0 ; o < (int)( sizeof( options ) / sizeof( *options ) ) ; o++ ) {
+      list_t original = lex_with( RULES, files[ i ], options[ o ] );
+      list_t check    = lex_with( reordered, files[ i ], options[ o ] );
+
+      if ( !original || !check ) failed++;
+      else if ( !same_lexems( original, check ) ) differ++;
+      else lexed++;
+
+      list_delete( original, lexem_delete );
+      list_delete( check, lexem_delete );
+    }
+  }
+
+  test_assert( 0 == failed, "Every file is lexed with both rule files" );
+  test_assert( 0 == differ, "Both rule files give the same lexems (%d files, %d of them from " CORPUS ")", n, n - generated );
+  test_assert( lexed == 4 * n, "Each file is compared with and without scanners and trivia" );
+
+  for ( i = 0 ; i < n ; i++ ) {
+    if ( i < generated ) unlink( files[ i ] );
+    free( files[ i ] );
+  }
+  unlink( reordered );
+  free( reordered );
+
+  exit( EXIT_SUCCESS );
+}
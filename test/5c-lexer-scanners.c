@@ -0,0 +1,176 @@
+/**
+ * @file 5c-lexer-scanners.c
+ * @author Abdellah
+ * @brief Differential test of the native scanners against their regexps.
+ *
+ * @number and @string stand for families of regexp rules (see
+ * scanner.h). On generated edge cases (prefixes, signs, exponents,
+ * escapes, unterminated strings...), the scanner must give what the
+ * lexer would get from the rules of the family in file order: the type
+ * of the first non-empty match and its end, or no lexem at all.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unitest/unitest.h>
+#include <generic/list.h>
+#include <regexp/regexp.h>
+#include <lexer/lexer.h>
+#include <lexer/scanner.h>
+
+#define RULES "include/lexer/regexp_file.lex"
+
+/* the regexp rules of a family, in file order */
+static list_t family( list_t rules, const char *prefix ) {
+  list_t found = list_new();
+
+  for ( ; !list_is_empty( rules ) ; rules = list_next( rules ) ) {
+    void *rule = list_first( rules );
+
+    if ( lex_rule_is_native( rule ) ) continue;
+    if ( strncmp( lex_rule_type( rule ), prefix, strlen( prefix ) ) ) continue;
+    found = list_add_last( rule, found );
+  }
+
+  return found;
+}
+
+/* as the lexer does: first rule with a non-empty match, NULL if none */
+static const char *by_regexps( list_t rules, char *text, char **end ) {
+  for ( ; !list_is_empty( rules ) ; rules = list_next( rules ) ) {
+    void *rule = list_first( rules );
+
+    if ( re_match( (char*)lex_rule_regex( rule ), text, end ) && *end > text ) return lex_rule_type( rule );
+  }
+
+  return NULL;
+}
+
+static const char *by_scanner( struct lex_scanner *scanner, char *text, char **end ) {
+  int k = scanner->scan( text, text + strlen( text ), end );
+
+  return k >= 0 && *end > text ? scanner->types[ k ] : NULL;
+}
+
+struct tally {
+  int  cases, differ, rejected;
+  char first[ 64 ];         /* the first case that differs */
+  char types[ 16 ][ 32 ];   /* the types the cases gave */
+  int  ntypes;
+};
+
+static void compare( struct tally *t, list_t rules, struct lex_scanner *scanner, char *text ) {
+  char       *end_re = NULL, *end_scan = NULL;
+  const char *re     = by_regexps( rules, text, &end_re );
+  const char *scan   = by_scanner( scanner, text, &end_scan );
+  int         i;
+
+  t->cases++;
+
+  if ( !re && !scan ) {
+    t->rejected++;
+    return;
+  }
+  if ( !re || !scan || strcmp( re, scan ) || end_re != end_scan ) {
+    if ( !t->differ++ ) snprintf( t->first, sizeof( t->first ), "%s", text );
+    return;
+  }
+
+  for ( i = 0 ; i < t->ntypes && strcmp( t->types[ i ], re ) ; i++ );
+  if ( i == t->ntypes && t->ntypes < 16 ) snprintf( t->types[ t->ntypes++ ], 32, "%s", re );
+}
+
+static void numbers( list_t rules ) {
+  static const char *signs[]     = { "", "-", "--", "+", "0", "-0" };
+  static const char *bodies[]    = { "", "0", "1", "09", "123", "x", "x1f", "xG", "X1",
+                                     "b", "b01", "b2", "o", "o17", "o8" };
+  static const char *fractions[] = { "", ".", ".5", "..", ".x" };
+  static const char *exponents[] = { "", "e", "E", "e5", "e-5", "e+5", "E+", "e-" };
+  static const char *after[]     = { "", " ", "a" };
+  struct lex_scanner *scanner    = lex_scanner_find( "number" );
+  list_t              family_    = family( rules, "number::" );
+  struct tally        t;
+  size_t              a, b, c, d, e;
+  char                text[ 64 ];
+
+  test_suite( "@number against the number:: regexps" );
+
+  memset( &t, 0, sizeof( t ) );
+
+  test_assert( NULL != scanner, "@number is registered" );
+  test_assert( 7 == list_length( family_ ), "The number:: family has its 7 regexp rules" );
+  if ( !scanner ) return;
+
+#define COUNT( array ) ( sizeof( array ) / sizeof( *array ) )
+  for ( a = 0 ; a < COUNT( signs ) ; a++ )
+    for ( b = 0 ; b < COUNT( bodies ) ; b++ )
+      for ( c = 0 ; c < COUNT( fractions ) ; c++ )
+        for ( d = 0 ; d < COUNT( exponents ) ; d++ )
+          for ( e = 0 ; e < COUNT( after ) ; e++ ) {
+            snprintf( text, sizeof( text ), "%s%s%s%s%s", signs[ a ], bodies[ b ], fractions[ c ], exponents[ d ], after[ e ] );
+            compare( &t, family_, scanner, text );
+          }
+
+  test_assert( 0 == t.differ, "%d cases, %d differ (first: \"%s\")", t.cases, t.differ, t.first );
+  test_assert( t.rejected > 0, "Some cases are no number at all (%d)", t.rejected );
+  test_assert( 6 == t.ntypes, "Every number type but floatexp comes out (%d types)", t.ntypes );
+
+  list_delete( family_, NULL );
+}
+
+static void strings( list_t rules ) {
+  static const char *quotes[]   = { "\"", "'" };
+  static const char *contents[] = { "", "a", "it's", "say \"hi\"", "\\", "\\\"", "\\'", "\\n",
+                                    "#", "\xc3\xa9", "\t", "a\nb", "\x7f" };
+  static const char *closing[]  = { "", "\"", "'", "\\\"", "\\'" };
+  static const char *after[]    = { "", "x", "\"", "'" };
+  struct lex_scanner *scanner   = lex_scanner_find( "string" );
+  list_t              family_   = family( rules, "string::" );
+  struct tally        t;
+  size_t              a, b, c, d;
+  char                text[ 64 ];
+
+  test_suite( "@string against the string:: regexps" );
+
+  memset( &t, 0, sizeof( t ) );
+
+  test_assert( NULL != scanner, "@string is registered" );
+  test_assert( 2 == list_length( family_ ), "The string:: family has its 2 regexp rules" );
+  if ( !scanner ) return;
+
+  for ( a = 0 ; a < COUNT( quotes ) ; a++ )
+    for ( b = 0 ; b < COUNT( contents ) ; b++ )
+      for ( c = 0 ; c < COUNT( closing ) ; c++ )
+        for ( d = 0 ; d < COUNT( after ) ; d++ ) {
+          snprintf( text, sizeof( text ), "%s%s%s%s", quotes[ a ], contents[ b ], closing[ c ], after[ d ] );
+          compare( &t, family_, scanner, text );
+        }
+
+  test_assert( 0 == t.differ, "%d cases, %d differ (first: \"%s\")", t.cases, t.differ, t.first );
+  test_assert( t.rejected > 0, "Unterminated strings are no string at all (%d)", t.rejected );
+  test_assert( 2 == t.ntypes, "Both string types come out" );
+
+  list_delete( family_, NULL );
+}
+
+int main( int argc, char *argv[] ) {
+  list_t rules;
+
+  unit_test( argc, argv );
+
+  rules = lex_rules_load( RULES );
+  if ( !rules ) {
+    test_suite( "Rules" );
+    test_assert( 0, "The rules are loaded from " RULES );
+    exit( EXIT_FAILURE );
+  }
+
+  numbers( rules );
+  strings( rules );
+
+  list_delete( rules, lex_rule_delete );
+
+  exit( EXIT_SUCCESS );
+}
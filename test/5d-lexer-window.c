@@ -0,0 +1,141 @@
+/**
+ * @file 5d-lexer-window.c
+ * @author Abdellah
+ * @brief Tests of the lexer window on inputs that are not read at once.
+ *
+ * The source comes from a pipe. Lexems longer than the window are read
+ * whole, and a lexical error is reported as soon as it is seen: the
+ * lexer must not wait for the end of the input when no rule could use
+ * what follows.
+ */
+
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <unitest/unitest.h>
+#include <generic/list.h>
+#include <lexer/lexem.h>
+#include <lexer/lexer.h>
+
+#define RULES "include/lexer/regexp_file.lex"
+#define LONG  ( 200 * 1024 )
+
+struct writer {
+  int   fd;        /* write end of the source pipe */
+  int   go_on;     /* read end of a pipe telling it to finish */
+  char *text;
+  int   waited;    /* 1 if nobody told it to finish in time */
+};
+
+/* writes the text, waits to be told (or not) and closes the source */
+static void *write_source( void *arg ) {
+  struct writer *w      = arg;
+  size_t         length = strlen( w->text ), done = 0;
+  struct pollfd  told   = { w->go_on, POLLIN, 0 };
+
+  while ( done < length ) {
+    ssize_t n = write( w->fd, w->text + done, length - done );
+
+    if ( n <= 0 ) break;
+    done += n;
+  }
+  if ( w->go_on >= 0 ) w->waited = 0 == poll( &told, 1, 1500 );
+  close( w->fd );
+
+  return NULL;
+}
+
+static list_t lex_through_pipe( struct writer *w, int options ) {
+  pthread_t thread;
+  int       source[ 2 ], control[ 2 ] = { -1, -1 };
+  list_t    lexems;
+
+  if ( pipe( source ) || ( w->go_on >= 0 && pipe( control ) ) ) exit( EXIT_FAILURE );
+  w->fd     = source[ 1 ];
+  w->go_on  = control[ 0 ];
+  w->waited = 0;
+  pthread_create( &thread, NULL, write_source, w );
+
+  lexems = lex_fd( RULES, source[ 0 ], options );
+
+  /* the writer may be stuck on a full pipe: its write() fails */
+  if ( control[ 1 ] >= 0 && write( control[ 1 ], "", 1 ) < 0 ) exit( EXIT_FAILURE );
+  close( source[ 0 ] );
+  pthread_join( thread, NULL );
+  if ( control[ 1 ] >= 0 ) {
+    close( control[ 0 ] );
+    close( control[ 1 ] );
+  }
+
+  return lexems;
+}
+
+static void long_lexems( int options ) {
+  struct writer w    = { -1, -1, NULL, 0 };
+  char         *text = malloc( 2 * LONG + 64 );
+  char         *p    = text;
+  list_t        lexems;
+  lexem_t       first;
+
+  /* a string longer than the window, then a comment as long */
+  *p++ = '"';
+  memset( p, 'a', LONG );
+  p += LONG;
+  p += sprintf( p, "\" 12 #" );
+  memset( p, 'b', LONG );
+  strcpy( p + LONG, "\n" );
+  w.text = text;
+
+  lexems = lex_through_pipe( &w, options );
+  test_assert( NULL != lexems, "The source is lexed" );
+  if ( lexems ) {
+    first = list_first( lexems );
+    test_assert( 0 == strncmp( lexem_type( first ), "string::", 8 ) && LONG + 2 == strlen( lexem_value( first ) ),
+                 "The string is one lexem (%s, %zu bytes)", lexem_type( first ), strlen( lexem_value( first ) ) );
+  }
+
+  list_delete( lexems, lexem_delete );
+  free( text );
+}
+
+static void early_error( int options ) {
+  struct writer w    = { -1, 0, NULL, 0 };
+  char         *text = malloc( 2 * LONG + 64 );
+  char         *p    = text;
+  list_t        lexems;
+
+  /* more than the window after the error */
+  p += sprintf( p, "  LOAD_CONST 0\n  ` LOAD_CONST 1\n" );
+  while ( p < text + 2 * LONG ) p += sprintf( p, "  LOAD_CONST 0\n" );
+  w.text = text;
+
+  lexems = lex_through_pipe( &w, options );
+  test_assert( NULL == lexems, "The error is found" );
+  test_assert( !w.waited, "It is reported before the end of the input" );
+
+  list_delete( lexems, lexem_delete );
+  free( text );
+}
+
+int main( int argc, char *argv[] ) {
+
+  unit_test( argc, argv );
+  signal( SIGPIPE, SIG_IGN );
+
+  test_suite( "Lexer window: lexems longer than the window" );
+  long_lexems( 0 );
+  long_lexems( LEX_NO_SCANNERS );
+  long_lexems( LEX_SKIP_TRIVIA );
+
+  test_suite( "Lexer window: lexical errors before the end of the input" );
+  early_error( 0 );
+  early_error( LEX_NO_SCANNERS );
+  early_error( LEX_SKIP_TRIVIA );
+
+  exit( EXIT_SUCCESS );
+}
@@ -0,0 +1,187 @@
+/**
+ * @file 7b-parser-nested.c
+ * @author Abdellah
+ * @brief Tests of nested code objects parsed from a list of lexems.
+ *
+ * parse_program() moves the lexems of the instructions out of the list
+ * into the code objects, without copying them: the instructions of every
+ * code object, the nested ones too, are the very lexems lex() made, and
+ * the list keeps the others.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <unitest/unitest.h>
+#include <generic/list.h>
+#include <lexer/lexem.h>
+#include <lexer/lexer.h>
+#include <parser/parser.h>
+#include <parser/pyobj.h>
+#include <parser/conststream.h>
+
+#define RULES "include/lexer/regexp_file.lex"
+
+static const char *source =
+  ".set version_pyvm 62211\n"
+  ".set flags 0x00000040\n"
+  ".set filename \"nested.py\"\n"
+  ".set name \"<module>\"\n"
+  ".set stack_size 1\n"
+  ".set arg_count 0\n"
+  "\n"
+  ".consts\n"
+  "  None\n"
+  "  .code_start\n"
+  "    .set version_pyvm 62211\n"
+  "    .set flags 0x00000043\n"
+  "    .set filename \"nested.py\"\n"
+  "    .set name \"f\"\n"
+  "    .set stack_size 1\n"
+  "    .set arg_count 0\n"
+  "    .consts\n"
+  "      None\n"
+  "      .code_start\n"
+  "        .set version_pyvm 62211\n"
+  "        .set flags 0x00000043\n"
+  "        .set filename \"nested.py\"\n"
+  "        .set name \"g\"\n"
+  "        .set stack_size 1\n"
+  "        .set arg_count 0\n"
+  "        .consts\n"
+  "          None\n"
+  "        .text\n"
+  "        .line 3\n"
+  "          LOAD_CONST 0\n"
+  "          RETURN_VALUE\n"
+  "      .code_end\n"
+  "    .text\n"
+  "    .line 2\n"
+  "      LOAD_CONST 0\n"
+  "      RETURN_VALUE\n"
+  "  .code_end\n"
+  "\n"
+  ".text\n"
+  ".line 1\n"
+  "  LOAD_CONST 0\n"
+  "  RETURN_VALUE\n";
+
+/* the source in a file of its own, for lex() */
+static char *source_file( void ) {
+  static char name[] = "/tmp/7b-parser-nested-XXXXXX";
+  int         fd     = mkstemp( name );
+
+  if ( fd < 0 ) return NULL;
+  if ( write( fd, source, strlen( source ) ) != (ssize_t)strlen( source ) ) {
+    close( fd );
+    return NULL;
+  }
+  close( fd );
+
+  return name;
+}
+
+/* the code object held by the .consts of code, streamed or not */
+static pyobj_t nested( pyobj_t code ) {
+  conststream_t stream = conststream_of( code );
+  pyobj_t       consts = code->py._code.binary.content.consts;
+  list_t        l;
+
+  if ( stream ) return conststream_code_count( stream ) ? conststream_code_at( stream, 0 ) : NULL;
+
+  for ( l = consts ? consts->py._list : NULL ; !list_is_empty( l ) ; l = list_next( l ) ) {
+    pyobj_t item = list_first( l );
+
+    if ( item && PYOBJ_CODE == item->type ) return item;
+  }
+
+  return NULL;
+}
+
+/* .line, its number, then LOAD_CONST 0 and RETURN_VALUE */
+static int instructions_readable( pyobj_t code ) {
+  list_t l = code->py._code.instructions;
+
+  if ( list_is_empty( l ) || strcmp( lexem_type( list_first( l ) ), "directive::line" ) ) return 0;
+  l = list_next( list_next( l ) );
+  if ( list_is_empty( l ) || strncmp( lexem_type( list_first( l ) ), "insn::", 6 ) ) return 0;
+
+  return 0 == strcmp( lexem_value( list_first( l ) ), "LOAD_CONST" );
+}
+
+/* the instructions of code are all lexems of made */
+static int instructions_made( pyobj_t code, lexem_t *made, size_t count ) {
+  list_t l;
+  size_t i;
+
+  for ( l = code->py._code.instructions ; !list_is_empty( l ) ; l = list_next( l ) ) {
+    for ( i = 0 ; i < count && made[ i ] != list_first( l ) ; i++ );
+    if ( i == count ) return 0;
+  }
+
+  return 1;
+}
+
+static void parse_nested( char *file, int streamed ) {
+  list_t   lexems = lex( RULES, file );
+  list_t   rest   = lexems;
+  size_t   count  = list_length( lexems ), i = 0;
+  lexem_t *made   = malloc( ( count ? count : 1 ) * sizeof( *made ) );
+  pyobj_t  module, f, g;
+
+  for ( rest = lexems ; !list_is_empty( rest ) ; rest = list_next( rest ) ) made[ i++ ] = list_first( rest );
+  rest = lexems;
+
+  conststream_enable( streamed );
+  module = parse_program( &rest );
+  conststream_enable( 0 );
+
+  test_assert( NULL != module, "The module is parsed" );
+  if ( !module ) {
+    list_delete( lexems, lexem_delete );
+    free( made );
+    return;
+  }
+
+  f = nested( module );
+  g = f ? nested( f ) : NULL;
+  test_assert( f && g, "Both nested code objects are found" );
+
+  test_assert( instructions_readable( module ), "The instructions of the module are still there" );
+  test_assert( f && instructions_readable( f ), "The instructions of f are still there" );
+  test_assert( g && instructions_readable( g ), "The instructions of g (nested in f) are still there" );
+
+  test_assert( instructions_made( module, made, count ) && f && instructions_made( f, made, count ) &&
+               g && instructions_made( g, made, count ), "They are the lexems lex() made, not copies" );
+  test_assert( list_length( lexems ) + list_length( module->py._code.instructions ) +
+               list_length( f->py._code.instructions ) + list_length( g->py._code.instructions ) == count,
+               "They left the list of lexems" );
+
+  /* the code objects and the list free their own lexems */
+  pyobj_delete( module );
+  list_delete( lexems, lexem_delete );
+  free( made );
+}
+
+int main( int argc, char *argv[] ) {
+  char *file;
+
+  unit_test( argc, argv );
+
+  file = source_file();
+
+  test_suite( "Nested code objects from parse_program()" );
+  test_assert( NULL != file, "Temporary source file" );
+  if ( !file ) exit( EXIT_FAILURE );
+
+  parse_nested( file, 0 );
+
+  test_suite( "Nested code objects from parse_program(), streamed .consts" );
+  parse_nested( file, 1 );
+
+  unlink( file );
+
+  exit( EXIT_SUCCESS );
+}
@@ -0,0 +1,102 @@
+/**
+ * @file 7c-parser-aside.c
+ * @author Abdellah
+ * @brief Tests of the data kept aside for code objects.
+ *
+ * What is kept aside for a code object allocated in an arena goes with
+ * the arena: a new code object at the same address finds nothing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unitest/unitest.h>
+#include <generic/arena.h>
+#include <parser/pyobj.h>
+#include <parser/aside.h>
+
+static int deleted = 0;
+
+static int count_delete( void *data ) {
+  deleted++;
+  free( data );
+  return 0;
+}
+
+static void *data_new( void ) {
+  void *data = malloc( 1 );
+
+  if ( !data ) exit( EXIT_FAILURE );
+
+  return data;
+}
+
+static void no_arena( void ) {
+  pyobj_t code = calloc( 1, sizeof( *code ) );
+  void   *a    = data_new(), *b = data_new(), *c = data_new();
+
+  test_suite( "Aside: code objects without an arena" );
+
+  deleted = 0;
+  test_assert( NULL == aside_get( code, ASIDE_INSN ), "Nothing aside at first" );
+
+  aside_put( code, ASIDE_INSN, a, count_delete );
+  aside_put( code, ASIDE_CONSTS, b, count_delete );
+  test_assert( a == aside_get( code, ASIDE_INSN ) && b == aside_get( code, ASIDE_CONSTS ), "One piece of data of each kind" );
+
+  aside_put( code, ASIDE_INSN, c, count_delete );
+  test_assert( 1 == deleted && c == aside_get( code, ASIDE_INSN ), "Putting another one deletes the previous one" );
+
+  test_assert( c == aside_take( code, ASIDE_INSN ) && NULL == aside_get( code, ASIDE_INSN ), "Taking it back removes it" );
+  test_assert( b == aside_take( code, ASIDE_CONSTS ) && 1 == deleted, "Data taken back is not deleted" );
+
+  free( b );
+  free( c );
+  free( code );
+}
+
+static void with_arena( void ) {
+  arena_t unit = arena_new( 0 );
+  pyobj_t code, again, kept;
+  void   *taken;
+
+  test_suite( "Aside: code objects of an arena" );
+
+  deleted = 0;
+  arena_set_current( unit );
+  code = arena_calloc( unit, 1, sizeof( *code ) );
+  kept = arena_calloc( unit, 1, sizeof( *kept ) );
+  aside_put( code, ASIDE_INSN, data_new(), count_delete );
+  aside_put( code, ASIDE_CONSTS, data_new(), count_delete );
+  aside_put( kept, ASIDE_INSN, data_new(), count_delete );
+  arena_set_current( NULL );
+
+  taken = aside_take( kept, ASIDE_INSN );
+
+  arena_reset( unit );
+  test_assert( 2 == deleted, "Resetting the arena deletes what is left aside (%d deleted)", deleted );
+  test_assert( NULL == aside_get( code, ASIDE_INSN ) && NULL == aside_get( code, ASIDE_CONSTS ), "Nothing is left aside" );
+  free( taken );
+
+  /* the same address, for another code object */
+  arena_set_current( unit );
+  again = arena_calloc( unit, 1, sizeof( *again ) );
+  test_assert( again == code, "The arena hands the address out again" );
+  test_assert( NULL == aside_get( again, ASIDE_INSN ) && NULL == aside_get( again, ASIDE_CONSTS ), "The new code object finds nothing" );
+
+  aside_put( again, ASIDE_INSN, data_new(), count_delete );
+  arena_set_current( NULL );
+  arena_delete( unit );
+  test_assert( 3 == deleted, "Deleting the arena deletes what is left aside" );
+}
+
+int main( int argc, char *argv[] ) {
+
+  unit_test( argc, argv );
+
+  no_arena();
+  with_arena();
+
+  exit( EXIT_SUCCESS );
+}
@@ -0,0 +1,199 @@
+/**
+ * @file 7d-parser-longs.c
+ * @author Abdellah
+ * @brief Tests of integer constants past 64 bits.
+ *
+ * Streamed .consts write them as marshal longs ('l'): a signed count of
+ * digits in base 2^15, then the digits, least significant first. The
+ * digits of numlit_long() are checked against a long division of the
+ * literal by 2^15.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <unitest/unitest.h>
+#include <generic/list.h>
+#include <lexer/lexem.h>
+#include <lexer/lexer.h>
+#include <lexer/numlit.h>
+#include <parser/parser.h>
+#include <parser/pyobj.h>
+#include <parser/conststream.h>
+
+#define RULES "include/lexer/regexp_file.lex"
+
+/* the digits of the literal by long division, -1 if it is no integer */
+static int reference( const char *literal, uint16_t *digits, int *negative ) {
+  unsigned char number[ 256 ];
+  size_t        length = 0, i;
+  unsigned      base   = 10;
+  int           count  = 0;
+
+  *negative = '-' == *literal;
+  literal  += *negative;
+  if ( '0' == literal[ 0 ] && literal[ 1 ] && strchr( "xob", literal[ 1 ] ) ) {
+    base     = 'x' == literal[ 1 ] ? 16 : 'o' == literal[ 1 ] ? 8 : 2;
+    literal += 2;
+  }
+  for ( ; *literal ; literal++ ) {
+    const char *hex = "0123456789abcdef";
+    const char *d   = strchr( hex, *literal >= 'A' && *literal <= 'F' ? *literal - 'A' + 'a' : *literal );
+
+    if ( !d || (unsigned)( d - hex ) >= base ) return -1;
+    number[ length++ ] = (unsigned char)( d - hex );
+  }
+  if ( !length ) return -1;
+
+  for ( ;; ) {
+    unsigned long remainder = 0;
+    int           zero      = 1;
+
+    for ( i = 0 ; i < length ; i++ ) {
+      remainder   = remainder * base + number[ i ];
+      number[ i ] = (unsigned char)( remainder >> 15 );
+      remainder  &= 0x7fff;
+      zero        = zero && !number[ i ];
+    }
+    digits[ count++ ] = (uint16_t)remainder;
+    if ( zero ) break;
+  }
+  while ( count && !digits[ count - 1 ] ) count--;
+
+  return count;
+}
+
+static void digits( void ) {
+  static const char *literals[] = {
+    "0", "1", "-1", "32767", "32768", "1073741824", "9223372036854775807",
+    "9223372036854775808", "-9223372036854775809", "18446744073709551616",
+    "123456789012345678901234567890123456789012345678901234567890",
+    "-000000000000000000000000000000000000000001",
+    "0x10000000000000000", "0xffffffffffffffffffffffffffffffff", "0XABC",
+    "-0x7FFF8000", "0o1777777777777777777777777", "0o7",
+    "0b11111111111111111111111111111111111111111111111111111111111111111",
+    "0b0000000000000000000000000000000000000000000000000000000000000000001",
+    "12a", "0x", "0xg", "0o8", "0b2", "-", ""
+  };
+  size_t   i;
+  int      differ = 0, first = -1;
+
+  test_suite( "numlit_long() against a long division" );
+
+  for ( i = 0 ; i < sizeof( literals ) / sizeof( *literals ) ; i++ ) {
+    size_t   length = strlen( literals[ i ] );
+    uint16_t got[ 64 ], expected[ 64 ];
+    int      got_negative = 0, expected_negative = 0;
+    int      n            = numlit_long( literals[ i ], length, got, &got_negative );
+    int      m            = reference( literals[ i ], expected, &expected_negative );
+
+    if ( m < 0 ? n != NUMLIT_INVALID :
+         n != m || got_negative != expected_negative || memcmp( got, expected, m * sizeof( *got ) ) ) {
+      if ( !differ++ ) first = (int)i;
+    }
+  }
+
+  test_assert( 0 == differ, "%d literals of %zu differ (first: \"%s\")", differ,
+               sizeof( literals ) / sizeof( *literals ), first < 0 ? "" : literals[ first ] );
+}
+
+static const char *source =
+  ".set version_pyvm 62211\n"
+  ".set flags 0x00000040\n"
+  ".set filename \"longs.py\"\n"
+  ".set name \"<module>\"\n"
+  ".set stack_size 1\n"
+  ".set arg_count 0\n"
+  "\n"
+  ".consts\n"
+  "  7\n"
+  "  -1180591620717411303424\n"
+  "  0x10000000000000000\n"
+  "\n"
+  ".text\n"
+  ".line 1\n"
+  "  LOAD_CONST 0\n"
+  "  RETURN_VALUE\n";
+
+/* the source in a file of its own, for lex() */
+static char *source_file( void ) {
+  static char name[] = "/tmp/7d-parser-longs-XXXXXX";
+  int         fd     = mkstemp( name );
+
+  if ( fd < 0 ) return NULL;
+  if ( write( fd, source, strlen( source ) ) != (ssize_t)strlen( source ) ) {
+    close( fd );
+    return NULL;
+  }
+  close( fd );
+
+  return name;
+}
+
+static void streamed( char *file ) {
+  /* -2^70 and 2^64, after the tuple of 3 and 7 */
+  static const unsigned char expected[] = {
+    '(', 3, 0, 0, 0,
+    'i', 7, 0, 0, 0,
+    'l', 0xfb, 0xff, 0xff, 0xff, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x04,
+    'l', 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10, 0
+  };
+  unsigned char bytes[ 64 ];
+  list_t        lexems = lex( RULES, file );
+  list_t        rest   = lexems;
+  pyobj_t       module;
+  conststream_t stream;
+  FILE         *fp;
+  size_t        size   = 0;
+
+  test_suite( "Longs in streamed .consts" );
+
+  conststream_enable( 1 );
+  module = parse_program( &rest );
+  conststream_enable( 0 );
+
+  test_assert( NULL != module, "The module is parsed" );
+  if ( !module ) {
+    list_delete( lexems, lexem_delete );
+    return;
+  }
+
+  stream = conststream_of( module );
+  test_assert( stream && 3 == conststream_count( stream ), "The three constants are streamed" );
+
+  fp = tmpfile();
+  if ( fp && stream && 0 == conststream_write( stream, fp, NULL ) ) {
+    rewind( fp );
+    size = fread( bytes, 1, sizeof( bytes ), fp );
+  }
+  if ( fp ) fclose( fp );
+  test_assert( sizeof( expected ) == size && 0 == memcmp( bytes, expected, size ), "They are written as marshal longs" );
+
+  pyobj_delete( module );
+  list_delete( lexems, lexem_delete );
+
+  /* without streaming, longs are still an error */
+  lexems = lex( RULES, file );
+  rest   = lexems;
+  module = parse_program( &rest );
+  test_assert( NULL == module, "Not streamed, a long is an error" );
+  pyobj_delete( module );
+  list_delete( lexems, lexem_delete );
+}
+
+int main( int argc, char *argv[] ) {
+  char *file;
+
+  unit_test( argc, argv );
+
+  digits();
+
+  file = source_file();
+  if ( !file ) exit( EXIT_FAILURE );
+  streamed( file );
+  unlink( file );
+
+  exit( EXIT_SUCCESS );
+}
@@ -0,0 +1,184 @@
+/**
+ * @file 7e-parser-trivia.c
+ * @author Abdellah
+ * @brief Differential test of the parser on trivia-free streams.
+ *
+ * Every source of the corpus is parsed from the usual lexems and from a
+ * trivia-free stream (LEX_SKIP_TRIVIA): both must be accepted or both
+ * rejected, and the code objects must print the same. The corpus is a
+ * template with blanks, newlines and comments in many places, valid or
+ * not, plus the .pys files of TEST_DATA "files-pys/" when there are
+ * some.
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <unitest/unitest.h>
+#include <generic/list.h>
+#include <lexer/lexem.h>
+#include <lexer/lexer.h>
+#include <parser/parser.h>
+#include <parser/pyobj.h>
+
+#define RULES  "include/lexer/regexp_file.lex"
+#define CORPUS TEST_DATA "files-pys/"
+
+static const char *header =
+  ".set version_pyvm 62211\n"
+  ".set flags 0x00000040\n"
+  ".set filename \"trivia.py\"\n"
+  ".set name \"<module>\"\n"
+  ".set stack_size 1\n"
+  ".set arg_count 0\n";
+
+/* what goes after .consts, then what goes after .text */
+static const char *consts[] = {
+  "  None\n  ( 1 2 ( 3 \"a\" ) )\n",
+  "  None\n  ( 1 2 # c\n )\n",
+  "  None\n  ( 1 # c\n 2 )\n",
+  "  None\n  [ # c\n 1 ]\n",
+  "  None\n  [ 1 [ 2 # c\n ] ]\n",
+  "  None\n  ( \n 1\n\n 2\n )\n",
+  "  None\n  [ 1\t2 ]  \n",
+  "  None\n  [ 1 2 ] # c\n",
+  "  None\n  [ ]\n",
+  "  None # c\n  1\n",
+  "\n\n  None\n\n  1\n\n",
+  "# c\n  None\n",
+  "  None 1\n",
+  "  None\n  1 # c\n  # c\n  2\n"
+};
+
+static const char *texts[] = {
+  ".line 1\n  LOAD_CONST 0\n  RETURN_VALUE\n",
+  ".line 1 # c\n  LOAD_CONST 0 # c\n  RETURN_VALUE # c\n",
+  "# c\n.line 1\n\n  LOAD_CONST 0\n\n  RETURN_VALUE\n",
+  ".line 1\nstart:\n  LOAD_CONST 0\n  POP_JUMP_IF_FALSE start # c\n  RETURN_VALUE\n",
+  ".line 1\n  LOAD_CONST # c\n 0\n  RETURN_VALUE\n",
+  ".line 1\n  LOAD_CONST 0 RETURN_VALUE\n",
+  ".line\t1\n\tLOAD_CONST\t0\n\tRETURN_VALUE\n"
+};
+
+static char *source_file( const char *consts_, const char *text, const char *after_consts ) {
+  static int n = 0;
+  char      *name = malloc( 64 );
+  FILE      *fp;
+
+  snprintf( name, 64, "/tmp/7e-parser-trivia-%d-XXXXXX", n++ );
+  close( mkstemp( name ) );
+  fp = fopen( name, "w" );
+  fprintf( fp, "%s\n.consts%s\n%s.text\n%s", header, after_consts, consts_, text );
+  fclose( fp );
+
+  return name;
+}
+
+/* what pyobj_print_all_recursif() prints, malloc'ed */
+static char *printed( pyobj_t code ) {
+  FILE  *fp = tmpfile();
+  int    saved;
+  long   size;
+  char  *text;
+
+  fflush( stdout );
+  saved = dup( STDOUT_FILENO );
+  dup2( fileno( fp ), STDOUT_FILENO );
+  pyobj_print_all_recursif( code );
+  fflush( stdout );
+  dup2( saved, STDOUT_FILENO );
+  close( saved );
+
+  size = ftell( fp );
+  text = calloc( 1, size + 1 );
+  rewind( fp );
+  if ( fread( text, 1, size, fp ) != (size_t)size ) text[ 0 ] = '\0';
+  fclose( fp );
+
+  return text;
+}
+
+/* the code object printed, NULL if the source is rejected */
+static char *parsed( const char *file, int options ) {
+  list_t  lexems = lex_with( RULES, (char *)file, options );
+  list_t  rest   = lexems;
+  pyobj_t code;
+  char   *text   = NULL;
+
+  if ( !lexems ) return NULL;
+
+  code = parse_program( &rest );
+  if ( code ) {
+    text = printed( code );
+    pyobj_delete( code );
+  }
+  list_delete( lexems, lexem_delete );
+
+  return text;
+}
+
+struct tally {
+  int  files, accepted, rejected, differ;
+  char first[ 64 ];
+};
+
+static void compare( struct tally *t, const char *file ) {
+  char *usual = parsed( file, 0 );
+  char *free_ = parsed( file, LEX_SKIP_TRIVIA );
+
+  t->files++;
+  if ( !usual && !free_ ) t->rejected++;
+  else if ( usual && free_ && 0 == strcmp( usual, free_ ) ) t->accepted++;
+  else if ( !t->differ++ ) snprintf( t->first, sizeof( t->first ), "%s", file );
+
+  free( usual );
+  free( free_ );
+}
+
+int main( int argc, char *argv[] ) {
+  static const char *after_consts[] = { "", "\n", "\n# c" };
+  DIR               *dir;
+  struct dirent     *entry;
+  struct tally       t;
+  size_t             i, j, k;
+
+  unit_test( argc, argv );
+
+  memset( &t, 0, sizeof( t ) );
+
+  test_suite( "Parser: usual and trivia-free streams, generated sources" );
+
+  for ( i = 0 ; i < sizeof( consts ) / sizeof( *consts ) ; i++ )
+    for ( j = 0 ; j < sizeof( texts ) / sizeof( *texts ) ; j++ )
+      for ( k = 0 ; k < sizeof( after_consts ) / sizeof( *after_consts ) ; k++ ) {
+        char *file = source_file( consts[ i ], texts[ j ], after_consts[ k ] );
+
+        compare( &t, file );
+        if ( !t.differ ) unlink( file );
+        free( file );
+      }
+
+  test_assert( 0 == t.differ, "%d sources, %d parsed differently (first: %s)", t.files, t.differ, t.first );
+  test_assert( t.accepted > 0 && t.rejected > 0, "Some are accepted (%d), some rejected (%d)", t.accepted, t.rejected );
+
+  test_suite( "Parser: usual and trivia-free streams, " CORPUS );
+
+  memset( &t, 0, sizeof( t ) );
+  dir = opendir( CORPUS );
+  while ( dir && ( entry = readdir( dir ) ) ) {
+    size_t length = strlen( entry->d_name );
+    char   file[ 512 ];
+
+    if ( length < 5 || strcmp( entry->d_name + length - 4, ".pys" ) ) continue;
+    snprintf( file, sizeof( file ), "%s%s", CORPUS, entry->d_name );
+    compare( &t, file );
+  }
+  if ( dir ) closedir( dir );
+
+  test_assert( 0 == t.differ, "%d files, %d parsed differently (first: %s)", t.files, t.differ, t.first );
+
+  exit( EXIT_SUCCESS );
+}
@@ -0,0 +1,167 @@
+/**
+ * @file 9b-pyasm-parallel.c
+ * @author Abdellah
+ * @brief Tests of the parallel assembly of nested code objects.
+ *
+ * The module is a tiny job, followed by enough functions for pyasm()
+ * to assemble them on a thread pool (PYASM_PARALLEL_MIN instructions):
+ * with more than one CPU, the first jobs end while the next ones are
+ * still being spawned. The bytecode of every code object must still be
+ * complete once pyasm() returns, and the workers are kept from one call
+ * to the next.
+ */
+
+#include <dirent.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <unitest/unitest.h>
+#include <lexer/lexer.h>
+#include <lexer/tokbuf.h>
+#include <parser/pyobj.h>
+#include <parser/conststream.h>
+
+int     pyasm( pyobj_t code );
+pyobj_t parse_tokens( tokbuf_t tokens );
+
+#define RULES     "include/lexer/regexp_file.lex"
+#define FUNCTIONS 64
+#define PAIRS     60 /* LOAD_CONST 0, POP_TOP in each function */
+
+static void header( FILE *fp, const char *indent, const char *name ) {
+  fprintf( fp, "%s.set version_pyvm 62211\n", indent );
+  fprintf( fp, "%s.set flags 0x00000043\n", indent );
+  fprintf( fp, "%s.set filename \"parallel.py\"\n", indent );
+  fprintf( fp, "%s.set name \"%s\"\n", indent, name );
+  fprintf( fp, "%s.set stack_size 1\n", indent );
+  fprintf( fp, "%s.set arg_count 0\n", indent );
+}
+
+static char *source_file( void ) {
+  static char name[] = "/tmp/9b-pyasm-parallel-XXXXXX";
+  int         fd     = mkstemp( name );
+  FILE       *fp     = fd < 0 ? NULL : fdopen( fd, "w" );
+  int         f, i;
+
+  if ( !fp ) return NULL;
+
+  header( fp, "", "<module>" );
+  fprintf( fp, ".consts\n  None\n" );
+  for ( f = 0 ; f < FUNCTIONS ; f++ ) {
+    char name[ 16 ];
+
+    snprintf( name, sizeof( name ), "f%d", f );
+    fprintf( fp, "  .code_start\n" );
+    header( fp, "    ", name );
+    fprintf( fp, "    .consts\n      None\n    .text\n    .line 1\n" );
+    for ( i = 0 ; i < PAIRS ; i++ ) fprintf( fp, "      LOAD_CONST 0\n      POP_TOP\n" );
+    fprintf( fp, "      LOAD_CONST 0\n      RETURN_VALUE\n  .code_end\n" );
+  }
+  fprintf( fp, ".text\n.line 1\n  LOAD_CONST 0\n  RETURN_VALUE\n" );
+  fclose( fp );
+
+  return name;
+}
+
+static int bytecode_is( pyobj_t code, const unsigned char *expected, int size ) {
+  pyobj_t bytecode = code->py._code.binary.content.bytecode;
+
+  return bytecode && size == bytecode->py._string.length &&
+    0 == memcmp( bytecode->py._string.buffer, expected, size );
+}
+
+/* threads of the process, -1 if they cannot be counted */
+static int thread_count( void ) {
+  DIR           *dir   = opendir( "/proc/self/task" );
+  struct dirent *entry;
+  int            count = 0;
+
+  if ( !dir ) return -1;
+  while ( ( entry = readdir( dir ) ) ) count += '.' != entry->d_name[ 0 ];
+  closedir( dir );
+
+  return count;
+}
+
+/* the code objects borrow their instructions from tokens (see tokbuf.h) */
+static void assemble( tokbuf_t tokens, unsigned char *function, int size, int rounds ) {
+  static const unsigned char module[] = { 0x64, 0x00, 0x00, 0x53 };
+  int round, wrong = 0, failed = 0, threads = -1;
+
+  for ( round = 0 ; round < rounds ; round++ ) {
+    pyobj_t       code   = parse_tokens( tokens );
+    conststream_t stream;
+    list_t        l;
+    int           found  = 0;
+
+    if ( !code || pyasm( code ) < 0 ) {
+      failed++;
+      pyobj_delete( code );
+      continue;
+    }
+
+    if ( !bytecode_is( code, module, sizeof( module ) ) ) wrong++;
+
+    stream = conststream_of( code );
+    if ( stream ) {
+      size_t i;
+
+      for ( i = 0 ; i < conststream_code_count( stream ) ; i++, found++ ) {
+        if ( !bytecode_is( conststream_code_at( stream, i ), function, size ) ) wrong++;
+      }
+    }
+    for ( l = code->py._code.binary.content.consts->py._list ; !list_is_empty( l ) ; l = list_next( l ) ) {
+      pyobj_t item = list_first( l );
+
+      if ( PYOBJ_CODE != item->type ) continue;
+      if ( !bytecode_is( item, function, size ) ) wrong++;
+      found++;
+    }
+    if ( FUNCTIONS != found ) wrong++;
+
+    pyobj_delete( code );
+    if ( !round ) threads = thread_count();
+  }
+
+  test_assert( 0 == failed, "Every round is parsed and assembled" );
+  test_assert( 0 == wrong, "Every code object has its whole bytecode once pyasm() returned" );
+  test_assert( threads > 1 && threads == thread_count(), "The workers of the first round are kept for the next ones (%d threads)", threads );
+}
+
+int main( int argc, char *argv[] ) {
+  int            size     = 4 * PAIRS + 4;
+  unsigned char *function = malloc( size );
+  char          *file;
+  tokbuf_t       tokens;
+  int            i;
+
+  unit_test( argc, argv );
+
+  for ( i = 0 ; i < PAIRS ; i++ ) memcpy( function + 4 * i, "\x64\x00\x00\x01", 4 );
+  memcpy( function + 4 * PAIRS, "\x64\x00\x00\x53", 4 );
+
+  file = source_file();
+
+  test_suite( "Parallel assembly: a tiny module, then many functions" );
+  test_assert( NULL != file, "Temporary source file" );
+  if ( !file ) exit( EXIT_FAILURE );
+  tokens = lex_tokens( RULES, file, 0 );
+  unlink( file );
+  test_assert( NULL != tokens, "The source is lexed" );
+  if ( !tokens ) exit( EXIT_FAILURE );
+
+  assemble( tokens, function, size, 20 );
+
+  test_suite( "Parallel assembly, streamed .consts" );
+  conststream_enable( 1 );
+  assemble( tokens, function, size, 20 );
+  conststream_enable( 0 );
+
+  tokbuf_delete( tokens );
+  free( function );
+
+  exit( EXIT_SUCCESS );
+}